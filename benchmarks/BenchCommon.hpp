@@ -0,0 +1,122 @@
+/*
+    BenchCommon.hpp
+    Helpers shared by the benchmark executables
+    Timing, CPU pinning / frequency checks and the JSON environment block
+*/
+
+#ifndef BENCHCOMMON_HPP
+#define BENCHCOMMON_HPP
+
+#include "utils/hpp/json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <omp.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace bench {
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+inline double ElapsedMs(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+inline double Median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : 0.5 * (values[mid - 1] + values[mid]);
+}
+
+// keeps results alive so the compiler cannot drop the measured work
+inline volatile double sink = 0.0;
+inline void DoNotOptimize(double value) { sink = value; }
+
+inline std::string ReadFirstLine(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// CPU state of the run: the calling thread is pinned to its current core and the
+// frequency governor is checked (only "performance" keeps the clock fixed)
+struct CpuSetup {
+    int cpu = -1;
+    bool pinned = false;
+    std::string governor;     // empty if cpufreq is not exposed (VMs, containers)
+    bool governor_set = false;
+    bool turbo_disabled = false;
+
+    json ToJSON() const {
+        return json{{"cpu", cpu}, {"pinned", pinned}, {"governor", governor},
+                    {"governor_set", governor_set}, {"turbo_disabled", turbo_disabled},
+                    {"hardware_threads", std::thread::hardware_concurrency()},
+                    {"omp_threads", omp_get_max_threads()}};
+    }
+};
+
+// set_governor: try to switch the core to "performance" (needs root)
+// pin_thread: pin the calling thread (single-threaded kernels); the OpenMP workers
+// are started first so they keep the full mask. Leave it off in processes that
+// fork before using OpenMP.
+inline CpuSetup PrepareCpu(bool set_governor, bool pin_thread = true) {
+    CpuSetup setup;
+#ifdef __linux__
+    setup.cpu = sched_getcpu();
+    if (pin_thread && setup.cpu >= 0) {
+        #pragma omp parallel
+        { }
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(setup.cpu, &set);
+        setup.pinned = sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+
+    const std::string cpufreq = "/sys/devices/system/cpu/cpu" + std::to_string(std::max(setup.cpu, 0)) + "/cpufreq/";
+    setup.governor = ReadFirstLine(cpufreq + "scaling_governor");
+    if (set_governor && !setup.governor.empty() && setup.governor != "performance") {
+        std::ofstream(cpufreq + "scaling_governor") << "performance";
+        setup.governor_set = ReadFirstLine(cpufreq + "scaling_governor") == "performance";
+        if (setup.governor_set) setup.governor = "performance";
+    }
+    setup.turbo_disabled = ReadFirstLine("/sys/devices/system/cpu/intel_pstate/no_turbo") == "1" ||
+                           ReadFirstLine("/sys/devices/system/cpu/cpufreq/boost") == "0";
+#endif
+
+    if (setup.governor.empty()) {
+        std::cerr << "Warning: CPU frequency governor not available, timings may drift with the clock" << std::endl;
+    } else if (setup.governor != "performance") {
+        std::cerr << "Warning: CPU governor is '" << setup.governor
+                  << "', run with --set-governor as root (or cpupower frequency-set -g performance)" << std::endl;
+    }
+    return setup;
+}
+
+inline bool WriteJSON(const json& result, const std::string& path) {
+    if (path.empty() || path == "-") {
+        std::cout << result.dump(2) << std::endl;
+        return true;
+    }
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: cannot write " << path << std::endl;
+        return false;
+    }
+    out << result.dump(2) << std::endl;
+    return true;
+}
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,346 @@
+/*
+    KernelBench.cpp
+    Microbenchmark of the intersection kernels, of BVH traversal and of the sampling warps
+    Fixed seeded ray sets, reports ns/ray and hit rates as a table and as JSON
+*/
+
+#include "BenchCommon.hpp"
+#include "objects/hpp/Sphere.hpp"
+#include "objects/hpp/Triangle.hpp"
+#include "objects/hpp/Cylinder.hpp"
+#include "objects/hpp/Cone.hpp"
+#include "objects/hpp/Parallepiped.hpp"
+#include "objects/hpp/Plan.hpp"
+#include "objects/hpp/LinearBVH.hpp"
+#include "materials/hpp/Lambertian.hpp"
+#include "scene/hpp/scene.hpp"
+#include "scene/hpp/Sceneloader.hpp"
+#include "scene/hpp/SceneCompiler.hpp"
+#include "utils/hpp/Sampling.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace {
+
+struct Options {
+    size_t rays = 1 << 16;          // rays per set
+    int min_samples = 5;            // timed passes over the set
+    double min_time_ms = 200.0;     // per kernel, more passes are run until reached
+    uint64_t seed = 42;
+    size_t bvh_primitives = 100000; // random spheres when no scene is given
+    std::string scene;
+    std::string json_out;
+    bool set_governor = false;
+};
+
+void PrintUsage() {
+    std::cout << "Usage: rt_kernel_bench [options]\n"
+              << "  --rays N            rays per ray set (default 65536)\n"
+              << "  --samples N         minimum timed passes per kernel (default 5)\n"
+              << "  --min-time MS       minimum time per kernel (default 200)\n"
+              << "  --seed N            ray and scene seed (default 42)\n"
+              << "  --bvh-size N        random spheres for the BVH benchmark (default 100000)\n"
+              << "  --scene FILE        BVH benchmark on a scene (.json or .rtsc) and its camera rays instead\n"
+              << "  --json FILE         write the results as JSON ('-' for stdout, no table)\n"
+              << "  --set-governor      switch the pinned core to the performance governor (root)\n";
+}
+
+bool ParseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--rays" && has_value) options.rays = std::max(1L, std::atol(argv[++i]));
+        else if (arg == "--samples" && has_value) options.min_samples = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--min-time" && has_value) options.min_time_ms = std::atof(argv[++i]);
+        else if (arg == "--seed" && has_value) options.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--bvh-size" && has_value) options.bvh_primitives = std::max(1L, std::atol(argv[++i]));
+        else if (arg == "--scene" && has_value) options.scene = argv[++i];
+        else if (arg == "--json" && has_value) options.json_out = argv[++i];
+        else if (arg == "--set-governor") options.set_governor = true;
+        else return false;
+    }
+    return true;
+}
+
+// rays from a sphere of radius `distance` towards points of the [-extent, extent]^3 cube
+std::vector<Ray> MakeRays(size_t count, double distance, double extent, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    std::vector<Ray> rays;
+    rays.reserve(count);
+    while (rays.size() < count) {
+        Vector3 d(unit(rng), unit(rng), unit(rng));
+        if (d.lengthSquared() > 1.0 || d.lengthSquared() < 1e-6) continue;
+        Point3 origin = d / std::sqrt(d.lengthSquared()) * distance;
+        Point3 target(unit(rng) * extent, unit(rng) * extent, unit(rng) * extent);
+        rays.emplace_back(origin, target - origin);
+    }
+    return rays;
+}
+
+// hit(ray, t_sum) -> bool is timed over the whole ray set, min_samples passes at least
+template <typename HitFn>
+bench::json TimeKernel(const std::string& name, const std::vector<Ray>& rays, HitFn&& hit, const Options& options) {
+    double t_sum = 0.0;
+    size_t hits = 0;
+    for (const Ray& r : rays) hits += hit(r, t_sum);   // warm-up, also gives the hit count
+
+    std::vector<double> ns_per_ray;
+    double total_ms = 0.0;
+    while (static_cast<int>(ns_per_ray.size()) < options.min_samples || total_ms < options.min_time_ms) {
+        auto start = bench::Clock::now();
+        for (const Ray& r : rays) hit(r, t_sum);
+        double ms = bench::ElapsedMs(start);
+        total_ms += ms;
+        ns_per_ray.push_back(ms * 1e6 / rays.size());
+    }
+    bench::DoNotOptimize(t_sum);
+
+    return bench::json{
+        {"name", name},
+        {"rays", rays.size()},
+        {"samples", ns_per_ray.size()},
+        {"ns_per_ray", bench::Median(ns_per_ray)},
+        {"ns_per_ray_min", *std::min_element(ns_per_ray.begin(), ns_per_ray.end())},
+        {"hit_rate", static_cast<double>(hits) / rays.size()},
+    };
+}
+
+// closest hit against one concrete primitive (no virtual call)
+template <typename Object>
+bench::json TimePrimitive(const std::string& name, const Object& object, const std::vector<Ray>& rays, const Options& options) {
+    return TimeKernel(name, rays, [&object](const Ray& r, double& t_sum) {
+        hit_record rec;
+        double tmin = 0.001, tmax = infinity;
+        if (!object.hit(r, &tmin, &tmax, rec)) return false;
+        t_sum += rec.t;
+        return true;
+    }, options);
+}
+
+bench::json BenchKernels(const Options& options) {
+    auto mat = std::make_shared<Lambertian>(Vector3(0.5, 0.5, 0.5));
+    // unit sized primitives around the origin, rays aimed at [-1.5, 1.5]^3
+    const std::vector<Ray> rays = MakeRays(options.rays, 4.0, 1.5, options.seed);
+
+    bench::json kernels = bench::json::array();
+    kernels.push_back(TimePrimitive("sphere", sphere(Point3(0, 0, 0), 1.0, mat), rays, options));
+    kernels.push_back(TimePrimitive("triangle", Triangle(Point3(-1, -1, 0), Point3(1, -1, 0), Point3(0, 1, 0), mat), rays, options));
+    kernels.push_back(TimePrimitive("cylinder", Cylinder(Point3(0, 0, -1), Vector3(0, 0, 1), 1.0, 2.0, mat), rays, options));
+    kernels.push_back(TimePrimitive("cone", Cone(Point3(0, 0, 1), Vector3(0, 0, -1), degrees_to_radians(30.0), 2.0, mat), rays, options));
+    kernels.push_back(TimePrimitive("parallelepiped", Parallepiped(Point3(-1, -1, -1), Point3(1, 1, 1), mat), rays, options));
+    kernels.push_back(TimePrimitive("plane", Plan(Point3(0, 0, 0), Vector3(0, 0, 1), mat), rays, options));
+
+    const aabb box(Point3(-1, -1, -1), Point3(1, 1, 1));
+    kernels.push_back(TimeKernel("aabb", rays, [&box](const Ray& r, double& t_sum) {
+        bool hit = box.hit(r, interval(0.001, infinity));
+        t_sum += hit;
+        return hit;
+    }, options));
+    return kernels;
+}
+
+// warp(next, sum) turns uniform values read through next() into a point added to sum;
+// values come from the same generator as random_double(), rejection warps read a
+// variable count of them
+template <typename WarpFn>
+bench::json TimeWarp(const std::string& name, WarpFn&& warp, const Options& options) {
+    std::mt19937 rng(static_cast<unsigned int>(options.seed));
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    size_t reads = 0;
+    auto next = [&]() {
+        reads++;
+        return unit(rng);
+    };
+    const size_t count = options.rays;
+    Vector3 sum(0, 0, 0);
+    for (size_t i = 0; i < count; i++) warp(next, sum);
+    const double values_per_sample = static_cast<double>(reads) / count;
+
+    std::vector<double> ns_per_sample;
+    double total_ms = 0.0;
+    while (static_cast<int>(ns_per_sample.size()) < options.min_samples || total_ms < options.min_time_ms) {
+        auto start = bench::Clock::now();
+        for (size_t i = 0; i < count; i++) warp(next, sum);
+        double ms = bench::ElapsedMs(start);
+        total_ms += ms;
+        ns_per_sample.push_back(ms * 1e6 / count);
+    }
+    bench::DoNotOptimize(sum.x + sum.y + sum.z);
+
+    return bench::json{
+        {"name", name},
+        {"ns_per_sample", bench::Median(ns_per_sample)},
+        {"values_per_sample", values_per_sample},
+    };
+}
+
+// closed-form warps of Sampling.hpp against the rejection loops they replaced
+bench::json BenchSampling(const Options& options) {
+    bench::json warps = bench::json::array();
+    warps.push_back(TimeWarp("disk rejection", [](auto& next, Vector3& sum) {
+        while (true) {
+            Vector3 p(2 * next() - 1, 2 * next() - 1, 0);
+            if (p.lengthSquared() < 1) {
+                sum += p;
+                return;
+            }
+        }
+    }, options));
+    warps.push_back(TimeWarp("disk concentric", [](auto& next, Vector3& sum) {
+        double u = next();
+        sum += Sampling::ConcentricDisk(u, next());
+    }, options));
+    warps.push_back(TimeWarp("sphere rejection", [](auto& next, Vector3& sum) {
+        while (true) {
+            Vector3 p(2 * next() - 1, 2 * next() - 1, 2 * next() - 1);
+            if (p.lengthSquared() < 1) {
+                sum += unit_vector(p);
+                return;
+            }
+        }
+    }, options));
+    warps.push_back(TimeWarp("sphere", [](auto& next, Vector3& sum) {
+        double u = next();
+        sum += Sampling::UniformSphere(u, next());
+    }, options));
+    warps.push_back(TimeWarp("cosine hemisphere", [](auto& next, Vector3& sum) {
+        double u = next();
+        sum += Sampling::ToWorld(Sampling::CosineHemisphere(u, next()), Vector3(0, 0.6, 0.8));
+    }, options));
+    return warps;
+}
+
+bench::json BenchBVH(const Options& options) {
+    Scene scene;
+    std::vector<Ray> rays;
+    std::string source;
+
+    if (!options.scene.empty()) {
+        // loader messages stay off stdout, which may carry the JSON
+        std::ostringstream log;
+        std::streambuf* previous = std::cout.rdbuf(log.rdbuf());
+        const bool loaded = SceneCompiler::IsCompiledScene(options.scene)
+                                ? SceneCompiler::Load(options.scene, scene, 16.0 / 9.0, false)
+                                : SceneLoader::LoadJSONStream(options.scene, scene, 16.0 / 9.0, false);
+        std::cout.rdbuf(previous);
+        // an empty scene would still produce plausible ns/ray figures
+        if (!loaded || scene.GetPrimitives().objects.empty()) {
+            return bench::json{{"scene", options.scene}, {"error", "scene failed to load"}};
+        }
+        // camera rays on a regular grid, lens samples from a fixed seed
+        std::srand(static_cast<unsigned>(options.seed));
+        const size_t width = static_cast<size_t>(std::sqrt(options.rays * 16.0 / 9.0)) + 1;
+        const size_t height = options.rays / width + 1;
+        for (size_t i = 0; i < options.rays; i++) {
+            double s = (i % width + 0.5) / width;
+            double t = 1.0 - (i / width + 0.5) / height;
+            rays.push_back(scene.GetCamera().GenerateRay(s, t));
+        }
+        source = options.scene;
+    } else {
+        std::mt19937_64 rng(options.seed + 1);
+        std::uniform_real_distribution<double> position(-50.0, 50.0), radius(0.1, 0.6);
+        auto mat = std::make_shared<Lambertian>(Vector3(0.5, 0.5, 0.5));
+        for (size_t i = 0; i < options.bvh_primitives; i++) {
+            scene.AddObject(std::make_shared<sphere>(Point3(position(rng), position(rng), position(rng)), radius(rng), mat));
+        }
+        rays = MakeRays(options.rays, 120.0, 50.0, options.seed + 2);
+        source = "random spheres";
+    }
+
+    const hittable_list& primitives = scene.GetPrimitives();
+    struct Config { const char* name; BVHBuilder builder; int morton_bits; };
+    const Config configs[] = {
+        {"median split", BVHBuilder::Median, 0},
+        {"LBVH 30-bit", BVHBuilder::Linear, 30},
+        {"LBVH 63-bit", BVHBuilder::Linear, 63},
+        {"LBVH + treelets", BVHBuilder::LinearRefined, 63},
+    };
+
+    bench::json builders = bench::json::array();
+    for (const Config& config : configs) {
+        auto start = bench::Clock::now();
+        std::shared_ptr<bvh_node> root;
+        if (config.builder == BVHBuilder::Linear) {
+            LinearBVH::Options lbvh;
+            lbvh.morton_bits = config.morton_bits;
+            root = LinearBVH::Build(primitives, lbvh);
+        } else {
+            root = Scene::BuildHierarchy(primitives, config.builder);
+        }
+        double build_ms = bench::ElapsedMs(start);
+        if (!root) break;
+
+        bench::json result = TimeKernel(config.name, rays, [&root](const Ray& r, double& t_sum) {
+            hit_record rec;
+            double tmin = 0.001, tmax = infinity;
+            if (!root->hit(r, &tmin, &tmax, rec)) return false;
+            t_sum += rec.t;
+            return true;
+        }, options);
+        result["build_ms"] = build_ms;
+        result["sah_cost"] = root->sah_cost();
+        // one rebuild plus one traversal per ray of the set: the per-frame trade-off
+        result["frame_ms"] = build_ms + result["ns_per_ray"].get<double>() * rays.size() * 1e-6;
+        builders.push_back(result);
+    }
+
+    return bench::json{{"source", source}, {"primitives", primitives.objects.size()}, {"builders", builders}};
+}
+
+void PrintTables(const bench::json& result) {
+    std::printf("\n%-16s %12s %12s %10s\n", "kernel", "ns/ray", "min ns/ray", "hit rate");
+    for (const auto& k : result["kernels"]) {
+        std::printf("%-16s %12.2f %12.2f %9.1f%%\n", k["name"].get<std::string>().c_str(),
+                    k["ns_per_ray"].get<double>(), k["ns_per_ray_min"].get<double>(), 100.0 * k["hit_rate"].get<double>());
+    }
+
+    std::printf("\n%-20s %12s %14s\n", "warp", "ns/sample", "values/sample");
+    for (const auto& w : result["sampling"]) {
+        std::printf("%-20s %12.2f %14.2f\n", w["name"].get<std::string>().c_str(),
+                    w["ns_per_sample"].get<double>(), w["values_per_sample"].get<double>());
+    }
+
+    const auto& bvh = result["bvh"];
+    std::printf("\nBVH traversal: %s, %zu primitives\n", bvh["source"].get<std::string>().c_str(), bvh["primitives"].get<size_t>());
+    std::printf("%-16s %12s %10s %12s %10s %12s\n", "builder", "build (ms)", "SAH cost", "ns/ray", "hit rate", "frame (ms)");
+    for (const auto& b : bvh["builders"]) {
+        std::printf("%-16s %12.2f %10.2f %12.1f %9.1f%% %12.2f\n", b["name"].get<std::string>().c_str(),
+                    b["build_ms"].get<double>(), b["sah_cost"].get<double>(), b["ns_per_ray"].get<double>(),
+                    100.0 * b["hit_rate"].get<double>(), b["frame_ms"].get<double>());
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    bench::CpuSetup cpu = bench::PrepareCpu(options.set_governor);
+
+    bench::json result;
+    result["benchmark"] = "kernels";
+    result["seed"] = options.seed;
+    result["rays"] = options.rays;
+    result["cpu"] = cpu.ToJSON();
+    result["kernels"] = BenchKernels(options);
+    result["sampling"] = BenchSampling(options);
+    result["bvh"] = BenchBVH(options);
+    if (result["bvh"].contains("error")) {
+        std::cerr << "Error: cannot load scene " << options.scene << std::endl;
+        return 1;
+    }
+
+    if (options.json_out != "-") PrintTables(result);
+    if (!options.json_out.empty() && !bench::WriteJSON(result, options.json_out)) return 1;
+    return 0;
+}
@@ -0,0 +1,441 @@
+/*
+    RenderBench.cpp
+    End-to-end render benchmark: every scene x renderer x loader at a fixed
+    resolution, spp, depth and seed. Results go to JSON and can be compared
+    against a stored baseline to flag regressions.
+*/
+
+#include "BenchCommon.hpp"
+#include "scene/hpp/scene.hpp"
+#include "scene/hpp/Sceneloader.hpp"
+#include "scene/hpp/SceneCompiler.hpp"
+#include "scene/hpp/DefaultScene.hpp"
+#include "RTMotors/hpp/SimpleRenderer.hpp"
+#include "RTMotors/hpp/ParallelRenderer.hpp"
+#include "utils/hpp/Image.hpp"
+#include "utils/hpp/AovBuffers.hpp"
+#include "utils/hpp/ImageWriter.hpp"
+#include "utils/hpp/MemoryUsage.hpp"
+#include "utils/hpp/RenderStats.hpp"
+#include "utils/hpp/Trace.hpp"
+#include "lights/hpp/ShadowCache.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+const char* kRandomSpheres = "random_spheres";
+
+struct Options {
+    int width = 320;
+    int height = 180;
+    int spp = 4;
+    int depth = 5;
+    unsigned int seed = 1;
+    std::string scenes_dir;             // SceneFromJson, searched from the working directory if empty
+    std::vector<std::string> renderers = {"simple", "parallel"};
+    std::vector<std::string> loaders = {"default", "bvh", "streaming", "compiled"};
+    BVHBuilder builder = BVHBuilder::Median;
+    SamplerType sampler = SamplerType::Sobol;
+    int light_samples = 1;              // lights picked per shading point past the exhaustive count
+    bool shadow_cache = true;
+    double denoise = 0.0;               // denoiser strength, 0 = off
+    unsigned aov_passes = 0;            // AovBuffers pass mask, 0 = off
+    std::string aov_dir;                // one EXR per case when set
+    std::string image_dir;              // frame of each case saved there when set
+    ImageFormat image_format = ImageFormat::PNG;
+    std::string json_out = "render_bench.json";
+    std::string baseline;
+    double tolerance = 0.10;            // relative slowdown tolerated before flagging
+    bool set_governor = false;
+    std::string trace_dir;              // one Chrome trace per case when set
+};
+
+struct Case {
+    std::string scene;   // name reported in the JSON
+    std::string path;    // JSON file, empty for the built-in scene
+    std::string renderer;
+    std::string loader;
+
+    std::string Key() const { return scene + "/" + renderer + "/" + loader; }
+};
+
+std::vector<std::string> Split(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+void PrintUsage() {
+    std::cout << "Usage: rt_render_bench [options]\n"
+              << "  --size WxH            resolution (default 320x180)\n"
+              << "  --spp N               samples per pixel (default 4)\n"
+              << "  --depth N             max bounces (default 5)\n"
+              << "  --seed N              scene and sampling seed (default 1)\n"
+              << "  --scenes DIR          directory holding Scene01-04.json (default SceneFromJson)\n"
+              << "  --renderers LIST      simple,parallel\n"
+              << "  --loaders LIST        default,bvh,streaming,compiled\n"
+              << "  --builder NAME        median | lbvh | lbvh-treelets (default median)\n"
+              << "  --sampler NAME        independent | stratified | sobol | bluenoise (default sobol)\n"
+              << "  --light-samples N     lights sampled per shading point in many-light scenes (default 1)\n"
+              << "  --no-shadow-cache     always traverse the BVH for shadow rays\n"
+              << "  --denoise STRENGTH    denoise every frame (1 = default strength)\n"
+              << "  --aovs LIST           output passes: color,albedo,normal,depth,object,material,samples | all\n"
+              << "  --aov-dir DIR         write the passes of each case to DIR as EXR\n"
+              << "  --image-dir DIR       save the frame of each case to DIR (timed as save_ms)\n"
+              << "  --image-format NAME   ppm | png | exr | exr-float (default png)\n"
+              << "  --json FILE           results (default render_bench.json, '-' for stdout, tables on stderr)\n"
+              << "  --baseline FILE       compare against a previous results file\n"
+              << "  --tolerance X         relative regression threshold (default 0.10)\n"
+              << "  --set-governor        switch the CPU to the performance governor (root)\n"
+              << "  --trace DIR           write a Chrome trace of each case to DIR\n";
+}
+
+bool ParseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--size" && has_value) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2) return false;
+        } else if (arg == "--spp" && has_value) options.spp = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--depth" && has_value) options.depth = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seed" && has_value) options.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--scenes" && has_value) options.scenes_dir = argv[++i];
+        else if (arg == "--renderers" && has_value) options.renderers = Split(argv[++i]);
+        else if (arg == "--loaders" && has_value) options.loaders = Split(argv[++i]);
+        else if (arg == "--builder" && has_value) {
+            std::string name = argv[++i];
+            if (name == "median") options.builder = BVHBuilder::Median;
+            else if (name == "lbvh") options.builder = BVHBuilder::Linear;
+            else if (name == "lbvh-treelets") options.builder = BVHBuilder::LinearRefined;
+            else return false;
+        }
+        else if (arg == "--sampler" && has_value) {
+            if (!Sampler::ParseType(argv[++i], options.sampler)) return false;
+        }
+        else if (arg == "--light-samples" && has_value) options.light_samples = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--no-shadow-cache") options.shadow_cache = false;
+        else if (arg == "--denoise" && has_value) options.denoise = std::max(0.0, std::atof(argv[++i]));
+        else if (arg == "--aovs" && has_value) {
+            if (!AovBuffers::ParseList(argv[++i], options.aov_passes)) return false;
+        }
+        else if (arg == "--aov-dir" && has_value) options.aov_dir = argv[++i];
+        else if (arg == "--image-dir" && has_value) options.image_dir = argv[++i];
+        else if (arg == "--image-format" && has_value) {
+            if (!ImageWriter::ParseFormat(argv[++i], options.image_format)) return false;
+        }
+        else if (arg == "--json" && has_value) options.json_out = argv[++i];
+        else if (arg == "--baseline" && has_value) options.baseline = argv[++i];
+        else if (arg == "--tolerance" && has_value) options.tolerance = std::atof(argv[++i]);
+        else if (arg == "--set-governor") options.set_governor = true;
+        else if (arg == "--trace" && has_value) options.trace_dir = argv[++i];
+        else return false;
+    }
+    return options.width > 0 && options.height > 0;
+}
+
+std::string FindScenesDir(const std::string& requested) {
+    if (!requested.empty()) return requested;
+    for (const char* candidate : {"SceneFromJson", "../SceneFromJson", "../../SceneFromJson"}) {
+        if (access((std::string(candidate) + "/Scene01.json").c_str(), R_OK) == 0) return candidate;
+    }
+    return "SceneFromJson";
+}
+
+std::vector<Case> MakeCases(const Options& options) {
+    std::vector<Case> cases;
+    const std::string dir = FindScenesDir(options.scenes_dir);
+    const char* scenes[] = {"Scene01", "Scene02", "Scene03", "Scene04"};
+
+    for (const std::string& renderer : options.renderers) {
+        for (const char* scene : scenes) {
+            for (const std::string& loader : options.loaders) {
+                cases.push_back({scene, dir + "/" + scene + ".json", renderer, loader});
+            }
+        }
+        // the built-in scene is not loaded from a file: flat list or BVH only
+        for (const std::string& loader : options.loaders) {
+            if (loader == "default" || loader == "bvh") cases.push_back({kRandomSpheres, "", renderer, loader});
+        }
+    }
+    return cases;
+}
+
+// runs one case in the current process, std::cout is silenced meanwhile
+bench::json StatsToJSON(const RenderCounters& c, double render_ms) {
+    bench::json tests = bench::json::object();
+    for (int k = 0; k < kPrimitiveKinds; k++) tests[RenderStats::KindName(static_cast<PrimitiveKind>(k))] = c.primitive_tests[k];
+    return bench::json{
+        {"rays", c.rays()}, {"primary_rays", c.primary_rays}, {"bounce_rays", c.bounce_rays},
+        {"shadow_rays", c.shadow_rays}, {"hits", c.hits}, {"bvh_nodes", c.bvh_nodes},
+        {"aabb_tests", c.aabb_tests}, {"primitive_tests", tests},
+        {"shadow_cache_lookups", c.shadow_cache_lookups}, {"shadow_cache_hits", c.shadow_cache_hits},
+        {"rays_per_s", render_ms > 0 ? c.rays() / (render_ms * 1e-3) : 0.0},
+        {"nodes_per_ray", c.per_ray(c.bvh_nodes)},
+        {"aabb_tests_per_ray", c.per_ray(c.aabb_tests)},
+        {"primitive_tests_per_ray", c.per_ray(c.primitive_total())},
+    };
+}
+
+bench::json RunCase(const Case& c, const Options& options) {
+    std::ostringstream log;
+    std::streambuf* previous = std::cout.rdbuf(log.rdbuf());
+
+    Trace::Enable(!options.trace_dir.empty());
+    Trace::SetThreadName("main");
+
+    const double aspect_ratio = static_cast<double>(options.width) / options.height;
+    Scene scene;
+    scene.SetBVHBuilder(options.builder);
+    double bvh_build_ms = 0.0;
+    bool ok = true;
+
+    // the default scene and the BVH builders draw random numbers: same seed, same scene and tree
+    seed_random(options.seed);
+    auto load_start = bench::Clock::now();
+    if (c.path.empty()) {
+        DefaultScene::Build(scene, aspect_ratio);
+    } else if (c.loader == "streaming") {
+        ok = SceneLoader::LoadJSONStream(c.path, scene, aspect_ratio, false);
+    } else if (c.loader == "compiled") {
+        // compiling is a one-off offline step, only the mapped load is timed
+        std::string compiled = "/tmp/rt_render_bench_" + std::to_string(getpid()) + ".rtsc";
+        ok = SceneCompiler::CompileJSON(c.path, compiled, true);
+        load_start = bench::Clock::now();
+        ok = ok && SceneCompiler::Load(compiled, scene, aspect_ratio, true);
+        std::remove(compiled.c_str());
+    } else {
+        SceneLoader::LoadJSON(c.path, scene, aspect_ratio);
+    }
+    if (c.loader == "bvh" || c.loader == "streaming") {
+        seed_random(options.seed);
+        auto bvh_start = bench::Clock::now();
+        scene.BuildBVH();
+        bvh_build_ms = bench::ElapsedMs(bvh_start);
+    }
+    const double load_ms = bench::ElapsedMs(load_start);
+    ok = ok && !scene.GetObjects().objects.empty();
+
+    std::unique_ptr<Renderer> renderer;
+    if (c.renderer == "parallel") renderer = std::make_unique<ParallelRenderer>();
+    else renderer = std::make_unique<SimpleRenderer>();
+    renderer->SetSamplesPerPixel(options.spp);
+    renderer->SetMaxDepth(options.depth);
+    renderer->SetSampler(options.sampler);
+    renderer->SetSamplerSeed(options.seed);
+    renderer->SetLightSamples(options.light_samples);
+    ShadowCache::SetEnabled(options.shadow_cache);
+    if (options.denoise > 0.0) {
+        Denoiser::Options denoise_options;
+        denoise_options.strength = options.denoise;
+        renderer->SetDenoise(true);
+        renderer->SetDenoiseOptions(denoise_options);
+    }
+
+    AovBuffers aovs;
+    if (options.aov_passes) {
+        aovs.SetPasses(options.aov_passes);
+        renderer->SetAovBuffers(&aovs);
+    }
+
+    Image image;
+    image.Initialize(options.width, options.height, NULL);
+
+    // fixed seeds for the independent sampler, the others hash the sampler seed
+    #pragma omp parallel
+    seed_random(options.seed + 1 + omp_get_thread_num());
+
+    double render_ms = 0.0;
+    if (ok) {
+        auto render_start = bench::Clock::now();
+        renderer->Render(scene, image);
+        render_ms = bench::ElapsedMs(render_start);
+    }
+    std::string name = c.Key();
+    std::replace(name.begin(), name.end(), '/', '_');
+    if (ok && options.aov_passes && !options.aov_dir.empty()) {
+        aovs.WriteEXR(options.aov_dir + "/" + name + ".exr");
+    }
+    double save_ms = 0.0;
+    if (ok && !options.image_dir.empty()) {
+        auto save_start = bench::Clock::now();
+        ImageWriter::Write(ImageWriter::Capture(image), options.image_dir + "/" + name + ImageWriter::Extension(options.image_format),
+                           options.image_format);
+        save_ms = bench::ElapsedMs(save_start);
+    }
+    if (Trace::Enabled()) {
+        Trace::Write(options.trace_dir + "/" + name + ".json");
+    }
+    std::cout.rdbuf(previous);
+
+    // all traced rays when the counters are compiled in, camera rays otherwise
+    const RenderCounters& stats = renderer->GetLastStats();
+    const double primary_rays = static_cast<double>(options.width) * options.height * options.spp;
+    const double rays = RenderStats::Enabled() ? static_cast<double>(stats.rays()) : primary_rays;
+    bench::json result{
+        {"scene", c.scene}, {"renderer", c.renderer}, {"loader", c.loader},
+        {"primitives", scene.GetPrimitives().objects.size()},
+        {"load_ms", load_ms}, {"bvh_build_ms", bvh_build_ms}, {"render_ms", render_ms},
+        {"wall_ms", load_ms + render_ms},
+        {"primary_rays", primary_rays},
+        {"mrays_per_s", render_ms > 0 ? rays / (render_ms * 1e3) : 0.0},
+    };
+    if (!options.image_dir.empty()) result["save_ms"] = save_ms;
+    if (RenderStats::Enabled()) result["stats"] = StatsToJSON(stats, render_ms);
+    if (!ok) result["error"] = "scene failed to load";
+    return result;
+}
+
+// runs the case in a child process so peak RSS is measured per case
+bench::json RunIsolated(const Case& c, const Options& options) {
+    int fds[2];
+    if (pipe(fds) != 0) return bench::json{{"scene", c.scene}, {"error", "pipe failed"}};
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        std::string out = RunCase(c, options).dump();
+        size_t written = 0;
+        while (written < out.size()) {
+            ssize_t n = write(fds[1], out.data() + written, out.size() - written);
+            if (n <= 0) break;
+            written += static_cast<size_t>(n);
+        }
+        close(fds[1]);
+        _exit(0);
+    }
+    close(fds[1]);
+
+    std::string text;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) > 0) text.append(buffer, static_cast<size_t>(n));
+    close(fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    if (pid < 0 || wait4(pid, &status, 0, &usage) < 0 || text.empty()) {
+        return bench::json{{"scene", c.scene}, {"renderer", c.renderer}, {"loader", c.loader}, {"error", "case crashed"}};
+    }
+
+    bench::json result = bench::json::parse(text, nullptr, false);
+    if (result.is_discarded()) result = bench::json{{"scene", c.scene}, {"error", "bad output"}};
+#if defined(__APPLE__)
+    result["peak_rss_mib"] = BytesToMiB(static_cast<size_t>(usage.ru_maxrss));
+#else
+    result["peak_rss_mib"] = BytesToMiB(static_cast<size_t>(usage.ru_maxrss) * 1024);
+#endif
+    return result;
+}
+
+std::string CaseKey(const bench::json& result) {
+    return result.value("scene", "") + "/" + result.value("renderer", "") + "/" + result.value("loader", "");
+}
+
+// flags metrics that got worse than baseline * (1 + tolerance); tiny absolute
+// differences (timer noise, allocator slack) are ignored
+int CompareBaseline(bench::json& result, const bench::json& baseline, double tolerance, FILE* report) {
+    struct Metric { const char* name; double noise_floor; };
+    const Metric metrics[] = {{"render_ms", 2.0}, {"load_ms", 2.0}, {"bvh_build_ms", 2.0}, {"peak_rss_mib", 4.0}};
+
+    std::map<std::string, const bench::json*> previous;
+    for (const auto& c : baseline["cases"]) previous[CaseKey(c)] = &c;
+
+    bench::json regressions = bench::json::array();
+    std::fprintf(report, "\n%-36s %-14s %12s %12s %9s\n", "case", "metric", "baseline", "current", "change");
+    for (const auto& c : result["cases"]) {
+        auto it = previous.find(CaseKey(c));
+        if (it == previous.end() || c.contains("error")) continue;
+        const bench::json& before = *it->second;
+
+        for (const Metric& metric : metrics) {
+            if (!c.contains(metric.name) || !before.contains(metric.name)) continue;
+            double old_value = before[metric.name].get<double>();
+            double new_value = c[metric.name].get<double>();
+            double change = old_value > 0 ? (new_value - old_value) / old_value : 0.0;
+            bool regressed = new_value - old_value > std::max(tolerance * old_value, metric.noise_floor);
+            if (metric.name == std::string("render_ms") || regressed) {
+                std::fprintf(report, "%-36s %-14s %12.2f %12.2f %+8.1f%%%s\n", CaseKey(c).c_str(), metric.name,
+                             old_value, new_value, 100.0 * change, regressed ? "  REGRESSION" : "");
+            }
+            if (regressed) {
+                regressions.push_back({{"case", CaseKey(c)}, {"metric", metric.name},
+                                       {"baseline", old_value}, {"current", new_value}, {"change", change}});
+            }
+        }
+    }
+    result["baseline"] = {{"tolerance", tolerance}, {"regressions", regressions}};
+    return static_cast<int>(regressions.size());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    // no pinning: the renderers are multi-threaded and OpenMP must not start before fork()
+    bench::CpuSetup cpu = bench::PrepareCpu(options.set_governor, false);
+
+    bench::json result;
+    result["benchmark"] = "render";
+    result["config"] = {{"width", options.width}, {"height", options.height}, {"spp", options.spp},
+                        {"depth", options.depth}, {"seed", options.seed},
+                        {"bvh_builder", static_cast<int>(options.builder)},
+                        {"sampler", Sampler::TypeName(options.sampler)},
+                        {"light_samples", options.light_samples},
+                        {"shadow_cache", options.shadow_cache},
+                        {"denoise", options.denoise},
+                        {"aovs", options.aov_passes},
+                        {"image_format", ImageWriter::FormatName(options.image_format)}};
+    result["cpu"] = cpu.ToJSON();
+    result["cases"] = bench::json::array();
+
+    // with --json - stdout carries the results only, the tables go to stderr
+    FILE* report = options.json_out == "-" ? stderr : stdout;
+    std::fprintf(report, "%-36s %10s %10s %10s %10s %10s\n", "case", "load (ms)", "bvh (ms)", "render (ms)", "Mrays/s", "RSS (MiB)");
+    for (const Case& c : MakeCases(options)) {
+        bench::json r = RunIsolated(c, options);
+        if (r.contains("error")) {
+            std::fprintf(report, "%-36s %s\n", c.Key().c_str(), r["error"].get<std::string>().c_str());
+        } else {
+            std::fprintf(report, "%-36s %10.1f %10.1f %10.1f %10.3f %10.1f\n", c.Key().c_str(), r["load_ms"].get<double>(),
+                         r["bvh_build_ms"].get<double>(), r["render_ms"].get<double>(),
+                         r["mrays_per_s"].get<double>(), r["peak_rss_mib"].get<double>());
+        }
+        std::fflush(report);
+        result["cases"].push_back(r);
+    }
+
+    int regressions = 0;
+    if (!options.baseline.empty()) {
+        std::ifstream file(options.baseline);
+        bench::json baseline = bench::json::parse(file, nullptr, false);
+        if (baseline.is_discarded() || !baseline.contains("cases")) {
+            std::cerr << "Error: cannot read baseline " << options.baseline << std::endl;
+            return 1;
+        }
+        if (baseline.contains("config") && baseline["config"] != result["config"]) {
+            std::cerr << "Warning: baseline was recorded with a different configuration" << std::endl;
+        }
+        regressions = CompareBaseline(result, baseline, options.tolerance, report);
+        std::fprintf(report, "\n%d regression(s) beyond %.0f%%\n", regressions, 100.0 * options.tolerance);
+    }
+
+    if (!bench::WriteJSON(result, options.json_out)) return 1;
+    return regressions > 0 ? 2 : 0;
+}
@@ -6,52 +6,17 @@
 
 #include "../hpp/ParallelRenderer.hpp"
 #include <limits>
+#include <algorithm>
 #include <atomic>
+#include <string>
 #include <omp.h>
+#include "../../utils/hpp/Trace.hpp"
+#include "../../lights/hpp/ShadowCache.hpp"
 
 
 ParallelRenderer::ParallelRenderer() : Renderer() {}
 
-ParallelRenderer::ParallelRenderer(const ParallelRenderer& other) : Renderer(other) {}
-
-// Thread-safe ray color computation with full lighting
-Vector3 ParallelRenderer::RayColor(const Ray& r, const hittable_list& world, const Light_list& lights, int depth) {
-    // Too many bounces -> return black
-    if (depth <= 0) {
-        return Vector3(0, 0, 0);
-    }
-
-    hit_record rec;
-    double t_min = 0.001;
-    double t_max = infinity;
-    
-    // No hit -> background color
-    if (!world.hit(r, &t_min, &t_max, rec)) {
-        return Vector3(0, 0, 0);
-    }
-
-    if (rec.mat_ptr == nullptr) {
-        return Vector3(0, 0, 0);
-    }
-
-    Ray scattered;
-    Vector3 attenuation;
-    
-    // If material scatters the ray
-    if (rec.mat_ptr->scatter(r, rec, attenuation, scattered)) {
-        // Direct lighting from light sources
-        Vector3 direct_illumination(0, 0, 0);
-        lights.computeIllumination(rec, world, direct_illumination);
-        
-        // Indirect lighting (recursive bounces)
-        Vector3 indirect_illumination = RayColor(scattered, world, lights, depth - 1);
-        
-        // Combine: direct light * material color + indirect bounces * material color
-        return attenuation * (direct_illumination + indirect_illumination);
-    }
-
-    return Vector3(0, 0, 0);
-}
+ParallelRenderer::ParallelRenderer(const ParallelRenderer& other) : Renderer(other), tile_size(other.tile_size) {}
 
 void ParallelRenderer::Render(const Scene& scene, Image& image) {
     int nx = image.GetXsize();
@@ -60,44 +25,157 @@ void ParallelRenderer::Render(const Scene& scene, Image& image) {
     const auto& camera = scene.GetCamera();
     const auto& world = scene.GetObjects();
     const auto& lights = scene.GetLights();
+    lights.prepareSampling();
+    ShadowCache::Invalidate();
 
     int num_threads = omp_get_max_threads();
     std::cout << "ParallelRenderer: Starting render (" << nx << "x" << ny << ")..." << std::endl;
-    std::cout << "  Threads: " << num_threads << ", Samples: " << samples_per_pixel << ", Max depth: " << max_depth << std::endl;
-
-    std::atomic<int> rows_done(0);
-
-    // Parallelize outer loop with dynamic scheduling for load balancing
-    #pragma omp parallel for schedule(dynamic, 10)
-    for (int j = 0; j < ny; ++j) {
-        for (int i = 0; i < nx; ++i) {
-            Vector3 pixel_color(0, 0, 0);
-            
-            for (int s = 0; s < samples_per_pixel; ++s) {
-                // random_double() must be thread-safe (uses thread_local)
-                auto u = (i + random_double()) / (nx - 1);
-                auto v = (ny - 1 - j + random_double()) / (ny - 1);
-                Ray r = camera.GenerateRay(u, v);
-                pixel_color += RayColor(r, world, lights, max_depth);
-            }
-            
-            // Gamma correction and pixel write
-            // Each thread writes to unique pixel -> no race condition
-            auto r_ = sqrt(pixel_color.x / samples_per_pixel);
-            auto g_ = sqrt(pixel_color.y / samples_per_pixel);
-            auto b_ = sqrt(pixel_color.z / samples_per_pixel);
-
-            image.SetPixel(i, j, r_ * 255.99, g_ * 255.99, b_ * 255.99);
+    std::cout << "  Threads: " << num_threads << ", Samples: " << samples_per_pixel << " (" << Sampler::TypeName(sampler_type)
+              << "), Max depth: " << max_depth << std::endl;
+
+    TraceScope trace("render", "render");
+    trace.Arg("width", nx).Arg("height", ny);
+    BeginStats(nx, ny);
+    BeginAovs(scene, nx, ny);
+
+    // Square tiles handed out one at a time: a tile is small enough to balance the
+    // load at the end of the pass and keeps the rays of a thread spatially coherent
+    const int tiles_x = (nx + tile_size - 1) / tile_size;
+    const int tiles_y = (ny + tile_size - 1) / tile_size;
+    const int tile_count = tiles_x * tiles_y;
+    std::atomic<int> tiles_done(0);
+
+    #pragma omp parallel
+    {
+        // the calling thread keeps its own name, it works as omp thread 0
+        if (Trace::Enabled() && omp_get_thread_num() != 0) {
+            Trace::SetThreadName("omp worker " + std::to_string(omp_get_thread_num()));
         }
 
-        int done = ++rows_done;
-        if (done % 10 == 0 || done == ny) {
-            int percent = done * 100 / ny;
-            #pragma omp critical
-            {
-                std::cout << "  Progress: " << percent << "% (line " << done << "/" << ny << ")" << std::endl;
+        std::unique_ptr<Sampler> sampler = CreateSampler();
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int tile = 0; tile < tile_count; ++tile) {
+            const int x0 = (tile % tiles_x) * tile_size;
+            const int y0 = (tile / tiles_x) * tile_size;
+            const int x1 = std::min(x0 + tile_size, nx);
+            const int y1 = std::min(y0 + tile_size, ny);
+            TraceScope tile_trace("tile", "render");
+            tile_trace.Arg("x", x0).Arg("y", y0);
+
+            for (int j = y0; j < y1; ++j) {
+                for (int i = x0; i < x1; ++i) {
+                    Vector3 pixel_color(0, 0, 0);
+                    PixelProbe probe = BeginPixel();
+                    PixelFeatures pixel_features;
+                    SurfaceFeatures surface;
+
+                    for (int s = 0; s < samples_per_pixel; ++s) {
+                        Ray r = CameraRay(camera, i, j, s, nx, ny, *sampler);
+                        RT_STAT(primary_rays);
+                        surface.depth = 0.0;
+                        Vector3 sample = RayColor(r, world, lights, max_depth, *sampler, 0.0, CollectsSurfaces() ? &surface : nullptr);
+                        pixel_color += sample;
+                        if (CollectsSurfaces()) AddFeatureSample(pixel_features, sample, surface);
+                    }
+                    EndFeatures(pixel_features, pixel_color, i, j);
+
+                    // Gamma correction and pixel write
+                    // Each thread writes to unique pixel -> no race condition
+                    auto r_ = sqrt(pixel_color.x / samples_per_pixel);
+                    auto g_ = sqrt(pixel_color.y / samples_per_pixel);
+                    auto b_ = sqrt(pixel_color.z / samples_per_pixel);
+
+                    image.SetPixel(i, j, r_ * 255.99, g_ * 255.99, b_ * 255.99);
+                    EndPixel(probe, i, j);
+                }
+            }
+
+            int done = ++tiles_done;
+            int step = std::max(1, tile_count / 10);
+            if (done % step == 0 || done == tile_count) {
+                int percent = done * 100 / tile_count;
+                #pragma omp critical
+                {
+                    std::cout << "  Progress: " << percent << "% (tile " << done << "/" << tile_count << ")" << std::endl;
+                }
             }
         }
     }
+    FinishFrame(image);
     std::cout << "ParallelRenderer: Done." << std::endl;
+    EndStats();
+}
+
+bool ParallelRenderer::RenderTiles(const Scene& scene, TiledImageFile& output) {
+    BeginTiles(scene, output, "ParallelRenderer");
+    TraceScope trace("tiled render", "render");
+    trace.Arg("width", output.GetWidth()).Arg("height", output.GetHeight());
+
+    std::vector<int> tiles;
+    tiles.reserve(output.RemainingTiles());
+    for (int tile = 0; tile < output.TileCount(); ++tile) {
+        if (!output.IsTileDone(tile)) tiles.push_back(tile);
+    }
+    const int count = static_cast<int>(tiles.size());
+    std::atomic<int> tiles_done(0);
+    std::atomic<bool> failed(false);
+
+    #pragma omp parallel
+    {
+        if (Trace::Enabled() && omp_get_thread_num() != 0) {
+            Trace::SetThreadName("omp worker " + std::to_string(omp_get_thread_num()));
+        }
+        std::unique_ptr<Sampler> sampler = CreateSampler();
+        // the pixels in memory: one tile per thread
+        std::vector<unsigned char> rgb(static_cast<size_t>(output.GetTileSize()) * output.GetTileSize() * 3);
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int k = 0; k < count; ++k) {
+            if (failed) continue;
+            int x0, y0, x1, y1;
+            output.TileRect(tiles[k], x0, y0, x1, y1);
+            TraceScope tile_trace("tile", "render");
+            tile_trace.Arg("x", x0).Arg("y", y0);
+
+            RenderRect(scene, x0, y0, x1, y1, output.GetWidth(), output.GetHeight(), *sampler, rgb.data());
+            if (!output.WriteTile(tiles[k], rgb.data())) failed = true;
+
+            int done = ++tiles_done;
+            #pragma omp critical
+            ReportTile(done, count);
+        }
+    }
+    const bool ok = output.Flush() && !failed;
+    std::cout << "ParallelRenderer: " << (ok ? "Done." : "Output write failed.") << std::endl;
+    EndStats();
+    return ok;
+}
+
+void ParallelRenderer::RenderPass(const Scene& scene, RenderCheckpoint& state, int pass_samples) {
+    const int nx = state.GetWidth();
+    const int ny = state.GetHeight();
+    scene.GetLights().prepareSampling();
+    ShadowCache::Invalidate();
+    TraceScope trace("render pass", "render");
+    trace.Arg("samples", pass_samples);
+
+    const int tiles_x = (nx + tile_size - 1) / tile_size;
+    const int tiles_y = (ny + tile_size - 1) / tile_size;
+    const int tile_count = tiles_x * tiles_y;
+
+    #pragma omp parallel
+    {
+        if (Trace::Enabled() && omp_get_thread_num() != 0) {
+            Trace::SetThreadName("omp worker " + std::to_string(omp_get_thread_num()));
+        }
+        std::unique_ptr<Sampler> sampler = CreateSampler();
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int tile = 0; tile < tile_count; ++tile) {
+            const int x0 = (tile % tiles_x) * tile_size;
+            const int y0 = (tile / tiles_x) * tile_size;
+            AccumulateRect(scene, state, x0, y0, std::min(x0 + tile_size, nx), std::min(y0 + tile_size, ny), pass_samples, *sampler);
+        }
+    }
 }
@@ -0,0 +1,480 @@
+/*
+    RenderDaemon.cpp
+    Scene cache, job queue with preemption, render thread and the client calls
+*/
+
+#include "../hpp/RenderDaemon.hpp"
+#include "../hpp/SimpleRenderer.hpp"
+#include "../../scene/hpp/SceneCompiler.hpp"
+#include "../../scene/hpp/Sceneloader.hpp"
+#include "../../lights/hpp/ShadowCache.hpp"
+#include "../../utils/hpp/ImageWriter.hpp"
+#include "../../utils/hpp/LocalSocket.hpp"
+#include "../../utils/hpp/Trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// client -> daemon: Submit (answered by Done once the image is written) or Stop (answered at once)
+enum MessageType : uint32_t { kSubmit = 1, kStop, kDone };
+
+// followed by the scene path and the output path
+struct JobRecord {
+    int32_t width, height;
+    int32_t samples_per_pixel;
+    int32_t max_depth;
+    int32_t priority;
+    uint32_t sampler;
+    uint32_t seed;
+    uint32_t set_look_from, set_look_at;
+    double look_from[3], look_at[3];
+    double vfov;
+    uint32_t scene_length, output_length;
+};
+
+// followed by the message
+struct ResultRecord {
+    int32_t ok, cached, preemptions;
+    uint32_t message_length;
+    double queued_ms, load_ms, render_ms, save_ms;
+};
+
+double Milliseconds(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+std::string PackJob(const RenderDaemon::Job& job) {
+    JobRecord r{};
+    r.width = job.width;
+    r.height = job.height;
+    r.samples_per_pixel = job.samples_per_pixel;
+    r.max_depth = job.max_depth;
+    r.priority = job.priority;
+    r.sampler = static_cast<uint32_t>(job.sampler);
+    r.seed = job.seed;
+    r.set_look_from = job.set_look_from ? 1 : 0;
+    r.set_look_at = job.set_look_at ? 1 : 0;
+    for (int i = 0; i < 3; i++) {
+        r.look_from[i] = job.look_from[i];
+        r.look_at[i] = job.look_at[i];
+    }
+    r.vfov = job.vfov;
+    r.scene_length = static_cast<uint32_t>(job.scene_file.size());
+    r.output_length = static_cast<uint32_t>(job.output.size());
+    std::string payload;
+    LocalSocket::Append(payload, r);
+    return payload + job.scene_file + job.output;
+}
+
+bool UnpackJob(const std::string& payload, RenderDaemon::Job& job) {
+    JobRecord r;
+    size_t offset = 0;
+    if (!LocalSocket::Read(payload, offset, r) || payload.size() != offset + r.scene_length + r.output_length) return false;
+    job.width = r.width;
+    job.height = r.height;
+    job.samples_per_pixel = r.samples_per_pixel;
+    job.max_depth = r.max_depth;
+    job.priority = r.priority;
+    job.sampler = static_cast<SamplerType>(r.sampler);
+    job.seed = r.seed;
+    job.set_look_from = r.set_look_from != 0;
+    job.set_look_at = r.set_look_at != 0;
+    job.look_from = Vector3(r.look_from[0], r.look_from[1], r.look_from[2]);
+    job.look_at = Vector3(r.look_at[0], r.look_at[1], r.look_at[2]);
+    job.vfov = r.vfov;
+    job.scene_file = payload.substr(offset, r.scene_length);
+    job.output = payload.substr(offset + r.scene_length, r.output_length);
+    return job.width > 0 && job.height > 0 && job.samples_per_pixel > 0 && job.max_depth > 0 && r.sampler < static_cast<uint32_t>(kSamplerTypes);
+}
+
+std::string PackResult(const RenderDaemon::Result& result) {
+    ResultRecord r{result.ok ? 1 : 0, result.cached ? 1 : 0, result.preemptions, static_cast<uint32_t>(result.message.size()),
+                   result.queued_ms, result.load_ms, result.render_ms, result.save_ms};
+    std::string payload;
+    LocalSocket::Append(payload, r);
+    return payload + result.message;
+}
+
+bool UnpackResult(const std::string& payload, RenderDaemon::Result& result) {
+    ResultRecord r;
+    size_t offset = 0;
+    if (!LocalSocket::Read(payload, offset, r) || payload.size() != offset + r.message_length) return false;
+    result.ok = r.ok != 0;
+    result.cached = r.cached != 0;
+    result.preemptions = r.preemptions;
+    result.queued_ms = r.queued_ms;
+    result.load_ms = r.load_ms;
+    result.render_ms = r.render_ms;
+    result.save_ms = r.save_ms;
+    result.message = payload.substr(offset);
+    return true;
+}
+
+// Loaded scenes, most recently used first. An entry is reused while its file keeps the same
+// size and modification time; jobs hold their scene, so eviction never pulls it from under them
+class SceneCache {
+public:
+    explicit SceneCache(size_t capacity) : m_capacity(std::max<size_t>(capacity, 1)) {}
+
+    std::shared_ptr<const Scene> Get(const std::string& filename, bool& cached) {
+        cached = false;
+        struct stat st;
+        if (stat(filename.c_str(), &st) != 0) return nullptr;
+
+        auto it = std::find_if(m_entries.begin(), m_entries.end(), [&](const Entry& e) { return e.filename == filename; });
+        if (it != m_entries.end()) {
+            if (it->size == st.st_size && it->mtime_sec == st.st_mtim.tv_sec && it->mtime_nsec == st.st_mtim.tv_nsec) {
+                m_entries.splice(m_entries.begin(), m_entries, it);
+                cached = true;
+                return it->scene;
+            }
+            m_entries.erase(it);    // edited since: load it again
+        }
+
+        // a scene that failed to load is never cached, the next job tries again
+        auto scene = std::make_shared<Scene>();
+        const bool loaded = SceneCompiler::IsCompiledScene(filename) ? SceneCompiler::Load(filename, *scene, 16.0 / 9.0, true)
+                                                                     : SceneLoader::LoadJSONStream(filename, *scene);
+        if (!loaded) return nullptr;
+        scene->GetLights().prepareSampling();
+
+        m_entries.push_front({filename, st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec, scene});
+        if (m_entries.size() > m_capacity) m_entries.pop_back();
+        return scene;
+    }
+
+private:
+    struct Entry {
+        std::string filename;
+        off_t size;
+        time_t mtime_sec;
+        long mtime_nsec;
+        std::shared_ptr<const Scene> scene;
+    };
+
+    size_t m_capacity;
+    std::list<Entry> m_entries;
+};
+
+// a job and its progress, kept across preemptions
+struct PendingJob {
+    RenderDaemon::Job job;
+    RenderDaemon::Result result;
+    int client = -1;
+    uint64_t sequence = 0;
+    Clock::time_point queued;      // last time it entered the queue
+
+    bool started = false;
+    std::shared_ptr<const Scene> scene;
+    Camera camera;
+    ImageWriter::Frame frame;
+    std::vector<int> tiles;     // not rendered yet
+};
+
+class Server {
+public:
+    explicit Server(const RenderDaemon::Options& options) : m_options(options), m_cache(static_cast<size_t>(options.cache_scenes)) {}
+
+    int Run(const std::string& socket_path);
+
+private:
+    void Enqueue(std::unique_ptr<PendingJob> job);
+    void Dispatch();
+    bool Start(PendingJob& job);
+    bool RunSlice(PendingJob& job);
+    void Finish(PendingJob& job);
+    void Reply(PendingJob& job);
+
+    RenderDaemon::Options m_options;
+    SceneCache m_cache;             // render thread only
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<std::unique_ptr<PendingJob>> m_queue;
+    uint64_t m_sequence = 0;
+    bool m_stop = false;
+    bool m_busy = false;            // a job is on the render thread
+    int m_runningPriority = 0;
+    std::atomic<bool> m_preempt{false};
+};
+
+int Server::Run(const std::string& socket_path) {
+    int listen_fd = LocalSocket::Listen(socket_path);
+    if (listen_fd < 0) return 1;
+    std::cout << "RenderDaemon: listening on " << socket_path << " (" << m_options.cache_scenes << " cached scenes)" << std::endl;
+
+    std::thread render_thread(&Server::Dispatch, this);
+    // connected, request not whole yet: read without blocking, a client that stops
+    // mid-request only holds its own connection
+    struct Client {
+        int fd;
+        std::string inbox;
+    };
+    std::vector<Client> clients;
+    bool stop = false;
+    while (!stop) {
+        std::vector<pollfd> fds;
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (const Client& c : clients) fds.push_back({c.fd, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), -1) < 0) continue;
+
+        if (fds[0].revents & POLLIN) {
+            int fd = LocalSocket::Accept(listen_fd);
+            if (fd >= 0 && LocalSocket::SetNonBlocking(fd)) clients.push_back({fd, std::string()});
+            else LocalSocket::Close(fd);
+        }
+        for (size_t k = 1; k < fds.size(); k++) {
+            if (!(fds[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            const int fd = fds[k].fd;
+            auto client = std::find_if(clients.begin(), clients.end(), [fd](const Client& c) { return c.fd == fd; });
+            bool ok = LocalSocket::ReceiveAvailable(fd, client->inbox);
+            LocalSocket::Message message;
+            bool broken = false;
+            const bool whole = ok && LocalSocket::Extract(client->inbox, message, broken);
+            if (ok && !whole && !broken) continue;
+            clients.erase(client);
+
+            auto job = std::make_unique<PendingJob>();
+            if (!whole) {
+                LocalSocket::Close(fd);
+            } else if (message.type == kStop) {
+                RenderDaemon::Result result;
+                result.ok = true;
+                LocalSocket::Send(fd, kDone, PackResult(result));
+                LocalSocket::Close(fd);
+                stop = true;
+            } else if (message.type == kSubmit && UnpackJob(message.payload, job->job)) {
+                // the socket now belongs to the job, it is answered once the image is written
+                job->client = fd;
+                Enqueue(std::move(job));
+            } else {
+                job->client = fd;
+                job->result.message = "malformed request";
+                Reply(*job);
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_preempt = true;
+    }
+    m_wake.notify_all();
+    render_thread.join();
+    for (const Client& c : clients) LocalSocket::Close(c.fd);
+    LocalSocket::Close(listen_fd);
+    unlink(socket_path.c_str());
+    std::cout << "RenderDaemon: stopped." << std::endl;
+    return 0;
+}
+
+void Server::Enqueue(std::unique_ptr<PendingJob> job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job->sequence = m_sequence++;
+        job->queued = Clock::now();
+        // the running job gives the threads up after its current tiles
+        if (m_busy && job->job.priority > m_runningPriority) m_preempt = true;
+        m_queue.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+}
+
+void Server::Dispatch() {
+    if (Trace::Enabled()) Trace::SetThreadName("render daemon");
+    for (;;) {
+        std::unique_ptr<PendingJob> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop) break;
+            // highest priority, then oldest (a preempted job keeps its place)
+            auto next = std::min_element(m_queue.begin(), m_queue.end(), [](const auto& a, const auto& b) {
+                if (a->job.priority != b->job.priority) return a->job.priority > b->job.priority;
+                return a->sequence < b->sequence;
+            });
+            job = std::move(*next);
+            m_queue.erase(next);
+            job->result.queued_ms += Milliseconds(job->queued);
+            m_busy = true;
+            m_runningPriority = job->job.priority;
+            m_preempt = false;
+        }
+
+        // a client that hung up does not want its image any more
+        pollfd client = {job->client, POLLIN, 0};
+        bool cancelled = poll(&client, 1, 0) > 0;
+        bool finished = false;
+        if (cancelled) {
+            std::cout << "RenderDaemon: " << job->job.output << " cancelled by its client" << std::endl;
+            LocalSocket::Close(job->client);
+        } else if (!job->started && !Start(*job)) {
+            Reply(*job);
+        } else {
+            finished = RunSlice(*job);
+            if (finished) Finish(*job);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_busy = false;
+        if (!cancelled && job->started && !finished) {
+            job->result.preemptions++;
+            job->queued = Clock::now();
+            m_queue.push_back(std::move(job));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& job : m_queue) {
+        job->result.message = "daemon stopped";
+        Reply(*job);
+    }
+    m_queue.clear();
+}
+
+bool Server::Start(PendingJob& job) {
+    TraceScope trace("daemon job start", "render");
+    const RenderDaemon::Job& j = job.job;
+    auto t1 = Clock::now();
+    job.scene = m_cache.Get(j.scene_file, job.result.cached);
+    job.result.load_ms = Milliseconds(t1);
+    ImageFormat format;
+    if (!job.scene) {
+        job.result.message = "cannot load " + j.scene_file;
+        return false;
+    }
+    if (!ImageWriter::FormatFromFilename(j.output, format)) {
+        job.result.message = "unknown image format for " + j.output;
+        return false;
+    }
+
+    // the scene camera at the job aspect ratio, moved if asked
+    job.camera = job.scene->GetCamera();
+    const Camera& c = job.camera;
+    job.camera.Setup(j.set_look_from ? j.look_from : c.look_from, j.set_look_at ? j.look_at : c.look_at, c.view_up,
+                     j.vfov > 0.0 ? j.vfov : c.vfov_deg, static_cast<double>(j.width) / j.height, c.aperture, c.focus_dist);
+
+    job.frame.width = j.width;
+    job.frame.height = j.height;
+    job.frame.rgb.assign(static_cast<size_t>(j.width) * j.height * 3, 0.0f);
+    const int tile_size = std::max(m_options.tile_size, 1);
+    const int tiles = ((j.width + tile_size - 1) / tile_size) * ((j.height + tile_size - 1) / tile_size);
+    job.tiles.resize(tiles);
+    for (int t = 0; t < tiles; t++) job.tiles[t] = t;
+    job.started = true;
+    return true;
+}
+
+bool Server::RunSlice(PendingJob& job) {
+    TraceScope trace("daemon job", "render");
+    const RenderDaemon::Job& j = job.job;
+    auto t1 = Clock::now();
+
+    SimpleRenderer renderer;
+    renderer.SetSamplesPerPixel(j.samples_per_pixel);
+    renderer.SetMaxDepth(j.max_depth);
+    renderer.SetSampler(j.sampler);
+    renderer.SetSamplerSeed(j.seed);
+    // the per-thread occluders may come from the scene of the previous job
+    ShadowCache::Invalidate();
+
+    const int tile_size = std::max(m_options.tile_size, 1);
+    const int tiles_x = (j.width + tile_size - 1) / tile_size;
+    const int count = static_cast<int>(job.tiles.size());
+    std::vector<char> done(count, 0);
+
+    #pragma omp parallel
+    {
+        std::vector<double> sums(static_cast<size_t>(tile_size) * tile_size * 3);
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int k = 0; k < count; ++k) {
+            if (m_preempt) continue;
+            const int x0 = (job.tiles[k] % tiles_x) * tile_size;
+            const int y0 = (job.tiles[k] / tiles_x) * tile_size;
+            const int x1 = std::min(x0 + tile_size, j.width);
+            const int y1 = std::min(y0 + tile_size, j.height);
+            renderer.SampleRect(*job.scene, job.camera, x0, y0, x1, y1, j.width, j.height, 0, j.samples_per_pixel, sums.data());
+
+            const double* sum = sums.data();
+            for (int y = y0; y < y1; y++) {
+                float* out = &job.frame.rgb[(static_cast<size_t>(y) * j.width + x0) * 3];
+                for (int i = 0; i < (x1 - x0) * 3; i++) out[i] = static_cast<float>(std::sqrt(*sum++ / j.samples_per_pixel) * 255.99);
+            }
+            done[k] = 1;
+        }
+    }
+
+    std::vector<int> left;
+    for (int k = 0; k < count; k++) {
+        if (!done[k]) left.push_back(job.tiles[k]);
+    }
+    job.tiles.swap(left);
+    job.result.render_ms += Milliseconds(t1);
+    return job.tiles.empty();
+}
+
+void Server::Finish(PendingJob& job) {
+    auto t1 = Clock::now();
+    ImageFormat format = ImageFormat::PPM;
+    ImageWriter::FormatFromFilename(job.job.output, format);
+    job.result.ok = ImageWriter::Write(job.frame, job.job.output, format);
+    job.result.save_ms = Milliseconds(t1);
+    if (!job.result.ok) job.result.message = "cannot write " + job.job.output;
+
+    std::cout << "RenderDaemon: " << job.job.output << " (" << job.job.width << "x" << job.job.height << ", "
+              << job.job.samples_per_pixel << " spp, priority " << job.job.priority << ") "
+              << (job.result.cached ? "cached scene" : "scene loaded in " + std::to_string(job.result.load_ms) + " ms")
+              << ", render " << job.result.render_ms << " ms, " << job.result.preemptions << " preemptions" << std::endl;
+    Reply(job);
+}
+
+void Server::Reply(PendingJob& job) {
+    LocalSocket::Send(job.client, kDone, PackResult(job.result));
+    LocalSocket::Close(job.client);
+    job.client = -1;
+}
+
+} // namespace
+
+int RenderDaemon::Serve(const std::string& socket_path, const Options& options) {
+    Server server(options);
+    return server.Run(socket_path);
+}
+
+bool RenderDaemon::Submit(const std::string& socket_path, const Job& job, Result& result) {
+    int fd = LocalSocket::Connect(socket_path);
+    if (fd < 0) return false;
+    LocalSocket::Message reply;
+    bool ok = LocalSocket::Send(fd, kSubmit, PackJob(job)) && LocalSocket::Receive(fd, reply) && reply.type == kDone &&
+              UnpackResult(reply.payload, result);
+    LocalSocket::Close(fd);
+    return ok;
+}
+
+bool RenderDaemon::Stop(const std::string& socket_path) {
+    int fd = LocalSocket::Connect(socket_path);
+    if (fd < 0) return false;
+    LocalSocket::Message reply;
+    bool ok = LocalSocket::Send(fd, kStop, nullptr, 0) && LocalSocket::Receive(fd, reply) && reply.type == kDone;
+    LocalSocket::Close(fd);
+    return ok;
+}
@@ -0,0 +1,269 @@
+/*
+    Renderer.cpp
+    Lighting model shared by the renderers and render statistics
+*/
+
+#include "../hpp/Renderer.hpp"
+#include "../../objects/hpp/Mesh.hpp"
+#include "../../lights/hpp/ShadowCache.hpp"
+
+#include <algorithm>
+
+// multiple importance sampling weight of the strategy with pdf a against the one with pdf b
+static double PowerHeuristic(double a, double b) {
+    return a * a / (a * a + b * b);
+}
+
+// Computes color for a ray with full lighting model
+Vector3 Renderer::RayColor(const Ray& r, const hittable_list& world, const Light_list& lights, int depth, Sampler& sampler,
+                           double bsdf_pdf, SurfaceFeatures* surface) {
+    // Too many bounces -> return black
+    if (depth <= 0) {
+        return Vector3(0, 0, 0);
+    }
+
+    hit_record rec;
+    double t_min = 0.001;
+    double t_max = infinity;
+
+    // No hit -> background color (black for now)
+    if (!world.hit(r, &t_min, &t_max, rec)) {
+        return Vector3(0, 0, 0);
+    }
+    RT_STAT(hits);
+
+    if (rec.mat_ptr == nullptr) {
+        return Vector3(0, 0, 0);
+    }
+
+    if (surface) {
+        surface->albedo = rec.mat_ptr->baseColor();
+        surface->normal = rec.normal;
+        surface->depth = rec.t * r.direction().length();
+        surface->object = rec.object;
+        surface->material = rec.mat_ptr.get();
+    }
+
+    // Emitted light, weighted against light sampling when the previous bounce sampled it too
+    Vector3 emitted = rec.mat_ptr->emitted(r, rec);
+    if (bsdf_pdf > 0.0) {
+        if (const AreaLight* light = lights.area_lights.Find(rec.object)) {
+            emitted = emitted * PowerHeuristic(bsdf_pdf, lights.area_lights.Pdf(*light, r.origin(), rec));
+        }
+    }
+
+    Ray scattered;
+    Vector3 attenuation;
+
+    // If material scatters the ray (bounce 0 is the primary hit)
+    sampler.StartBounce(max_depth - depth);
+    if (rec.mat_ptr->scatter(r, rec, attenuation, scattered, sampler)) {
+        // Direct lighting from light sources
+        Vector3 direct_illumination(0, 0, 0);
+        if (lights.treeReady() && lights.tree().Size() > static_cast<size_t>(exhaustive_lights)) {
+            lights.sampleIllumination(rec, world, sampler.Get1D(Sampler::kLightTree), light_samples, direct_illumination);
+        } else {
+            lights.computeIllumination(rec, world, direct_illumination);
+        }
+
+        // Direct lighting from emissive primitives (next-event estimation)
+        if (!lights.area_lights.Empty()) {
+            double u, v;
+            sampler.Get2D(Sampler::kLightPosition, u, v);
+            LightSample ls;
+            if (lights.area_lights.Sample(rec.p, sampler.Get1D(Sampler::kLightChoice), u, v, ls)) {
+                double light_bsdf_pdf = rec.mat_ptr->scatteringPdf(r, rec, ls.wi);
+                if (light_bsdf_pdf > 0.0) {
+                    Ray shadow_ray(rec.p, ls.wi);
+                    hit_record shadow_rec;
+                    double s_min = 0.001;
+                    double s_max = ls.distance * (1.0 - 1e-4);
+
+                    RT_STAT(shadow_rays);
+                    if (!world.hit(shadow_ray, &s_min, &s_max, shadow_rec)) {
+                        // the bsdf strategy can't reach the light on the last bounce
+                        double w = depth > 1 ? PowerHeuristic(ls.pdf, light_bsdf_pdf) : 1.0;
+                        direct_illumination += ls.radiance * (w * light_bsdf_pdf / ls.pdf);
+                    } else {
+                        RT_STAT(hits);
+                    }
+                }
+            }
+        }
+
+        // Indirect lighting (recursive bounces)
+        if (depth > 1) RT_STAT(bounce_rays);
+        double scattered_pdf = rec.mat_ptr->scatteringPdf(r, rec, scattered.direction());
+        Vector3 indirect_illumination = RayColor(scattered, world, lights, depth - 1, sampler, scattered_pdf);
+
+        // Combine: direct light * material color + indirect bounces * material color
+        return emitted + attenuation * (direct_illumination + indirect_illumination);
+    }
+
+    // Material absorbs all light (emitters only emit)
+    return emitted;
+}
+
+void Renderer::BeginStats(int width, int height) {
+    stats_start = RenderStats::Snapshot();
+    if (cost_map) cost_map->Resize(width, height);
+    features = feature_buffers ? feature_buffers : (denoise ? &own_features : nullptr);
+    if (features) features->Resize(width, height);
+    render_start = std::chrono::steady_clock::now();
+}
+
+void Renderer::BeginAovs(const Scene& scene, int width, int height) {
+    object_ids.clear();
+    material_ids.clear();
+    if (!aov_buffers) return;
+    aov_buffers->Resize(width, height);
+
+    if (aov_buffers->Has(Aov::ObjectId)) {
+        const auto& primitives = scene.GetPrimitives().objects;
+        object_ids.reserve(primitives.size());
+        for (size_t i = 0; i < primitives.size(); i++) {
+            const uint32_t id = static_cast<uint32_t>(i + 1);
+            object_ids[primitives[i].get()] = id;
+            // the triangles of a mesh report themselves as the hit object
+            if (const Mesh* mesh = dynamic_cast<const Mesh*>(primitives[i].get())) {
+                for (const auto& triangle : mesh->triangles) object_ids[triangle.get()] = id;
+            }
+        }
+    }
+    if (aov_buffers->Has(Aov::MaterialId)) {
+        const auto& materials = scene.GetMaterials().GetAll();
+        for (size_t i = 0; i < materials.size(); i++) material_ids[materials[i].get()] = static_cast<uint32_t>(i + 1);
+    }
+}
+
+void Renderer::EndFeatures(const PixelFeatures& pixel, const Vector3& color_sum, int x, int y) const {
+    if (!CollectsSurfaces()) return;
+    const double n = samples_per_pixel;
+    Vector3 mean = color_sum / n;
+    double luminance = 0.2126 * mean.x + 0.7152 * mean.y + 0.0722 * mean.z;
+    // variance of the mean, what the denoiser compares neighbours against
+    double variance = std::max(pixel.luminance2 / n - luminance * luminance, 0.0) / n;
+
+    Vector3 albedo(0, 0, 0), normal(0, 0, 0);
+    double depth = 0.0;
+    if (pixel.hits > 0) {
+        albedo = pixel.albedo / pixel.hits;
+        double length = pixel.normal.length();
+        if (length > 0.0) normal = pixel.normal / length;
+        depth = pixel.depth / pixel.hits;
+    }
+    if (features) features->Set(x, y, mean, variance, albedo, normal, depth);
+    if (!aov_buffers) return;
+
+    AovBuffers& aovs = *aov_buffers;
+    if (aovs.Has(Aov::Color)) aovs.SetColor(x, y, mean);
+    if (aovs.Has(Aov::Albedo)) aovs.SetAlbedo(x, y, albedo);
+    if (aovs.Has(Aov::Normal)) aovs.SetNormal(x, y, normal);
+    if (aovs.Has(Aov::Depth)) aovs.SetDepth(x, y, depth);
+    if (aovs.Has(Aov::ObjectId)) {
+        auto it = object_ids.find(pixel.object);
+        aovs.SetObjectId(x, y, it != object_ids.end() ? it->second : 0);
+    }
+    if (aovs.Has(Aov::MaterialId)) {
+        auto it = material_ids.find(pixel.material);
+        aovs.SetMaterialId(x, y, it != material_ids.end() ? it->second : 0);
+    }
+    if (aovs.Has(Aov::SampleCount)) aovs.SetSampleCount(x, y, static_cast<uint32_t>(samples_per_pixel));
+}
+
+void Renderer::FinishFrame(Image& image) {
+    if (denoise && features) Denoiser::Apply(*features, denoise_options, image);
+}
+
+void Renderer::EndStats() {
+    last_render_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - render_start).count();
+    last_stats = RenderStats::Snapshot();
+    last_stats -= stats_start;
+    RenderStats::Print(std::cout, last_stats, last_render_ms);
+}
+
+void Renderer::RenderRect(const Scene& scene, int x0, int y0, int x1, int y1, int nx, int ny, Sampler& sampler, unsigned char* rgb) {
+    const auto& camera = scene.GetCamera();
+    const auto& world = scene.GetObjects();
+    const auto& lights = scene.GetLights();
+
+    for (int j = y0; j < y1; ++j) {
+        for (int i = x0; i < x1; ++i) {
+            Vector3 pixel_color(0, 0, 0);
+            for (int s = 0; s < samples_per_pixel; ++s) {
+                Ray r = CameraRay(camera, i, j, s, nx, ny, sampler);
+                RT_STAT(primary_rays);
+                pixel_color += RayColor(r, world, lights, max_depth, sampler);
+            }
+            const double sums[3] = {pixel_color.x, pixel_color.y, pixel_color.z};
+            for (double sum : sums) {
+                double value = sqrt(sum / samples_per_pixel) * 255.99;
+                *rgb++ = static_cast<unsigned char>(std::min(255.0, std::max(0.0, value)));
+            }
+        }
+    }
+}
+
+void Renderer::BeginTiles(const Scene& scene, const TiledImageFile& output, const char* name) {
+    scene.GetLights().prepareSampling();
+    ShadowCache::Invalidate();
+
+    std::cout << name << ": Starting tiled render (" << output.GetWidth() << "x" << output.GetHeight() << ", "
+              << output.RemainingTiles() << "/" << output.TileCount() << " tiles of " << output.GetTileSize() << " px left)..." << std::endl;
+    std::cout << "  Samples: " << samples_per_pixel << " (" << Sampler::TypeName(sampler_type) << "), Max depth: " << max_depth << std::endl;
+    // per-pixel buffers would take the memory the tiles are saving
+    BeginStats(0, 0);
+}
+
+void Renderer::ReportTile(int done, int count) const {
+    int step = std::max(1, count / 10);
+    if (done % step == 0 || done == count) {
+        std::cout << "  Progress: " << done * 100 / count << "% (tile " << done << "/" << count << ")" << std::endl;
+    }
+}
+
+void Renderer::AccumulateRect(const Scene& scene, RenderCheckpoint& state, int x0, int y0, int x1, int y1, int pass_samples, Sampler& sampler) {
+    const auto& camera = scene.GetCamera();
+    const auto& world = scene.GetObjects();
+    const auto& lights = scene.GetLights();
+    const int nx = state.GetWidth(), ny = state.GetHeight();
+    const uint32_t target = static_cast<uint32_t>(samples_per_pixel);
+
+    for (int j = y0; j < y1; ++j) {
+        for (int i = x0; i < x1; ++i) {
+            uint32_t& count = state.Count(i, j);
+            double* sum = state.Sum(i, j);
+            const uint32_t end = std::min(target, count + static_cast<uint32_t>(pass_samples));
+            // summed one sample at a time, in order, exactly as Render() does
+            for (; count < end; ++count) {
+                Ray r = CameraRay(camera, i, j, static_cast<int>(count), nx, ny, sampler);
+                RT_STAT(primary_rays);
+                Vector3 sample = RayColor(r, world, lights, max_depth, sampler);
+                sum[0] += sample.x;
+                sum[1] += sample.y;
+                sum[2] += sample.z;
+            }
+        }
+    }
+}
+
+void Renderer::SampleRect(const Scene& scene, const Camera& camera, int x0, int y0, int x1, int y1, int nx, int ny, int s0, int s1,
+                          double* sums) {
+    const auto& world = scene.GetObjects();
+    const auto& lights = scene.GetLights();
+    std::unique_ptr<Sampler> sampler = CreateSampler();
+
+    for (int j = y0; j < y1; ++j) {
+        for (int i = x0; i < x1; ++i) {
+            Vector3 sum(0, 0, 0);
+            for (int s = s0; s < s1; ++s) {
+                Ray r = CameraRay(camera, i, j, s, nx, ny, *sampler);
+                RT_STAT(primary_rays);
+                sum += RayColor(r, world, lights, max_depth, *sampler);
+            }
+            *sums++ = sum.x;
+            *sums++ = sum.y;
+            *sums++ = sum.z;
+        }
+    }
+}
@@ -6,51 +6,13 @@
 
 #include "../hpp/SimpleRenderer.hpp"
 #include <limits>
+#include "../../utils/hpp/Trace.hpp"
+#include "../../lights/hpp/ShadowCache.hpp"
 
 SimpleRenderer::SimpleRenderer() : Renderer() {}
 
 SimpleRenderer::SimpleRenderer(const SimpleRenderer& other) : Renderer(other) {}
 
-// Computes color for a ray with full lighting model
-Vector3 SimpleRenderer::RayColor(const Ray& r, const hittable_list& world, const Light_list& lights, int depth) {
-    // Too many bounces -> return black
-    if (depth <= 0) {
-        return Vector3(0, 0, 0);
-    }
-
-    hit_record rec;
-    double t_min = 0.001;
-    double t_max = infinity;
-    
-    // No hit -> background color (black for now)
-    if (!world.hit(r, &t_min, &t_max, rec)) {
-        return Vector3(0, 0, 0);
-    }
-
-    if (rec.mat_ptr == nullptr) {
-        return Vector3(0, 0, 0);
-    }
-
-    Ray scattered;
-    Vector3 attenuation;
-    
-    // If material scatters the ray
-    if (rec.mat_ptr->scatter(r, rec, attenuation, scattered)) {
-        // Direct lighting from light sources
-        Vector3 direct_illumination(0, 0, 0);
-        lights.computeIllumination(rec, world, direct_illumination);
-        
-        // Indirect lighting (recursive bounces)
-        Vector3 indirect_illumination = RayColor(scattered, world, lights, depth - 1);
-        
-        // Combine: direct light * material color + indirect bounces * material color
-        return attenuation * (direct_illumination + indirect_illumination);
-    }
-
-    // Material absorbs all light
-    return Vector3(0, 0, 0);
-}
-
 void SimpleRenderer::Render(const Scene& scene, Image& image) {
     int nx = image.GetXsize();
     int ny = image.GetYsize();
@@ -59,9 +21,16 @@ void SimpleRenderer::Render(const Scene& scene, Image& image) {
     const auto& camera = scene.GetCamera();
     const auto& world = scene.GetObjects();
     const auto& lights = scene.GetLights();
+    lights.prepareSampling();
+    ShadowCache::Invalidate();
 
     std::cout << "SimpleRenderer: Starting render (" << nx << "x" << ny << ")..." << std::endl;
-    std::cout << "  Samples: " << samples_per_pixel << ", Max depth: " << max_depth << std::endl;
+    std::cout << "  Samples: " << samples_per_pixel << " (" << Sampler::TypeName(sampler_type) << "), Max depth: " << max_depth << std::endl;
+    TraceScope trace("render", "render");
+    trace.Arg("width", nx).Arg("height", ny);
+    BeginStats(nx, ny);
+    BeginAovs(scene, nx, ny);
+    std::unique_ptr<Sampler> sampler = CreateSampler();
     
     for (int j = 0; j < ny; ++j) {
         // Progress indicator every 10 lines
@@ -69,17 +38,26 @@ void SimpleRenderer::Render(const Scene& scene, Image& image) {
             std::cout << "  Progress: " << (j * 100 / ny) << "% (line " << j << "/" << ny << ")" << std::endl;
         }
         
+        TraceScope row_trace("row", "render");
+        row_trace.Arg("y", j);
+
         for (int i = 0; i < nx; ++i) {
             Vector3 pixel_color(0, 0, 0);
+            PixelProbe probe = BeginPixel();
+            PixelFeatures pixel_features;
+            SurfaceFeatures surface;
             
             // Antialiasing: average multiple samples per pixel
             for (int s = 0; s < samples_per_pixel; ++s) {
-                auto u = (i + random_double()) / (nx - 1);
-                auto v = (ny - 1 - j + random_double()) / (ny - 1);
-                Ray r = camera.GenerateRay(u, v);
+                Ray r = CameraRay(camera, i, j, s, nx, ny, *sampler);
+                RT_STAT(primary_rays);
     
-                pixel_color += RayColor(r, world, lights, max_depth);
+                surface.depth = 0.0;
+                Vector3 sample = RayColor(r, world, lights, max_depth, *sampler, 0.0, CollectsSurfaces() ? &surface : nullptr);
+                pixel_color += sample;
+                if (CollectsSurfaces()) AddFeatureSample(pixel_features, sample, surface);
             }
+            EndFeatures(pixel_features, pixel_color, i, j);
             
             // Gamma correction (gamma = 2.0) and averaging
             auto r_ = sqrt(pixel_color.x / samples_per_pixel);
@@ -87,7 +65,50 @@ void SimpleRenderer::Render(const Scene& scene, Image& image) {
             auto b_ = sqrt(pixel_color.z / samples_per_pixel);
 
             image.SetPixel(i, j, r_ * 255.99, g_ * 255.99, b_ * 255.99);
+            EndPixel(probe, i, j);
         }
     }
+    FinishFrame(image);
     std::cout << "SimpleRenderer: Done." << std::endl;
+    EndStats();
+}
+
+bool SimpleRenderer::RenderTiles(const Scene& scene, TiledImageFile& output) {
+    BeginTiles(scene, output, "SimpleRenderer");
+    TraceScope trace("tiled render", "render");
+    trace.Arg("width", output.GetWidth()).Arg("height", output.GetHeight());
+    std::unique_ptr<Sampler> sampler = CreateSampler();
+
+    // the only pixels held in memory: one tile
+    std::vector<unsigned char> rgb(static_cast<size_t>(output.GetTileSize()) * output.GetTileSize() * 3);
+    const int count = output.RemainingTiles();
+    int done = 0;
+    bool ok = true;
+    for (int tile = 0; tile < output.TileCount() && ok; ++tile) {
+        if (output.IsTileDone(tile)) continue;
+        int x0, y0, x1, y1;
+        output.TileRect(tile, x0, y0, x1, y1);
+        TraceScope tile_trace("tile", "render");
+        tile_trace.Arg("x", x0).Arg("y", y0);
+
+        RenderRect(scene, x0, y0, x1, y1, output.GetWidth(), output.GetHeight(), *sampler, rgb.data());
+        ok = output.WriteTile(tile, rgb.data());
+        ReportTile(++done, count);
+    }
+    ok = output.Flush() && ok;
+    std::cout << "SimpleRenderer: " << (ok ? "Done." : "Output write failed.") << std::endl;
+    EndStats();
+    return ok;
+}
+
+void SimpleRenderer::RenderPass(const Scene& scene, RenderCheckpoint& state, int pass_samples) {
+    scene.GetLights().prepareSampling();
+    ShadowCache::Invalidate();
+    TraceScope trace("render pass", "render");
+    trace.Arg("samples", pass_samples);
+    std::unique_ptr<Sampler> sampler = CreateSampler();
+
+    for (int j = 0; j < state.GetHeight(); ++j) {
+        AccumulateRect(scene, state, 0, j, state.GetWidth(), j + 1, pass_samples, *sampler);
+    }
 }
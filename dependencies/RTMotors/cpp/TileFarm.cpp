@@ -0,0 +1,335 @@
+/*
+    TileFarm.cpp
+    Coordinator event loop (work queue, merging, stragglers) and worker loop
+*/
+
+#include "../hpp/TileFarm.hpp"
+#include "../hpp/SimpleRenderer.hpp"
+#include "../../scene/hpp/SceneCompiler.hpp"
+#include "../../scene/hpp/Sceneloader.hpp"
+#include "../../utils/hpp/LocalSocket.hpp"
+#include "../../utils/hpp/Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <deque>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// coordinator -> worker: Job once, then Unit until Quit
+// worker -> coordinator: Ready (pid) once the scene is loaded, then one Result per Unit
+enum MessageType : uint32_t { kJob = 1, kReady, kUnit, kResult, kQuit };
+
+// followed by the scene path
+struct JobHeader {
+    int32_t width, height;
+    int32_t samples_per_pixel;
+    int32_t max_depth;
+    uint32_t sampler;
+    uint32_t seed;
+};
+
+// pixels [x0, x1) x [y0, y1), samples [s0, s1); a Result repeats it before the sums
+struct WorkUnit {
+    uint32_t id;
+    int32_t x0, y0, x1, y1;
+    int32_t s0, s1;
+};
+
+struct UnitState {
+    WorkUnit unit;
+    bool done = false;
+    int running = 0;            // workers rendering it
+    Clock::time_point issued;   // when the oldest running copy was handed out
+};
+
+struct WorkerState {
+    int fd = -1;
+    pid_t pid = 0;
+    bool ready = false;
+    int unit = -1;              // unit being rendered, -1 when idle
+    Clock::time_point started;
+    std::string inbox;          // bytes of a message still coming in
+};
+
+double Seconds(Clock::time_point since) {
+    return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+std::string ExecutablePath() {
+    char path[4096];
+    ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (n <= 0) return std::string();
+    path[n] = '\0';
+    return path;
+}
+
+pid_t SpawnWorker(const std::string& exe, const std::string& socket_path) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        // the coordinator reports the progress, workers only their errors
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+        execl(exe.c_str(), exe.c_str(), "--worker", socket_path.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    return pid;
+}
+
+std::vector<UnitState> SplitFrame(const RenderCheckpoint::Settings& settings, int tile_size, int unit_samples) {
+    const int spp = settings.samples_per_pixel;
+    const int step = unit_samples > 0 ? std::min(unit_samples, spp) : spp;
+    std::vector<UnitState> units;
+    for (int y0 = 0; y0 < settings.height; y0 += tile_size) {
+        for (int x0 = 0; x0 < settings.width; x0 += tile_size) {
+            for (int s0 = 0; s0 < spp; s0 += step) {
+                UnitState state;
+                state.unit = {static_cast<uint32_t>(units.size()), x0, y0, std::min(x0 + tile_size, settings.width),
+                              std::min(y0 + tile_size, settings.height), s0, std::min(s0 + step, spp)};
+                units.push_back(state);
+            }
+        }
+    }
+    return units;
+}
+
+} // namespace
+
+bool TileFarm::Render(const Options& options, RenderCheckpoint& state) {
+    const RenderCheckpoint::Settings& settings = state.GetSettings();
+    std::vector<UnitState> units = SplitFrame(settings, std::max(options.tile_size, 1), options.unit_samples);
+    if (units.empty()) return false;
+
+    const std::string path = options.socket_path.empty() ? "/tmp/rt-farm-" + std::to_string(getpid()) + ".sock" : options.socket_path;
+    int listen_fd = LocalSocket::Listen(path);
+    if (listen_fd < 0) return false;
+
+    std::string job;
+    LocalSocket::Append(job, JobHeader{settings.width, settings.height, settings.samples_per_pixel, settings.max_depth,
+                                       settings.sampler, settings.seed});
+    job += options.scene_file;
+
+    std::vector<pid_t> children;
+    const std::string exe = ExecutablePath();
+    for (int i = 0; i < options.workers; i++) {
+        pid_t pid = exe.empty() ? -1 : SpawnWorker(exe, path);
+        if (pid > 0) children.push_back(pid);
+        else std::cerr << "TileFarm: cannot start a local worker" << std::endl;
+    }
+    std::cout << "TileFarm: " << units.size() << " units (" << settings.width << "x" << settings.height << ", "
+              << settings.samples_per_pixel << " spp) on " << path << ", " << children.size() << " local workers" << std::endl;
+
+    TraceScope trace("tile farm", "render");
+    trace.Arg("units", static_cast<int>(units.size()));
+    std::deque<int> queue;
+    for (const UnitState& u : units) queue.push_back(static_cast<int>(u.unit.id));
+    std::vector<WorkerState> workers;
+    int remaining = static_cast<int>(units.size());
+    int reissued = 0;
+    double unit_seconds = 0.0;
+    int last_percent = -1;
+    bool failed = false;
+
+    // a worker that leaves gives its unit back, first in line
+    auto release = [&](WorkerState& w) {
+        if (w.unit < 0) return;
+        UnitState& u = units[w.unit];
+        if (--u.running == 0 && !u.done) queue.push_front(w.unit);
+        w.unit = -1;
+    };
+
+    // a message from w, false if w broke the protocol
+    auto handle = [&](WorkerState& w, const LocalSocket::Message& message) {
+        size_t offset = 0;
+        if (message.type == kReady) {
+            int32_t pid = 0;
+            if (!LocalSocket::Read(message.payload, offset, pid)) return false;
+            w.pid = pid;
+            w.ready = true;
+            return true;
+        }
+        if (message.type != kResult) return false;
+
+        WorkUnit unit;
+        if (!LocalSocket::Read(message.payload, offset, unit) || w.unit < 0 || unit.id != static_cast<uint32_t>(w.unit)) return false;
+        UnitState& u = units[w.unit];
+        const WorkUnit& expected = u.unit;
+        const size_t pixels = static_cast<size_t>(expected.x1 - expected.x0) * (expected.y1 - expected.y0);
+        if (message.payload.size() != offset + pixels * 3 * sizeof(double)) return false;
+        if (!u.done) {
+            // late copies of a unit that is already in are dropped
+            const double* sums = reinterpret_cast<const double*>(message.payload.data() + offset);
+            for (int y = expected.y0; y < expected.y1; y++) {
+                for (int x = expected.x0; x < expected.x1; x++) {
+                    double* sum = state.Sum(x, y);
+                    sum[0] += *sums++;
+                    sum[1] += *sums++;
+                    sum[2] += *sums++;
+                    state.Count(x, y) += static_cast<uint32_t>(expected.s1 - expected.s0);
+                }
+            }
+            u.done = true;
+            remaining--;
+            unit_seconds += Seconds(w.started);
+        }
+        u.running--;
+        w.unit = -1;
+        return true;
+    };
+
+    // next unit for an idle worker: the queue first, then a copy of the oldest straggler
+    auto next_unit = [&]() {
+        while (!queue.empty()) {
+            int id = queue.front();
+            queue.pop_front();
+            if (!units[id].done) return id;
+        }
+        const int finished = static_cast<int>(units.size()) - remaining;
+        if (finished == 0) return -1;
+        const double limit = options.straggler_factor * unit_seconds / finished;
+        int oldest = -1;
+        for (const UnitState& u : units) {
+            if (u.done || u.running != 1 || Seconds(u.issued) < limit) continue;
+            if (oldest < 0 || u.issued < units[oldest].issued) oldest = static_cast<int>(u.unit.id);
+        }
+        if (oldest >= 0) reissued++;
+        return oldest;
+    };
+
+    while (remaining > 0) {
+        std::vector<pollfd> fds;
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (const WorkerState& w : workers) fds.push_back({w.fd, POLLIN, 0});
+        // wakes up now and then to look for stragglers and dead workers
+        poll(fds.data(), fds.size(), 100);
+
+        if (fds[0].revents & POLLIN) {
+            WorkerState w;
+            w.fd = LocalSocket::Accept(listen_fd);
+            // results are read as they trickle in: a worker stopped mid-send blocks nobody
+            if (w.fd >= 0 && LocalSocket::SetNonBlocking(w.fd) && LocalSocket::Send(w.fd, kJob, job)) workers.push_back(w);
+            else LocalSocket::Close(w.fd);
+        }
+
+        for (size_t k = 1; k < fds.size(); k++) {
+            if (!(fds[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            WorkerState& w = workers[k - 1];
+            bool ok = LocalSocket::ReceiveAvailable(w.fd, w.inbox);
+            LocalSocket::Message message;
+            bool broken = false;
+            while (ok && LocalSocket::Extract(w.inbox, message, broken)) ok = handle(w, message);
+            if (!ok || broken) {
+                release(w);
+                LocalSocket::Close(w.fd);
+                w.fd = -1;
+            }
+        }
+        workers.erase(std::remove_if(workers.begin(), workers.end(), [](const WorkerState& w) { return w.fd < 0; }), workers.end());
+
+        for (WorkerState& w : workers) {
+            if (!w.ready || w.unit >= 0) continue;
+            int id = next_unit();
+            if (id < 0) break;
+            const WorkUnit& unit = units[id].unit;
+            if (!LocalSocket::Send(w.fd, kUnit, &unit, sizeof(unit))) continue;   // dropped at the next poll
+            if (units[id].running++ == 0) units[id].issued = Clock::now();
+            w.unit = id;
+            w.started = Clock::now();
+        }
+
+        const int percent = static_cast<int>((units.size() - remaining) * 100 / units.size());
+        if (percent / 10 != last_percent / 10) {
+            std::cout << "  Progress: " << percent << "% (" << units.size() - remaining << "/" << units.size() << " units, "
+                      << workers.size() << " workers)" << std::endl;
+            last_percent = percent;
+        }
+
+        // nobody left to finish the frame: every local worker is gone and none joined
+        children.erase(std::remove_if(children.begin(), children.end(), [](pid_t pid) { return waitpid(pid, nullptr, WNOHANG) == pid; }),
+                       children.end());
+        if (workers.empty() && children.empty() && options.workers > 0) {
+            std::cerr << "TileFarm: every worker exited, " << remaining << " units left" << std::endl;
+            failed = true;
+            break;
+        }
+    }
+
+    // idle workers stop at once; local ones still on a copy of a finished unit are killed
+    for (WorkerState& w : workers) {
+        LocalSocket::Send(w.fd, kQuit, nullptr, 0);
+        if (w.unit >= 0 && std::find(children.begin(), children.end(), w.pid) != children.end()) kill(w.pid, SIGKILL);
+        LocalSocket::Close(w.fd);
+    }
+    for (pid_t pid : children) waitpid(pid, nullptr, 0);
+    LocalSocket::Close(listen_fd);
+    unlink(path.c_str());
+
+    if (!failed) std::cout << "TileFarm: Done (" << reissued << " straggler units issued again)." << std::endl;
+    return !failed;
+}
+
+int TileFarm::Work(const std::string& socket_path) {
+    int fd = LocalSocket::Connect(socket_path);
+    if (fd < 0) return 1;
+
+    LocalSocket::Message message;
+    JobHeader job;
+    size_t offset = 0;
+    if (!LocalSocket::Receive(fd, message) || message.type != kJob || !LocalSocket::Read(message.payload, offset, job)) {
+        std::cerr << "TileFarm worker: no job from " << socket_path << std::endl;
+        LocalSocket::Close(fd);
+        return 1;
+    }
+    const std::string scene_file = message.payload.substr(offset);
+
+    // a worker without the scene leaves before Ready, it would only send black samples
+    Scene scene;
+    const double aspect_ratio = static_cast<double>(job.width) / job.height;
+    const bool loaded = SceneCompiler::IsCompiledScene(scene_file) ? SceneCompiler::Load(scene_file, scene, aspect_ratio, true)
+                                                                   : SceneLoader::LoadJSONStream(scene_file, scene, aspect_ratio);
+    if (!loaded) {
+        std::cerr << "TileFarm worker: cannot load " << scene_file << std::endl;
+        LocalSocket::Close(fd);
+        return 1;
+    }
+    scene.GetLights().prepareSampling();
+
+    SimpleRenderer renderer;
+    renderer.SetSamplesPerPixel(job.samples_per_pixel);
+    renderer.SetMaxDepth(job.max_depth);
+    renderer.SetSampler(static_cast<SamplerType>(job.sampler));
+    renderer.SetSamplerSeed(job.seed);
+
+    const int32_t pid = static_cast<int32_t>(getpid());
+    bool ok = LocalSocket::Send(fd, kReady, &pid, sizeof(pid));
+    std::vector<double> sums;
+    std::string result;
+    while (ok && LocalSocket::Receive(fd, message) && message.type != kQuit) {
+        WorkUnit unit;
+        offset = 0;
+        if (message.type != kUnit || !LocalSocket::Read(message.payload, offset, unit)) continue;
+        TraceScope trace("farm unit", "render");
+        trace.Arg("x", unit.x0).Arg("y", unit.y0);
+
+        sums.resize(static_cast<size_t>(unit.x1 - unit.x0) * (unit.y1 - unit.y0) * 3);
+        renderer.SampleRect(scene, scene.GetCamera(), unit.x0, unit.y0, unit.x1, unit.y1, job.width, job.height, unit.s0, unit.s1, sums.data());
+        result.clear();
+        LocalSocket::Append(result, unit);
+        result.append(reinterpret_cast<const char*>(sums.data()), sums.size() * sizeof(double));
+        ok = LocalSocket::Send(fd, kResult, result);
+    }
+    LocalSocket::Close(fd);
+    return 0;
+}
@@ -19,10 +19,19 @@ public:
     
     // Main render function (parallelized)
     void Render(const Scene& scene, Image& image) override;
-    
+
+    // Tiles of the output (their own size, not tile_size) handed out to the threads
+    bool RenderTiles(const Scene& scene, TiledImageFile& output) override;
+
+    // Square tiles of tile_size, as Render()
+    void RenderPass(const Scene& scene, RenderCheckpoint& state, int pass_samples) override;
+
+    // Side of the square tiles distributed to the threads
+    void SetTileSize(int size) { tile_size = size > 0 ? size : 1; }
+    int GetTileSize() const { return tile_size; }
+
 private:
-    // Ray color with lighting (thread-safe)
-    Vector3 RayColor(const Ray& r, const hittable_list& world, const Light_list& lights, int depth);
+    int tile_size = 32;
 };
 
 // Alias for backward compatibility
@@ -0,0 +1,56 @@
+/*
+    RenderDaemon.hpp
+    Long-lived render server: jobs (scene, camera, resolution, samples, output file) come in over
+    a UNIX domain socket. Loaded scenes and their BVH stay in an LRU cache, so a job on a cached
+    scene only pays for its pixels. Jobs run one at a time on the OpenMP thread pool, highest
+    priority first; a higher-priority arrival preempts the running job between two tiles
+*/
+
+#ifndef RENDER_DAEMON_HPP
+#define RENDER_DAEMON_HPP
+
+#include <string>
+#include "../../utils/hpp/Sampler.hpp"
+#include "../../utils/hpp/Vector3.hpp"
+
+class RenderDaemon {
+public:
+    struct Options {
+        int cache_scenes = 4;       // scenes kept loaded
+        int tile_size = 32;
+    };
+
+    struct Job {
+        std::string scene_file;     // absolute, the daemon has its own working directory
+        std::string output;         // .png, .ppm or .exr
+        int width = 0, height = 0;
+        int samples_per_pixel = 16;
+        int max_depth = 8;
+        SamplerType sampler = SamplerType::Sobol;
+        uint32_t seed = 0;
+        int priority = 0;           // higher runs first
+        // camera overrides, the scene camera otherwise (vfov <= 0 keeps the scene's)
+        bool set_look_from = false, set_look_at = false;
+        Vector3 look_from, look_at;
+        double vfov = 0.0;
+    };
+
+    struct Result {
+        bool ok = false;
+        std::string message;
+        bool cached = false;        // the scene was already loaded
+        int preemptions = 0;
+        // queued_ms includes the waits after preemptions
+        double queued_ms = 0.0, load_ms = 0.0, render_ms = 0.0, save_ms = 0.0;
+    };
+
+    // Serves jobs on socket_path until a stop request, returns the exit code
+    static int Serve(const std::string& socket_path, const Options& options);
+
+    // Client side: sends job and waits for it to be done
+    static bool Submit(const std::string& socket_path, const Job& job, Result& result);
+    // asks the daemon to stop; queued jobs are answered with an error
+    static bool Stop(const std::string& socket_path);
+};
+
+#endif
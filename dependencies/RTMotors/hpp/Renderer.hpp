@@ -7,12 +7,23 @@
 #ifndef RENDERER_HPP
 #define RENDERER_HPP
 
+#include <chrono>
 #include <limits>
 #include <iostream>
+#include <unordered_map>
 #include "../../scene/hpp/scene.hpp"
 #include "../../utils/hpp/Image.hpp"
 #include "../../utils/hpp/Vector3.hpp"
+#include "../../utils/hpp/RenderStats.hpp"
+#include "../../utils/hpp/CostMap.hpp"
+#include "../../utils/hpp/FeatureBuffers.hpp"
+#include "../../utils/hpp/Denoiser.hpp"
+#include "../../utils/hpp/AovBuffers.hpp"
+#include "../../utils/hpp/TiledImageFile.hpp"
+#include "../../utils/hpp/RenderCheckpoint.hpp"
+#include "../../utils/hpp/Sampler.hpp"
 #include "../../materials/hpp/Material.hpp"
+#include "../../lights/hpp/Light_list.hpp"
 
 // Abstract base class for ray tracing renderers
 class Renderer {
@@ -22,18 +33,180 @@ public:
     
     // Pure virtual: each renderer must implement this
     virtual void Render(const Scene& scene, Image& image) = 0;
+
+    // Out-of-core render: the tiles of output that are not done yet are rendered and written
+    // to it as soon as each one is finished; false if the file could not be written. The cost
+    // map, feature buffers, output passes and denoising need the whole frame and are skipped
+    virtual bool RenderTiles(const Scene& scene, TiledImageFile& output) = 0;
+
+    // Progressive render: adds up to pass_samples samples to every pixel of state that has
+    // fewer than samples_per_pixel. Sample indices continue from each pixel's count, so the
+    // passes sum up to the same samples as one Render() with these settings. Statistics and
+    // the per-pixel buffers are left alone
+    virtual void RenderPass(const Scene& scene, RenderCheckpoint& state, int pass_samples) = 0;
+
+    // Sums of samples [s0, s1) of the pixels [x0, x1) x [y0, y1) of an nx x ny frame seen
+    // through camera, RGB row by row, on the calling thread (tile farm workers, render daemon).
+    // The scene lights must have been prepared (Light_list::prepareSampling)
+    void SampleRect(const Scene& scene, const Camera& camera, int x0, int y0, int x1, int y1, int nx, int ny, int s0, int s1,
+                    double* sums);
     
     // Configuration setters
     void SetMaxDepth(int depth) { max_depth = depth; }
     void SetSamplesPerPixel(int samples) { samples_per_pixel = samples; }
+    void SetSampler(SamplerType type) { sampler_type = type; }
+    void SetSamplerSeed(uint32_t seed) { sampler_seed = seed; }
+    // above exhaustive_lights point/spot lights, light_samples of them are picked per
+    // shading point through the light tree instead of evaluating them all
+    void SetExhaustiveLights(int count) { exhaustive_lights = count; }
+    void SetLightSamples(int count) { light_samples = count < 1 ? 1 : count; }
     
     // Configuration getters
     int GetMaxDepth() const { return max_depth; }
     int GetSamplesPerPixel() const { return samples_per_pixel; }
+    SamplerType GetSampler() const { return sampler_type; }
+    int GetExhaustiveLights() const { return exhaustive_lights; }
+    int GetLightSamples() const { return light_samples; }
+
+    // Counters of the last Render() (all zero when RT_ENABLE_STATS is off)
+    const RenderCounters& GetLastStats() const { return last_stats; }
+    double GetLastRenderMs() const { return last_render_ms; }
+
+    // Per-pixel cost recording, nullptr (default) turns it off. Node visits and
+    // primitive tests are only recorded when RT_ENABLE_STATS is on.
+    void SetCostMap(CostMap* map) { cost_map = map; }
+
+    // Feature buffers (linear color, variance, first hit albedo/normal/depth) filled by
+    // Render(), nullptr (default) turns them off unless denoising needs them
+    void SetFeatureBuffers(FeatureBuffers* buffers) { feature_buffers = buffers; }
+    // Edge-aware denoising of the finished frame
+    void SetDenoise(bool enabled) { denoise = enabled; }
+    void SetDenoiseOptions(const Denoiser::Options& options) { denoise_options = options; }
+    bool GetDenoise() const { return denoise; }
+    const Denoiser::Options& GetDenoiseOptions() const { return denoise_options; }
+
+    // Output passes (see AovBuffers::SetPasses) filled by Render(), nullptr (default) turns
+    // them off. Object IDs follow Scene::GetPrimitives(), material IDs the scene library,
+    // both start at 1 (0 = nothing hit)
+    void SetAovBuffers(AovBuffers* buffers) { aov_buffers = buffers; }
 
 protected:
+    // First hit of a camera ray, for the feature buffers (depth 0 on a miss)
+    struct SurfaceFeatures {
+        Vector3 albedo;
+        Vector3 normal;
+        double depth = 0.0;
+        const hittable* object = nullptr;
+        const Material* material = nullptr;
+    };
+
+    // Ray color with direct + indirect lighting, shared by the renderers
+    // bsdf_pdf is the pdf of the direction of r at the previous hit, 0 for camera rays and
+    // specular bounces (emitters they hit are not weighted against light sampling)
+    // surface, when set, receives the features of the hit of r
+    Vector3 RayColor(const Ray& r, const hittable_list& world, const Light_list& lights, int depth, Sampler& sampler,
+                     double bsdf_pdf = 0.0, SurfaceFeatures* surface = nullptr);
+
+    // Primary ray of sample s of pixel (i, j): pixel jitter and lens point come from
+    // the camera dimensions of the sampler
+    Ray CameraRay(const Camera& camera, int i, int j, int s, int nx, int ny, Sampler& sampler) const {
+        sampler.StartPixel(i, j, s);
+        double du, dv, lu, lv;
+        sampler.Get2D(Sampler::kPixel, du, dv);
+        sampler.Get2D(Sampler::kLens, lu, lv);
+        return camera.GenerateRay((i + du) / (nx - 1), (ny - 1 - j + dv) / (ny - 1), lu, lv);
+    }
+
+    // One sampler per rendering thread
+    std::unique_ptr<Sampler> CreateSampler() const {
+        return Sampler::Create(sampler_type, samples_per_pixel, sampler_seed);
+    }
+
+    // Called around the pixel loop: resets the counters (and sizes the cost map),
+    // then merges and reports them
+    void BeginStats(int width, int height);
+    void EndStats();
+
+    // Sizes the output passes and numbers the objects and materials of the scene
+    // when their ID passes are enabled
+    void BeginAovs(const Scene& scene, int width, int height);
+
+    // Whether camera rays report their first hit (feature buffers or output passes)
+    bool CollectsSurfaces() const { return features != nullptr || aov_buffers != nullptr; }
+
+    // Wrapped around the samples of one pixel when a cost map is set
+    struct PixelProbe {
+        std::chrono::steady_clock::time_point start;
+        uint64_t bvh_nodes = 0;
+        uint64_t primitive_tests = 0;
+    };
+
+    PixelProbe BeginPixel() const {
+        PixelProbe probe;
+        if (!cost_map) return probe;
+#ifdef RT_ENABLE_STATS
+        const RenderCounters& counters = RenderStats::Local();
+        probe.bvh_nodes = counters.bvh_nodes;
+        probe.primitive_tests = counters.primitive_total();
+#endif
+        probe.start = std::chrono::steady_clock::now();
+        return probe;
+    }
+
+    void EndPixel(const PixelProbe& probe, int x, int y) const {
+        if (!cost_map) return;
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - probe.start).count();
+        uint64_t nodes = 0, tests = 0;
+#ifdef RT_ENABLE_STATS
+        const RenderCounters& counters = RenderStats::Local();
+        nodes = counters.bvh_nodes - probe.bvh_nodes;
+        tests = counters.primitive_total() - probe.primitive_tests;
+#endif
+        cost_map->Set(x, y, ns, nodes, tests);
+    }
+
+    // Sums over the samples of one pixel when feature buffers or output passes are filled
+    struct PixelFeatures {
+        Vector3 albedo, normal;
+        double depth = 0.0;
+        double luminance2 = 0.0;
+        int hits = 0;
+        const hittable* object = nullptr;       // IDs can't be averaged: first sample that hit
+        const Material* material = nullptr;
+    };
+
+    void AddFeatureSample(PixelFeatures& pixel, const Vector3& color, const SurfaceFeatures& surface) const {
+        double luminance = 0.2126 * color.x + 0.7152 * color.y + 0.0722 * color.z;
+        pixel.luminance2 += luminance * luminance;
+        if (surface.depth <= 0.0) return;
+        pixel.albedo += surface.albedo;
+        pixel.normal += surface.normal;
+        pixel.depth += surface.depth;
+        if (pixel.hits++ == 0) {
+            pixel.object = surface.object;
+            pixel.material = surface.material;
+        }
+    }
+
+    void EndFeatures(const PixelFeatures& pixel, const Vector3& color_sum, int x, int y) const;
+
+    // Pixels [x0, x1) x [y0, y1) of an nx x ny frame, gamma corrected and clamped to
+    // bytes as Image does, row by row into rgb (3 bytes per pixel)
+    void RenderRect(const Scene& scene, int x0, int y0, int x1, int y1, int nx, int ny, Sampler& sampler, unsigned char* rgb);
+
+    // Next samples of the pixels [x0, x1) x [y0, y1) of state, added to their sums
+    void AccumulateRect(const Scene& scene, RenderCheckpoint& state, int x0, int y0, int x1, int y1, int pass_samples, Sampler& sampler);
+
+    // Prepares the lights and the counters of a tiled render; the pixel buffers stay empty
+    void BeginTiles(const Scene& scene, const TiledImageFile& output, const char* name);
+    // One progress line per tenth of the tiles left when the render started
+    void ReportTile(int done, int count) const;
+
+    // Denoises the frame into the image when enabled (after the pixel loop)
+    void FinishFrame(Image& image);
+
     // Basic ray color without lighting (sky gradient background)
-    Vector3 RayColorBasic(const Ray& r, const hittable_list& world, int depth) {
+    Vector3 RayColorBasic(const Ray& r, const hittable_list& world, int depth, Sampler& sampler) {
         // Max bounces reached -> black
         if (depth <= 0) return Vector3(0, 0, 0);
 
@@ -42,11 +215,12 @@ protected:
         double t_max = std::numeric_limits<double>::infinity();
 
         if (world.hit(r, &t_min, &t_max, rec)) {
+            sampler.StartBounce(max_depth - depth);
             Ray scattered;
             Vector3 attenuation;
             // If material scatters, continue tracing
-            if (rec.mat_ptr != nullptr && rec.mat_ptr->scatter(r, rec, attenuation, scattered)) {
-                return attenuation * RayColorBasic(scattered, world, depth - 1);
+            if (rec.mat_ptr != nullptr && rec.mat_ptr->scatter(r, rec, attenuation, scattered, sampler)) {
+                return attenuation * RayColorBasic(scattered, world, depth - 1, sampler);
             }
             return Vector3(0, 0, 0);
         }
@@ -59,6 +233,26 @@ protected:
 
     int max_depth;          // Maximum ray bounce depth
     int samples_per_pixel;  // Antialiasing samples per pixel
+    SamplerType sampler_type = SamplerType::Sobol;
+    uint32_t sampler_seed = 0;
+    int exhaustive_lights = 16;
+    int light_samples = 1;
+
+    RenderCounters last_stats;
+    RenderCounters stats_start;     // snapshot taken by BeginStats
+    double last_render_ms = 0.0;
+    std::chrono::steady_clock::time_point render_start;
+    CostMap* cost_map = nullptr;
+
+    FeatureBuffers* feature_buffers = nullptr;
+    FeatureBuffers own_features;            // used when denoising without caller buffers
+    FeatureBuffers* features = nullptr;     // buffers filled by the current render
+    bool denoise = false;
+    Denoiser::Options denoise_options;
+
+    AovBuffers* aov_buffers = nullptr;
+    std::unordered_map<const hittable*, uint32_t> object_ids;
+    std::unordered_map<const Material*, uint32_t> material_ids;
 };
 
 #endif
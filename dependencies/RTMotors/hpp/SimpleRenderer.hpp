@@ -19,10 +19,12 @@ public:
     
     // Main render function
     void Render(const Scene& scene, Image& image) override;
-    
-private:
-    // Ray color with direct + indirect lighting
-    Vector3 RayColor(const Ray& r, const hittable_list& world, const Light_list& lights, int depth);
+
+    // Tiles of the output in order
+    bool RenderTiles(const Scene& scene, TiledImageFile& output) override;
+
+    // Rows in order
+    void RenderPass(const Scene& scene, RenderCheckpoint& state, int pass_samples) override;
 };
 
 // Alias for backward compatibility
@@ -0,0 +1,35 @@
+/*
+    TileFarm.hpp
+    One frame spread over worker processes: a coordinator hands out work units (a tile and a
+    range of its samples) over a UNIX domain socket, workers load the scene once and send back
+    the sums of their samples, which are merged into the coordinator's accumulation buffer.
+    Units still running once the queue is empty are issued again to idle workers
+*/
+
+#ifndef TILE_FARM_HPP
+#define TILE_FARM_HPP
+
+#include <string>
+#include "../../utils/hpp/RenderCheckpoint.hpp"
+
+class TileFarm {
+public:
+    struct Options {
+        std::string scene_file;     // loaded by every worker
+        std::string socket_path;    // empty: a path in /tmp named after the coordinator pid
+        int workers = 2;            // local processes started, others can join with RT --worker
+        int tile_size = 64;
+        int unit_samples = 0;       // samples per unit, 0 = all the samples of the tile
+        // a unit is issued again when it has run this many times the mean unit time
+        double straggler_factor = 3.0;
+    };
+
+    // Coordinator: state gives the frame and render settings and receives the samples of
+    // every pixel; false if the frame could not be finished (no worker left)
+    static bool Render(const Options& options, RenderCheckpoint& state);
+
+    // Worker: connects to the coordinator and renders units until told to stop
+    static int Work(const std::string& socket_path);
+};
+
+#endif
@@ -8,6 +8,7 @@
 
 #include "../../utils/hpp/Point3.hpp"
 #include "../../utils/hpp/Vector3.hpp"
+#include "../../utils/hpp/Sampling.hpp"
 #include "Ray.hpp"
 #include <cmath>
 
@@ -20,10 +21,22 @@ public:
     Vector3 u, v, w;            // camera local coordinate system
     double lens_radius;         // for depth of field effect
 
+    // setup parameters, kept so the camera can be saved and compared
+    Point3 look_from, look_at;
+    Vector3 view_up;
+    double vfov_deg = 0, aperture = 0, focus_dist = 0;
+
     Camera() {}
 
     // Setup camera with position, target, FOV, aperture and focus distance
     void Setup(Point3 lookfrom, Point3 lookat, Vector3 vup, double vfov, double aspect_ratio, double aperture, double focus_dist) {
+        look_from = lookfrom;
+        look_at = lookat;
+        view_up = vup;
+        vfov_deg = vfov;
+        this->aperture = aperture;
+        this->focus_dist = focus_dist;
+
         auto theta = vfov * M_PI / 180.0;  // convert FOV to radians
         auto h = tan(theta/2);
         auto viewport_height = 2.0 * h;
@@ -53,18 +66,25 @@ public:
         );
     }
 
+    // Same, with the lens point given by two uniform values (sampler lens dimensions)
+    Ray GenerateRay(double s, double t, double lens_u, double lens_v) const {
+        Vector3 rd = lens_radius * Sampling::ConcentricDisk(lens_u, lens_v);
+        Vector3 offset = u * rd.x + v * rd.y;
+
+        return Ray(
+            origin + offset,
+            lower_left_corner + s*horizontal + t*vertical - origin - offset
+        );
+    }
+
 private:
     // random point in unit disk for lens sampling
     static Vector3 random_in_unit_disk() {
-        while (true) {
-            auto p = Vector3(random_double(-1,1), random_double(-1,1), 0);
-            if (p.lengthSquared() >= 1) continue;
-            return p;
-        }
+        return Sampling::ConcentricDisk(random_double(), random_double());
     }
     
-    static double random_double(double min = 0.0, double max = 1.0) {
-        return min + (max-min)*((double)rand()/RAND_MAX);
+    static double random_double() {
+        return rand() / (RAND_MAX + 1.0);
     }
 };
 
@@ -7,6 +7,7 @@
 #include <memory>
 #include <random>
 
+#include "utils/hpp/Sampling.hpp"
 
 // C++ Std Usings
 
@@ -26,10 +27,20 @@ inline double degrees_to_radians(double degrees) {
 
 #include <random>
 
+// one generator per thread, seeded from the system unless seed_random() is called
+inline std::mt19937& random_generator() {
+    thread_local std::mt19937 generator(std::random_device{}());
+    return generator;
+}
+
+// reseeds the calling thread's generator (reproducible scenes and benchmarks)
+inline void seed_random(unsigned int seed) {
+    random_generator().seed(seed);
+}
+
 inline double random_double() {
-    thread_local std::mt19937 generator(std::random_device{}()); 
     std::uniform_real_distribution<double> distribution(0.0, 1.0);
-    return distribution(generator);
+    return distribution(random_generator());
 }
 
 inline double random_double(double min, double max) {
@@ -39,16 +50,15 @@ inline int random_int(int min, int max) {
     return static_cast<int>(random_double(min, max + 1));
 }
 
+// closed-form warps (Sampling.hpp): a fixed count of random numbers per call
 inline Vector3 random_in_unit_sphere() {
-    while (true) {
-        Vector3 p(random_double(-1,1), random_double(-1,1), random_double(-1,1));
-        if (p.lengthSquared() >= 1) continue;
-        return p;
-    }
+    return Sampling::UniformBall(random_double(), random_double(), random_double());
 }
 
-// normalized random direction for diffuse scattering
-inline Vector3 random_unit_vector() { return unit_vector(random_in_unit_sphere()); }
+// normalized random direction, already unit length
+inline Vector3 random_unit_vector() { return Sampling::UniformSphere(random_double(), random_double()); }
+
+inline Vector3 random_in_unit_disk() { return Sampling::ConcentricDisk(random_double(), random_double()); }
 // Common Headers
 
 #include "utils/hpp/Color.hpp"
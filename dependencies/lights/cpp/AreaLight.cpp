@@ -0,0 +1,197 @@
+/*
+    AreaLight.cpp
+    Area light sampling: cone of directions for spheres, uniform area for quads and triangles
+*/
+
+#include "../hpp/AreaLight.hpp"
+#include "objects/hpp/Sphere.hpp"
+#include "objects/hpp/Triangle.hpp"
+#include "objects/hpp/Quad.hpp"
+#include "materials/hpp/Emissive.hpp"
+#include "utils/hpp/Sampling.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+double Luminance(const Vector3& c) {
+    return 0.2126 * c.x + 0.7152 * c.y + 0.0722 * c.z;
+}
+
+const Emissive* EmitterOf(const std::shared_ptr<Material>& m) {
+    return dynamic_cast<const Emissive*>(m.get());
+}
+
+} // namespace
+
+bool AreaLight::FromObject(const std::shared_ptr<hittable>& object, AreaLight& light) {
+    const Emissive* emissive = nullptr;
+    if (auto s = std::dynamic_pointer_cast<sphere>(object)) {
+        if (!(emissive = EmitterOf(s->mat_ptr)) || s->radius <= 0) return false;
+        light.shape = Shape::Sphere;
+        light.origin = s->center;
+        light.radius = s->radius;
+        light.area = 4.0 * M_PI * s->radius * s->radius;
+    } else if (auto q = std::dynamic_pointer_cast<Quad>(object)) {
+        if (!(emissive = EmitterOf(q->mat_ptr)) || q->area <= 0) return false;
+        light.shape = Shape::Quad;
+        light.origin = q->Q;
+        light.edge1 = q->u;
+        light.edge2 = q->v;
+        light.normal = q->normal;
+        light.area = q->area;
+    } else if (auto t = std::dynamic_pointer_cast<Triangle>(object)) {
+        if (!(emissive = EmitterOf(t->mat_ptr))) return false;
+        light.shape = Shape::Triangle;
+        light.origin = t->v0;
+        light.edge1 = t->v1 - t->v0;
+        light.edge2 = t->v2 - t->v0;
+        light.normal = t->normal;
+        light.area = 0.5 * light.edge1.cross(light.edge2).length();
+        if (light.area <= 0) return false;
+    } else {
+        return false;
+    }
+
+    light.object = object;
+    light.radiance = emissive->radiance;
+    light.power = Luminance(emissive->radiance) * light.area;
+    return light.power > 0;
+}
+
+bool AreaLight::Sample(const Point3& ref, double u, double v, LightSample& ls) const {
+    if (shape == Shape::Sphere) {
+        // uniform cone of the directions that see the sphere: every sample hits it
+        Vector3 to_center = origin - ref;
+        double dist2 = to_center.lengthSquared();
+        if (dist2 <= radius * radius) return false;
+        double dist = std::sqrt(dist2);
+        double sin2_max = radius * radius / dist2;
+        double cos_max = std::sqrt(std::fmax(0.0, 1.0 - sin2_max));
+
+        Vector3 axis = to_center / dist;
+        ls.wi = unit_vector(Sampling::ToWorld(Sampling::UniformCone(u, v, cos_max), axis));
+
+        // nearest intersection, the closest approach for grazing samples
+        double b = dot(ls.wi, to_center);
+        double disc = radius * radius - (dist2 - b * b);
+        ls.distance = disc > 0 ? b - std::sqrt(disc) : b;
+        ls.point = ref + ls.distance * ls.wi;
+        ls.normal = unit_vector(ls.point - origin);
+        ls.pdf = Sampling::UniformConePdf(cos_max);
+        ls.radiance = radiance;
+        return ls.distance > 0;
+    }
+
+    // uniform point on the surface, converted to a pdf per steradian
+    if (shape == Shape::Quad) {
+        ls.point = origin + u * edge1 + v * edge2;
+    } else {
+        double su = std::sqrt(u);
+        ls.point = origin + (su * (1.0 - v)) * edge1 + (su * v) * edge2;
+    }
+    Vector3 d = ls.point - ref;
+    double dist2 = d.lengthSquared();
+    if (dist2 <= 0) return false;
+    ls.distance = std::sqrt(dist2);
+    ls.wi = d / ls.distance;
+    double cos_light = -dot(normal, ls.wi);
+    if (cos_light <= 0) return false;   // one-sided: only the front face emits
+    ls.normal = normal;
+    ls.pdf = dist2 / (cos_light * area);
+    ls.radiance = radiance;
+    return true;
+}
+
+double AreaLight::Pdf(const Point3& ref, const hit_record& rec) const {
+    if (shape == Shape::Sphere) {
+        double dist2 = (origin - ref).lengthSquared();
+        if (dist2 <= radius * radius) return 0.0;
+        double cos_max = std::sqrt(std::fmax(0.0, 1.0 - radius * radius / dist2));
+        return Sampling::UniformConePdf(cos_max);
+    }
+
+    Vector3 d = rec.p - ref;
+    double dist2 = d.lengthSquared();
+    double cos_light = -dot(normal, d) / std::sqrt(dist2);
+    if (cos_light <= 0) return 0.0;
+    return dist2 / (cos_light * area);
+}
+
+bool AreaLightList::Add(const std::shared_ptr<hittable>& object) {
+    AreaLight light;
+    if (!AreaLight::FromObject(object, light)) return false;
+    m_index[object.get()] = m_lights.size();
+    m_lights.push_back(light);
+    m_cdfDirty = true;
+    return true;
+}
+
+void AreaLightList::Replace(const hittable* old_object, const std::shared_ptr<hittable>& object) {
+    auto it = m_index.find(old_object);
+    if (it == m_index.end()) {
+        Add(object);
+        return;
+    }
+
+    AreaLight light;
+    size_t i = it->second;
+    m_index.erase(it);
+    if (AreaLight::FromObject(object, light)) {
+        m_lights[i] = light;
+        m_index[object.get()] = i;
+    } else {
+        m_lights.erase(m_lights.begin() + i);
+        Reindex();
+    }
+    m_cdfDirty = true;
+}
+
+void AreaLightList::Clear() {
+    m_lights.clear();
+    m_cdf.clear();
+    m_cdfDirty = false;
+    m_index.clear();
+}
+
+const AreaLight* AreaLightList::Find(const hittable* object) const {
+    auto it = m_index.find(object);
+    return it == m_index.end() ? nullptr : &m_lights[it->second];
+}
+
+bool AreaLightList::Sample(const Point3& ref, double u_choice, double u, double v, LightSample& ls) const {
+    if (m_lights.empty()) return false;
+
+    size_t i = std::upper_bound(m_cdf.begin(), m_cdf.end(), u_choice) - m_cdf.begin();
+    i = std::min(i, m_lights.size() - 1);
+    double choice = m_cdf[i] - (i > 0 ? m_cdf[i - 1] : 0.0);
+
+    if (choice <= 0 || !m_lights[i].Sample(ref, u, v, ls)) return false;
+    ls.pdf *= choice;
+    return true;
+}
+
+double AreaLightList::Pdf(const AreaLight& light, const Point3& ref, const hit_record& rec) const {
+    size_t i = &light - m_lights.data();
+    double choice = m_cdf[i] - (i > 0 ? m_cdf[i - 1] : 0.0);
+    return choice * light.Pdf(ref, rec);
+}
+
+void AreaLightList::Prepare() const {
+    if (!m_cdfDirty) return;
+    m_cdf.resize(m_lights.size());
+
+    double total = 0.0;
+    for (size_t i = 0; i < m_lights.size(); i++) {
+        total += m_lights[i].power;
+        m_cdf[i] = total;
+    }
+    for (double& c : m_cdf) c /= total;
+    m_cdfDirty = false;
+}
+
+void AreaLightList::Reindex() {
+    m_index.clear();
+    for (size_t i = 0; i < m_lights.size(); i++) m_index[m_lights[i].object.get()] = i;
+}
@@ -4,6 +4,7 @@
 */
 
 #include "../hpp/DirectionalLight.hpp"
+#include "../hpp/ShadowCache.hpp"
 #include "materials/hpp/Material.hpp"
 
 DirectionalLight::DirectionalLight() : direction(0, -1, 0) {}
@@ -18,12 +19,13 @@ bool DirectionalLight::computeIllumination(hit_record &rec, const hittable_list
     // shadow ray towards infinity
     Ray shadow_ray(rec.p + rec.normal * 0.001, light_dir);
     
-    hit_record shadow_rec;
     double t_min = 0.001;
     double t_max = 1e10;  // very far (sun is at infinity)
 
     // check for shadows
-    if (world.hit(shadow_ray, &t_min, &t_max, shadow_rec)) {
+    RT_STAT(shadow_rays);
+    if (ShadowCache::Occluded(this, world, shadow_ray, t_min, t_max)) {
+        RT_STAT(hits);
         return false;
     }
 
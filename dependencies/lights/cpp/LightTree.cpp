@@ -0,0 +1,276 @@
+/*
+    LightTree.cpp
+    Light hierarchy: bounds with orientation cones, SAOH build and importance-driven sampling
+    (Conty Estevez & Kulla 2018, "Importance Sampling of Many Lights with Adaptive Tree Splitting")
+*/
+
+#include "../hpp/LightTree.hpp"
+#include "../hpp/SpotLight.hpp"
+#include "../hpp/DirectionalLight.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+double Luminance(const Vector3& c) {
+    return 0.2126 * c.x + 0.7152 * c.y + 0.0722 * c.z;
+}
+
+double SafeAcos(double x) {
+    return std::acos(std::clamp(x, -1.0, 1.0));
+}
+
+double SafeSqrt(double x) {
+    return std::sqrt(std::fmax(0.0, x));
+}
+
+// cos(max(theta_a - theta_b, 0)) from the cosines
+double CosSubClamped(double cos_a, double cos_b) {
+    if (cos_a > cos_b) return 1.0;
+    return cos_a * cos_b + SafeSqrt(1.0 - cos_a * cos_a) * SafeSqrt(1.0 - cos_b * cos_b);
+}
+
+// v rotated by theta around the unit axis k (Rodrigues)
+Vector3 Rotate(const Vector3& v, const Vector3& k, double theta) {
+    double c = std::cos(theta), s = std::sin(theta);
+    return v * c + k.cross(v) * s + k * (dot(k, v) * (1.0 - c));
+}
+
+// smallest cone holding two cones
+void UnionCone(const Vector3& wa, double cos_a, const Vector3& wb, double cos_b, Vector3& w, double& cos_theta) {
+    w = wa;
+    cos_theta = -1.0;
+    if (cos_a == -1.0 || cos_b == -1.0) return;
+
+    double theta_a = SafeAcos(cos_a), theta_b = SafeAcos(cos_b);
+    double theta_d = SafeAcos(dot(wa, wb));
+    if (std::fmin(theta_d + theta_b, kPi) <= theta_a) { w = wa; cos_theta = cos_a; return; }
+    if (std::fmin(theta_d + theta_a, kPi) <= theta_b) { w = wb; cos_theta = cos_b; return; }
+
+    double theta_o = (theta_a + theta_d + theta_b) / 2.0;
+    if (theta_o >= kPi) return;
+
+    Vector3 axis = wa.cross(wb);
+    double len = axis.length();
+    if (len == 0.0) return;
+    w = unit_vector(Rotate(wa, axis / len, theta_o - theta_a));
+    cos_theta = std::cos(theta_o);
+}
+
+// solid angle measure of the directions the cluster emits into
+double OrientationMeasure(const LightBounds& b) {
+    double theta_o = SafeAcos(b.cos_theta_o);
+    double theta_e = SafeAcos(b.cos_theta_e);
+    double theta_w = std::fmin(theta_o + theta_e, kPi);
+    double sin_o = std::sin(theta_o);
+    return 2.0 * kPi * (1.0 - b.cos_theta_o) +
+           kPi / 2.0 * (2.0 * theta_w * sin_o - std::cos(theta_o - 2.0 * theta_w) - 2.0 * theta_o * sin_o + b.cos_theta_o);
+}
+
+double SurfaceArea(const Point3& lo, const Point3& hi) {
+    Vector3 d = hi - lo;
+    return 2.0 * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+} // namespace
+
+bool LightBounds::FromLight(const Light& light, LightBounds& bounds) {
+    if (dynamic_cast<const DirectionalLight*>(&light)) return false;
+
+    bounds.lo = bounds.hi = light.position;
+    bounds.phi = Luminance(light.intensity);
+    bounds.w = Vector3(0, 0, 1);
+    bounds.cos_theta_o = -1.0;
+    bounds.cos_theta_e = 0.0;
+
+    // zero past the outer cone: the inner cone bounds the axes, the falloff the emission
+    if (auto spot = dynamic_cast<const SpotLight*>(&light)) {
+        double theta_o = std::fmin(spot->inner_angle, spot->outer_angle);
+        double theta_e = std::fmax(spot->outer_angle - theta_o, 0.0);
+        bounds.w = spot->direction;
+        bounds.cos_theta_o = std::cos(theta_o);
+        bounds.cos_theta_e = std::cos(theta_e);
+    }
+    return bounds.phi > 0.0;
+}
+
+LightBounds LightBounds::Union(const LightBounds& a, const LightBounds& b) {
+    if (a.phi == 0.0) return b;
+    if (b.phi == 0.0) return a;
+
+    LightBounds u;
+    u.lo = Point3(std::fmin(a.lo.x, b.lo.x), std::fmin(a.lo.y, b.lo.y), std::fmin(a.lo.z, b.lo.z));
+    u.hi = Point3(std::fmax(a.hi.x, b.hi.x), std::fmax(a.hi.y, b.hi.y), std::fmax(a.hi.z, b.hi.z));
+    u.phi = a.phi + b.phi;
+    UnionCone(a.w, a.cos_theta_o, b.w, b.cos_theta_o, u.w, u.cos_theta_o);
+    u.cos_theta_e = std::fmin(a.cos_theta_e, b.cos_theta_e);
+    return u;
+}
+
+double LightBounds::Importance(const Point3& p, const Vector3& n) const {
+    Point3 center = (lo + hi) * 0.5;
+    Vector3 d = p - center;
+    double dist2 = d.lengthSquared();
+    double radius2 = (hi - center).lengthSquared();
+
+    // angular radius of the box seen from p, everything when p is inside
+    double cos_theta_b = -1.0;
+    if (dist2 > radius2) cos_theta_b = SafeSqrt(1.0 - radius2 / dist2);
+    if (dist2 == 0.0) return phi;
+    Vector3 wi = d / std::sqrt(dist2);
+
+    // emission: closest light axis to p, then the emission cone
+    double cos_theta_w = dot(w, wi);
+    double cos_theta_x = CosSubClamped(cos_theta_w, cos_theta_o);
+    double cos_theta_p = CosSubClamped(cos_theta_x, cos_theta_b);
+    // strict: a hard-edged spot (theta_e = 0) still lights the points inside its cone
+    if (cos_theta_p < cos_theta_e) return 0.0;
+
+    // reception: Lambert term towards the closest point of the box
+    double cos_theta_i = -dot(wi, n);
+    double cos_theta_ip = CosSubClamped(cos_theta_i, cos_theta_b);
+    if (cos_theta_ip <= 0.0) return 0.0;
+
+    return phi * cos_theta_p * cos_theta_ip;
+}
+
+void LightTree::Clear() {
+    m_nodes.clear();
+    m_unbounded.clear();
+    m_count = 0;
+    m_depth = 0;
+}
+
+void LightTree::Build(const std::vector<std::shared_ptr<Light>>& lights) {
+    Clear();
+
+    std::vector<Item> items;
+    for (size_t i = 0; i < lights.size(); i++) {
+        LightBounds bounds;
+        if (LightBounds::FromLight(*lights[i], bounds)) items.push_back({bounds, i});
+        else if (dynamic_cast<const DirectionalLight*>(lights[i].get())) m_unbounded.push_back(i);
+    }
+
+    m_count = items.size();
+    if (items.empty()) return;
+    m_nodes.reserve(2 * items.size() - 1);
+    BuildNode(items, 0, items.size(), 1);
+}
+
+// split with the lowest surface area orientation heuristic (SAOH) among 12 buckets per axis
+size_t LightTree::BuildNode(std::vector<Item>& items, size_t begin, size_t end, int depth) {
+    m_depth = std::max(m_depth, depth);
+    const size_t index = m_nodes.size();
+    m_nodes.emplace_back();
+
+    if (end - begin == 1) {
+        m_nodes[index].bounds = items[begin].bounds;
+        m_nodes[index].index = items[begin].light;
+        m_nodes[index].leaf = true;
+        return index;
+    }
+
+    LightBounds bounds;
+    Point3 c_lo = items[begin].bounds.lo, c_hi = c_lo;
+    for (size_t i = begin; i < end; i++) {
+        bounds = LightBounds::Union(bounds, items[i].bounds);
+        Point3 c = (items[i].bounds.lo + items[i].bounds.hi) * 0.5;
+        c_lo = Point3(std::fmin(c_lo.x, c.x), std::fmin(c_lo.y, c.y), std::fmin(c_lo.z, c.z));
+        c_hi = Point3(std::fmax(c_hi.x, c.x), std::fmax(c_hi.y, c.y), std::fmax(c_hi.z, c.z));
+    }
+
+    constexpr int kBuckets = 12;
+    Vector3 extent = bounds.hi - bounds.lo;
+    double max_extent = std::fmax(extent.x, std::fmax(extent.y, extent.z));
+    double best_cost = INFINITY;
+    int best_axis = -1, best_bucket = -1;
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (c_hi[axis] <= c_lo[axis]) continue;
+
+        auto bucket_of = [&](const Item& item) {
+            double c = (item.bounds.lo[axis] + item.bounds.hi[axis]) * 0.5;
+            int b = static_cast<int>(kBuckets * (c - c_lo[axis]) / (c_hi[axis] - c_lo[axis]));
+            return std::min(b, kBuckets - 1);
+        };
+
+        LightBounds buckets[kBuckets];
+        for (size_t i = begin; i < end; i++) {
+            int b = bucket_of(items[i]);
+            buckets[b] = LightBounds::Union(buckets[b], items[i].bounds);
+        }
+
+        // elongated boxes split across their long side are favoured (Kr)
+        double kr = max_extent / std::fmax(extent[axis], 1e-12);
+        auto cost = [&](const LightBounds& b) {
+            return b.phi == 0.0 ? 0.0 : b.phi * OrientationMeasure(b) * SurfaceArea(b.lo, b.hi);
+        };
+        for (int split = 0; split < kBuckets - 1; split++) {
+            LightBounds below, above;
+            for (int b = 0; b <= split; b++) below = LightBounds::Union(below, buckets[b]);
+            for (int b = split + 1; b < kBuckets; b++) above = LightBounds::Union(above, buckets[b]);
+            if (below.phi == 0.0 || above.phi == 0.0) continue;
+
+            double c = kr * (cost(below) + cost(above));
+            if (c < best_cost) {
+                best_cost = c;
+                best_axis = axis;
+                best_bucket = split;
+            }
+        }
+    }
+
+    size_t mid;
+    if (best_axis < 0) {
+        // all lights at the same place: any halving will do
+        mid = begin + (end - begin) / 2;
+    } else {
+        const int axis = best_axis;
+        auto pivot = std::partition(items.begin() + begin, items.begin() + end, [&](const Item& item) {
+            double c = (item.bounds.lo[axis] + item.bounds.hi[axis]) * 0.5;
+            int b = static_cast<int>(kBuckets * (c - c_lo[axis]) / (c_hi[axis] - c_lo[axis]));
+            return std::min(b, kBuckets - 1) <= best_bucket;
+        });
+        mid = pivot - items.begin();
+        if (mid == begin || mid == end) mid = begin + (end - begin) / 2;
+    }
+
+    m_nodes[index].bounds = bounds;
+    BuildNode(items, begin, mid, depth + 1);
+    size_t second = BuildNode(items, mid, end, depth + 1);
+    m_nodes[index].index = second;
+    return index;
+}
+
+bool LightTree::Sample(const Point3& p, const Vector3& n, double u, size_t& light, double& pmf) const {
+    if (m_nodes.empty()) return false;
+
+    size_t i = 0;
+    pmf = 1.0;
+    if (m_nodes[0].leaf && m_nodes[0].bounds.Importance(p, n) <= 0.0) return false;
+
+    while (!m_nodes[i].leaf) {
+        const size_t first = i + 1, second = m_nodes[i].index;
+        double importance_first = m_nodes[first].bounds.Importance(p, n);
+        double importance_second = m_nodes[second].bounds.Importance(p, n);
+        if (importance_first <= 0.0 && importance_second <= 0.0) return false;
+
+        // reuse u for the next level once rescaled to the chosen side
+        double p_first = importance_first / (importance_first + importance_second);
+        if (u < p_first) {
+            i = first;
+            pmf *= p_first;
+            u = std::fmin(u / p_first, 0x1.fffffffffffffp-1);
+        } else {
+            i = second;
+            pmf *= 1.0 - p_first;
+            u = std::fmin((u - p_first) / (1.0 - p_first), 0x1.fffffffffffffp-1);
+        }
+    }
+
+    light = m_nodes[i].index;
+    return true;
+}
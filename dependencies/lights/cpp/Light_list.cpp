@@ -0,0 +1,39 @@
+/*
+    Light_list.cpp
+    Stochastic light selection through the light tree
+*/
+
+#include "../hpp/Light_list.hpp"
+
+void Light_list::prepareSampling() const {
+    area_lights.Prepare();
+    if (!m_treeDirty) return;
+    m_tree.Build(Lights_list);
+    m_treeDirty = false;
+}
+
+bool Light_list::sampleIllumination(hit_record &hitPoint, const hittable_list &Objects, double u, int count, Vector3 &outColor) const {
+    Vector3 tempColor(0, 0, 0);
+    outColor = Vector3(0, 0, 0);
+    bool isAnyLightHitting = false;
+
+    // unbounded lights reach every point, no point in sampling them
+    for (size_t index : m_tree.Unbounded()) {
+        if (Lights_list[index]->computeIllumination(hitPoint, Objects, tempColor)) {
+            outColor += tempColor;
+            isAnyLightHitting = true;
+        }
+    }
+
+    count = count < 1 ? 1 : count;
+    for (int k = 0; k < count; k++) {
+        size_t index;
+        double pmf;
+        if (!m_tree.Sample(hitPoint.p, hitPoint.normal, (u + k) / count, index, pmf)) continue;
+        if (Lights_list[index]->computeIllumination(hitPoint, Objects, tempColor)) {
+            outColor += tempColor / (pmf * count);
+            isAnyLightHitting = true;
+        }
+    }
+    return isAnyLightHitting;
+}
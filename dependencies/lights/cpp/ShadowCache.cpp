@@ -0,0 +1,69 @@
+/*
+    ShadowCache.cpp
+    Direct-mapped table of occluders per thread, invalidated by a global epoch
+*/
+
+#include "../hpp/ShadowCache.hpp"
+#include "utils/hpp/RenderStats.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace {
+
+// lights hashing to the same entry just evict each other
+constexpr int kEntries = 64;
+
+struct Entry {
+    const void* light = nullptr;
+    const hittable* occluder = nullptr;
+    uint32_t epoch = 0;
+};
+
+std::atomic<uint32_t> s_Epoch(1);
+std::atomic<bool> s_Enabled(true);
+thread_local Entry t_Entries[kEntries];
+
+Entry& EntryOf(const void* light) {
+    uint64_t h = reinterpret_cast<uintptr_t>(light);
+    h ^= h >> 17;
+    h *= 0x9e3779b97f4a7c15ull;
+    return t_Entries[h >> 58];
+}
+
+} // namespace
+
+bool ShadowCache::Occluded(const void* light, const hittable_list& world, const Ray& shadow_ray, double t_min, double t_max) {
+    hit_record rec;
+    if (!s_Enabled.load(std::memory_order_relaxed)) return world.hit(shadow_ray, &t_min, &t_max, rec);
+
+    Entry& entry = EntryOf(light);
+    const uint32_t epoch = s_Epoch.load(std::memory_order_relaxed);
+    if (entry.light == light && entry.epoch == epoch && entry.occluder) {
+        RT_STAT(shadow_cache_lookups);
+        double lo = t_min, hi = t_max;
+        if (entry.occluder->hit(shadow_ray, &lo, &hi, rec)) {
+            RT_STAT(shadow_cache_hits);
+            return true;
+        }
+    }
+
+    // full traversal, its closest hit becomes the occluder to try next time
+    if (!world.hit(shadow_ray, &t_min, &t_max, rec)) return false;
+    entry.light = light;
+    entry.epoch = epoch;
+    entry.occluder = rec.object;
+    return true;
+}
+
+void ShadowCache::Invalidate() {
+    s_Epoch.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ShadowCache::SetEnabled(bool enabled) {
+    s_Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool ShadowCache::IsEnabled() {
+    return s_Enabled.load(std::memory_order_relaxed);
+}
@@ -4,6 +4,7 @@
 */
 
 #include "../hpp/SpotLight.hpp"
+#include "../hpp/ShadowCache.hpp"
 #include "materials/hpp/Material.hpp"
 #include <cmath>
 
@@ -31,10 +32,11 @@ bool SpotLight::computeIllumination(hit_record &rec, const hittable_list &world,
     
     // shadow test
     Ray shadow_ray(rec.p + rec.normal * 0.001, light_dir);
-    hit_record shadow_rec;
     double t_min = 0.001;
 
-    if (world.hit(shadow_ray, &t_min, &distance_to_light, shadow_rec)) {
+    RT_STAT(shadow_rays);
+    if (ShadowCache::Occluded(this, world, shadow_ray, t_min, distance_to_light)) {
+        RT_STAT(hits);
         return false;
     }
 
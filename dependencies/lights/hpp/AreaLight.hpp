@@ -0,0 +1,84 @@
+/*
+    AreaLight.hpp
+    Emissive primitives (spheres, quads, triangles) sampled for direct lighting
+    Lights are picked proportionally to their power, then a point is sampled on the chosen one
+*/
+
+#ifndef AREALIGHT_HPP
+#define AREALIGHT_HPP
+
+#include "utils/hpp/Vector3.hpp"
+#include "objects/hpp/_Generic.hpp"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// a sampled point on a light, seen from a reference point
+struct LightSample {
+    Point3 point;
+    Vector3 normal;
+    Vector3 wi;          // unit direction from the reference point to the light
+    double distance;
+    double pdf;          // per steradian, includes the probability of picking the light
+    Vector3 radiance;
+};
+
+class AreaLight {
+public:
+    enum class Shape { Sphere = 0, Quad, Triangle };
+
+    Shape shape = Shape::Sphere;
+    std::shared_ptr<hittable> object;   // the emitting primitive
+    Point3 origin;                      // sphere center, quad corner or first vertex
+    Vector3 edge1, edge2;               // quad edges or triangle edges (v1 - v0, v2 - v0)
+    Vector3 normal;                     // front face of quads and triangles
+    double radius = 0.0;
+    double area = 0.0;
+    Vector3 radiance;
+    double power = 0.0;                 // luminance * area, drives the light choice
+
+    // false if the primitive is not an emitter of a supported shape
+    static bool FromObject(const std::shared_ptr<hittable>& object, AreaLight& light);
+
+    // point on the light for the reference point, false if it can't be seen from there
+    // (back face, reference point inside the sphere); pdf per steradian
+    bool Sample(const Point3& ref, double u, double v, LightSample& ls) const;
+
+    // pdf per steradian of Sample() for the ray origin -> rec.p (rec is the hit on the light)
+    double Pdf(const Point3& ref, const hit_record& rec) const;
+};
+
+class AreaLightList {
+public:
+    // registers the primitive if it is an emitter, true if it was added
+    bool Add(const std::shared_ptr<hittable>& object);
+    // follows an edited primitive (moved copy, material change...)
+    void Replace(const hittable* old_object, const std::shared_ptr<hittable>& object);
+    void Clear();
+
+    // rebuilds the power distribution after Add/Replace: call before rendering, never during
+    void Prepare() const;
+
+    bool Empty() const { return m_lights.empty(); }
+    size_t Size() const { return m_lights.size(); }
+    const std::vector<AreaLight>& Lights() const { return m_lights; }
+
+    // light of a hit primitive, nullptr if it does not emit
+    const AreaLight* Find(const hittable* object) const;
+
+    // picks a light with u_choice, then a point on it with (u, v)
+    bool Sample(const Point3& ref, double u_choice, double u, double v, LightSample& ls) const;
+
+    // pdf per steradian of Sample() returning this hit on the light
+    double Pdf(const AreaLight& light, const Point3& ref, const hit_record& rec) const;
+
+private:
+    void Reindex();
+
+    std::vector<AreaLight> m_lights;
+    mutable std::vector<double> m_cdf;  // normalized cumulative power, built by Prepare()
+    mutable bool m_cdfDirty = false;
+    std::unordered_map<const hittable*, size_t> m_index;
+};
+
+#endif
@@ -0,0 +1,65 @@
+/*
+    LightTree.hpp
+    Bounding hierarchy over the point and spot lights, to pick one light per shading point
+    Each node bounds its lights' positions, total power and emission cone
+*/
+
+#ifndef LIGHTTREE_HPP
+#define LIGHTTREE_HPP
+
+#include "Light.hpp"
+#include <memory>
+#include <vector>
+
+// what a group of lights can deliver: where they are, how much and in which directions
+struct LightBounds {
+    Point3 lo, hi;                // box around the positions
+    Vector3 w;                    // axis of the emission cone
+    double phi = 0.0;             // total luminance of the intensities
+    double cos_theta_o = -1.0;    // spread of the light axes around w (-1: any direction)
+    double cos_theta_e = 0.0;     // emission angle around each axis (spot outer - inner cone)
+
+    // false for lights that can't be bounded (directional) or that emit nothing
+    static bool FromLight(const Light& light, LightBounds& bounds);
+    static LightBounds Union(const LightBounds& a, const LightBounds& b);
+
+    // upper estimate of the light received at p with normal n, 0 when none can reach it
+    // (no distance term: the lights of this renderer have no falloff)
+    double Importance(const Point3& p, const Vector3& n) const;
+};
+
+class LightTree {
+public:
+    // indices refer to the lights vector, unbounded lights are listed apart
+    void Build(const std::vector<std::shared_ptr<Light>>& lights);
+    void Clear();
+
+    bool Empty() const { return m_nodes.empty(); }
+    size_t Size() const { return m_count; }
+    int Depth() const { return m_depth; }
+    const std::vector<size_t>& Unbounded() const { return m_unbounded; }
+
+    // walks down with u, choosing each child in proportion to its importance;
+    // pmf is the probability of the light returned, false if no light can reach p
+    bool Sample(const Point3& p, const Vector3& n, double u, size_t& light, double& pmf) const;
+
+private:
+    struct Node {
+        LightBounds bounds;
+        size_t index = 0;     // light for leaves, second child for inner nodes (first child follows)
+        bool leaf = false;
+    };
+    struct Item {
+        LightBounds bounds;
+        size_t light;
+    };
+
+    size_t BuildNode(std::vector<Item>& items, size_t begin, size_t end, int depth);
+
+    std::vector<Node> m_nodes;
+    std::vector<size_t> m_unbounded;
+    size_t m_count = 0;
+    int m_depth = 0;
+};
+
+#endif
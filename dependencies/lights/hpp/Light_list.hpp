@@ -9,6 +9,8 @@
 
 
 #include "Light.hpp"
+#include "AreaLight.hpp"
+#include "LightTree.hpp"
 
 #include <memory>
 #include <vector>
@@ -19,16 +21,32 @@ using std::shared_ptr;
 class Light_list : public Light {
   public:
     std::vector<shared_ptr<Light>> Lights_list;
+    AreaLightList area_lights;   // emissive primitives, sampled by the path tracer (not by computeIllumination)
 
     Light_list() {}
     Light_list(shared_ptr<Light> light) { add(light); } 
 
-    void clear() { Lights_list.clear(); }
+    void clear() { Lights_list.clear(); m_treeDirty = true; }
 
     void add(shared_ptr<Light> light) {
         Lights_list.push_back(light);
+        m_treeDirty = true;
     }
 
+    void set(size_t index, shared_ptr<Light> light) {
+        Lights_list.at(index) = std::move(light);
+        m_treeDirty = true;
+    }
+
+    // rebuilds the light tree and the area light distribution after edits: call before rendering, never during
+    void prepareSampling() const;
+    bool treeReady() const { return !m_treeDirty; }
+    const LightTree& tree() const { return m_tree; }
+
+    // directional lights in full, plus count lights picked from the tree
+    // (u stratified over the count), each divided by its probability
+    bool sampleIllumination(hit_record &hitPoint, const hittable_list &Objects, double u, int count, Vector3 &outColor) const;
+
     // iterates over all lights and sums their contributions
     bool computeIllumination(hit_record &hitPoint, const hittable_list &Objects, Vector3 &outColor) const override {
         Vector3 tempColor(0, 0, 0);
@@ -44,6 +62,10 @@ class Light_list : public Light {
         }
         return isAnyLightHitting; 
     }
+
+  private:
+    mutable LightTree m_tree;
+    mutable bool m_treeDirty = true;
 };
 
 #endif
\ No newline at end of file
@@ -9,6 +9,7 @@
 
 #include "Light.hpp"
 #include "materials/hpp/Material.hpp"
+#include "ShadowCache.hpp"
 
 class PointLight : public Light {
 public:
@@ -18,12 +19,13 @@ public:
         Vector3 light_dir = (position - rec.p).normalize();
         Ray shadow_ray(rec.p + rec.normal * 0.001, light_dir); // offset to avoid self-intersection (shadow acne)
         
-        hit_record shadow_rec;
         double t_min = 0.001;
         double distance_to_light = (position - rec.p).length();
 
         // check if something blocks the light
-        if (world.hit(shadow_ray, &t_min, &distance_to_light, shadow_rec)) {
+        RT_STAT(shadow_rays);
+        if (ShadowCache::Occluded(this, world, shadow_ray, t_min, distance_to_light)) {
+            RT_STAT(hits);
             return false; 
         }
 
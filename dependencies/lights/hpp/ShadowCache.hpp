@@ -0,0 +1,26 @@
+/*
+    ShadowCache.hpp
+    Per-thread "last occluder" of each light: the primitive that blocked the previous
+    shadow ray toward a light is tested before traversing the BVH again
+*/
+
+#ifndef SHADOWCACHE_HPP
+#define SHADOWCACHE_HPP
+
+#include "objects/hpp/_Generic.hpp"
+#include "objects/hpp/_Hittable_object_list.hpp"
+
+class ShadowCache {
+public:
+    // true if something blocks shadow_ray in [t_min, t_max]; light is only used as a key
+    static bool Occluded(const void* light, const hittable_list& world, const Ray& shadow_ray, double t_min, double t_max);
+
+    // forgets every cached occluder, on every thread: call before a render, since the
+    // primitives the caches point to may have been replaced since the last one
+    static void Invalidate();
+
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled();
+};
+
+#endif
@@ -8,7 +8,7 @@
 
 Dielectric::Dielectric(double index_of_refraction) : ir(index_of_refraction) {}
 
-bool Dielectric::scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered) const {
+bool Dielectric::scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered, Sampler& sampler) const {
     attenuation = Vector3(1.0, 1.0, 1.0);  // Glass absorbs nothing
     
     // Ratio depends on whether we're entering or exiting the material
@@ -23,7 +23,7 @@ bool Dielectric::scatter(const Ray& r_in, const hit_record& rec, Vector3& attenu
     Vector3 direction;
     
     // Use Schlick approximation for reflectance at steep angles
-    if (cannot_refract || reflectance(cos_theta, refraction_ratio) > random_double())
+    if (cannot_refract || reflectance(cos_theta, refraction_ratio) > sampler.Get1D(Sampler::kBsdfLobe))
         direction = reflect(unit_direction, rec.normal);
     else
         direction = refract(unit_direction, rec.normal, refraction_ratio);
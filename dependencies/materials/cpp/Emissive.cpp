@@ -0,0 +1,19 @@
+/*
+    Emissive.cpp
+    Light emitting material implementation
+*/
+
+#include "../hpp/Emissive.hpp"
+
+Emissive::Emissive(const Vector3& radiance) : radiance(radiance) {}
+
+bool Emissive::scatter(const Ray& /*r_in*/, const hit_record& /*rec*/, Vector3& /*attenuation*/, Ray& /*scattered*/,
+                       Sampler& /*sampler*/) const {
+    // emitters absorb everything they receive
+    return false;
+}
+
+Vector3 Emissive::emitted(const Ray& /*r_in*/, const hit_record& rec) const {
+    // one-sided: spheres emit outwards, quads and triangles on their normal side
+    return rec.front_face ? radiance : Vector3(0, 0, 0);
+}
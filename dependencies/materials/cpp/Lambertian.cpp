@@ -9,18 +9,20 @@
 
 Lambertian::Lambertian(const Vector3& a) : albedo(a) {}
 
-bool Lambertian::scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered) const {
+bool Lambertian::scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered, Sampler& sampler) const {
 
-    Vector3 scatter_direction = rec.normal + random_unit_vector();
-    
-    if (fabs(scatter_direction.x) < 1e-8 && fabs(scatter_direction.y) < 1e-8 && fabs(scatter_direction.z) < 1e-8) {
-        scatter_direction = rec.normal;
-    }
-        
+    // cosine-weighted direction around the (unit) normal, pdf = cos / pi cancels with the BRDF
+    double u, v;
+    sampler.Get2D(Sampler::kBsdfDirection, u, v);
+    Vector3 scatter_direction = Sampling::ToWorld(Sampling::CosineHemisphere(u, v), rec.normal);
 
     scattered = Ray(rec.p, scatter_direction);
 
     attenuation = albedo;
     
     return true;
+}
+
+double Lambertian::scatteringPdf(const Ray& /*r_in*/, const hit_record& rec, const Vector3& direction) const {
+    return Sampling::CosineHemispherePdf(dot(rec.normal, unit_vector(direction)));
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+/*
+    MaterialLibrary.cpp
+    Material interning and named lookup
+*/
+
+#include "../hpp/MaterialLibrary.hpp"
+#include "../hpp/Lambertian.hpp"
+#include "../hpp/Metal.hpp"
+#include "../hpp/Dielectric.hpp"
+#include "../hpp/Emissive.hpp"
+#include <functional>
+
+size_t MaterialLibrary::KeyHash::operator()(const Key& k) const {
+    std::hash<double> h;
+    size_t seed = std::hash<int>()(k.type);
+    for (double v : {k.r, k.g, k.b, k.param}) {
+        seed ^= h(v) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+}
+
+std::shared_ptr<Material> MaterialLibrary::Intern(int type, const Vector3& color, double fuzz, double ior) {
+    m_requests++;
+
+    // canonical key: drop the parameters the type does not use
+    Key key{type, color.x, color.y, color.z, 0.0};
+    if (type == MetalType) {
+        key.param = fuzz < 1 ? fuzz : 1;  // same clamp as Metal
+    } else if (type == DielectricType) {
+        key.r = key.g = key.b = 1.0;
+        key.param = ior;
+    } else if (type == EmissiveType) {
+        // radiance in the color, no parameter
+    } else {
+        key.type = LambertianType;
+    }
+
+    auto it = m_interned.find(key);
+    if (it != m_interned.end()) return it->second;
+
+    std::shared_ptr<Material> m;
+    if (key.type == MetalType) m = std::make_shared<Metal>(color, fuzz);
+    else if (key.type == DielectricType) m = std::make_shared<Dielectric>(ior);
+    else if (key.type == EmissiveType) m = std::make_shared<Emissive>(color);
+    else m = std::make_shared<Lambertian>(color);
+
+    m_interned.emplace(key, m);
+    m_materials.push_back(m);
+    return m;
+}
+
+void MaterialLibrary::AddNamed(const std::string& name, std::shared_ptr<Material> material) {
+    m_named[name] = std::move(material);
+}
+
+std::shared_ptr<Material> MaterialLibrary::GetNamed(const std::string& name) const {
+    auto it = m_named.find(name);
+    return it == m_named.end() ? nullptr : it->second;
+}
+
+void MaterialLibrary::Clear() {
+    m_interned.clear();
+    m_named.clear();
+    m_materials.clear();
+    m_requests = 0;
+}
@@ -8,12 +8,15 @@
 
 Metal::Metal(const Vector3& a, double f) : albedo(a), fuzz(f < 1 ? f : 1) {}
 
-bool Metal::scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered) const {
+bool Metal::scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered, Sampler& sampler) const {
     // Perfect reflection direction
     Vector3 reflected = reflect(unit_vector(r_in.direction()), rec.normal);
     
-    // Add fuzz perturbation for rough metals
-    scattered = Ray(rec.p, reflected + fuzz * random_in_unit_sphere());
+    // Add fuzz perturbation for rough metals: uniform point in the unit ball,
+    // direction from the BSDF pair and radius from the lobe dimension
+    double u, v;
+    sampler.Get2D(Sampler::kBsdfDirection, u, v);
+    scattered = Ray(rec.p, reflected + fuzz * Sampling::UniformBall(u, v, sampler.Get1D(Sampler::kBsdfLobe)));
     attenuation = albedo;
     
     // Only scatter if reflected ray goes outward
@@ -16,7 +16,7 @@ public:
     Dielectric(double index_of_refraction);
     
     Vector3 baseColor() const override { return Vector3(1.0, 1.0, 1.0); }
-    bool scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered) const override;
+    bool scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered, Sampler& sampler) const override;
 };
 
 #endif
@@ -0,0 +1,23 @@
+/*
+    Emissive.hpp
+    Light emitting material (area lights)
+    Emits a constant radiance from the front face and reflects nothing
+*/
+
+#ifndef EMISSIVE_HPP
+#define EMISSIVE_HPP
+
+#include "Material.hpp"
+
+class Emissive : public Material {
+public:
+    Vector3 radiance;  // emitted radiance, may exceed 1
+
+    Emissive(const Vector3& radiance);
+
+    Vector3 baseColor() const override { return Vector3(0, 0, 0); }
+    bool scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered, Sampler& sampler) const override;
+    Vector3 emitted(const Ray& r_in, const hit_record& rec) const override;
+};
+
+#endif
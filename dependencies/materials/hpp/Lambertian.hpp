@@ -15,7 +15,8 @@ public:
     Lambertian(const Vector3& a);
     
     Vector3 baseColor() const override { return albedo; }
-    bool scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered) const override;
+    bool scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered, Sampler& sampler) const override;
+    double scatteringPdf(const Ray& r_in, const hit_record& rec, const Vector3& direction) const override;
 };
 
 #endif
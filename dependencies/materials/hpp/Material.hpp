@@ -12,6 +12,7 @@
 #include <cstdlib>
 #include "../../camera/hpp/Ray.hpp"
 #include "../../utils/hpp/Vector3.hpp"
+#include "../../utils/hpp/Sampler.hpp"
 #include "../../objects/hpp/_Generic.hpp"
 #include "../../libs.hpp"  // Provides random_double(), random_in_unit_sphere(), random_unit_vector()
 
@@ -21,7 +22,16 @@ public:
     virtual ~Material() = default;
     // base (albedo/tint) color used for direct lighting
     virtual Vector3 baseColor() const = 0;
-    // computes scattered ray and attenuation, returns false if ray is absorbed
-    virtual bool scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered) const = 0;
+    // computes scattered ray and attenuation, returns false if ray is absorbed;
+    // random decisions read the BSDF dimensions of the current bounce from sampler
+    virtual bool scatter(const Ray& r_in, const hit_record& rec, Vector3& attenuation, Ray& scattered, Sampler& sampler) const = 0;
+
+    // radiance leaving the surface by itself, black unless the material is an emitter
+    virtual Vector3 emitted(const Ray& /*r_in*/, const hit_record& /*rec*/) const { return Vector3(0, 0, 0); }
+
+    // solid angle density with which scatter() picks direction; 0 for specular materials
+    // (mirror, glass, fuzzed metal), which are then skipped by light sampling.
+    // Materials returning a pdf must scatter with attenuation = brdf * cos / pdf.
+    virtual double scatteringPdf(const Ray& /*r_in*/, const hit_record& /*rec*/, const Vector3& /*direction*/) const { return 0.0; }
 };
 #endif
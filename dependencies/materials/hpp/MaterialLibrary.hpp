@@ -0,0 +1,56 @@
+/*
+    MaterialLibrary.hpp
+    Shared materials of a scene
+    Named materials plus deduplication of identical inline definitions
+*/
+
+#ifndef MATERIALLIBRARY_HPP
+#define MATERIALLIBRARY_HPP
+
+#include "Material.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class MaterialLibrary {
+public:
+    // material types, same numbering as "material_type" in the JSON scenes
+    enum Type { LambertianType = 0, MetalType = 1, DielectricType = 2, EmissiveType = 3 };
+
+    // returns the shared instance for these parameters, created on first use
+    // (color is ignored for dielectrics and is the radiance of emitters,
+    // fuzz/ior only matter for their own type)
+    std::shared_ptr<Material> Intern(int type, const Vector3& color, double fuzz = 0.1, double ior = 1.5);
+
+    // named materials from the "materials" section of a scene
+    void AddNamed(const std::string& name, std::shared_ptr<Material> material);
+    std::shared_ptr<Material> GetNamed(const std::string& name) const;
+    bool HasNamed(const std::string& name) const { return m_named.count(name) != 0; }
+
+    // number of distinct material instances and number of requests served
+    size_t UniqueCount() const { return m_materials.size(); }
+    size_t RequestCount() const { return m_requests; }
+    const std::vector<std::shared_ptr<Material>>& GetAll() const { return m_materials; }
+
+    void Clear();
+
+private:
+    struct Key {
+        int type;
+        double r, g, b, param;
+        bool operator==(const Key& o) const {
+            return type == o.type && r == o.r && g == o.g && b == o.b && param == o.param;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const;
+    };
+
+    std::unordered_map<Key, std::shared_ptr<Material>, KeyHash> m_interned;
+    std::unordered_map<std::string, std::shared_ptr<Material>> m_named;
+    std::vector<std::shared_ptr<Material>> m_materials;  // every unique instance, in creation order
+    size_t m_requests = 0;
+};
+
+#endif
@@ -8,6 +8,7 @@
 #include <cmath>
 
 bool Cone::hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec) const {
+    RT_STAT_PRIMITIVE(Cone);
     bool hit_anything = false;
     double closest_so_far = *ray_tmax;
     hit_record temp_rec;
@@ -48,6 +49,7 @@ bool Cone::hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec
                     
                     temp_rec.set_face_normal(r, outward_normal);
                     temp_rec.mat_ptr = mat_ptr;
+                    temp_rec.object = this;
                     
                     closest_so_far = t;
                     rec = temp_rec;
@@ -73,6 +75,7 @@ bool Cone::hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec
                 temp_rec.p = p;
                 temp_rec.set_face_normal(r, axis);
                 temp_rec.mat_ptr = mat_ptr;
+                temp_rec.object = this;
                 
                 closest_so_far = t_base;
                 rec = temp_rec;
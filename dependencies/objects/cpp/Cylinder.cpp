@@ -8,6 +8,7 @@
 #include <cmath>
 
 bool Cylinder::hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec) const {
+    RT_STAT_PRIMITIVE(Cylinder);
     bool hit_anything = false;
     double closest_so_far = *ray_tmax;
     hit_record temp_rec;
@@ -42,6 +43,7 @@ bool Cylinder::hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record&
                     Vector3 outward_normal = (p - axis_point).normalize();
                     temp_rec.set_face_normal(r, outward_normal);
                     temp_rec.mat_ptr = mat_ptr;
+                    temp_rec.object = this;
                     
                     closest_so_far = t;
                     rec = temp_rec;
@@ -64,6 +66,7 @@ bool Cylinder::hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record&
                 temp_rec.p = p;
                 temp_rec.set_face_normal(r, -axis);
                 temp_rec.mat_ptr = mat_ptr;
+                temp_rec.object = this;
                 
                 closest_so_far = t_base;
                 rec = temp_rec;
@@ -83,6 +86,7 @@ bool Cylinder::hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record&
                 temp_rec.p = p;
                 temp_rec.set_face_normal(r, axis);
                 temp_rec.mat_ptr = mat_ptr;
+                temp_rec.object = this;
                 
                 closest_so_far = t_top;
                 rec = temp_rec;
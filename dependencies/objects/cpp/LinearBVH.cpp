@@ -0,0 +1,345 @@
+/*
+    LinearBVH.cpp
+    LBVH construction (Karras 2012) and treelet restructuring (Karras & Aila 2013)
+    Every stage runs in parallel with OpenMP
+*/
+
+#include "../hpp/LinearBVH.hpp"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <omp.h>
+
+namespace {
+
+// spreads the low 10 bits of v so there are two zero bits between each of them
+uint64_t ExpandBits10(uint64_t v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x30000ff;
+    v = (v | (v << 8)) & 0x300f00f;
+    v = (v | (v << 4)) & 0x30c30c3;
+    v = (v | (v << 2)) & 0x9249249;
+    return v;
+}
+
+// same for the low 21 bits
+uint64_t ExpandBits21(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | (v << 32)) & 0x1f00000000ffffull;
+    v = (v | (v << 16)) & 0x1f0000ff0000ffull;
+    v = (v | (v << 8)) & 0x100f00f00f00f00full;
+    v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+    v = (v | (v << 2)) & 0x1249249249249249ull;
+    return v;
+}
+
+uint64_t Quantize(double x, double scale) {
+    return static_cast<uint64_t>(std::min(std::max(x * scale, 0.0), scale - 1.0));
+}
+
+Point3 Centroid(const aabb& box) {
+    return Point3(0.5 * (box.x.min + box.x.max), 0.5 * (box.y.min + box.y.max), 0.5 * (box.z.min + box.z.max));
+}
+
+const int kTreeletLeaves = 7;       // 2^7 subsets per treelet
+const uint32_t kTaskGrain = 4096;   // subtrees smaller than this are converted by one thread
+
+} // namespace
+
+uint64_t LinearBVH::Morton30(double x, double y, double z) {
+    const double scale = 1024.0;
+    return (ExpandBits10(Quantize(x, scale)) << 2) | (ExpandBits10(Quantize(y, scale)) << 1) | ExpandBits10(Quantize(z, scale));
+}
+
+uint64_t LinearBVH::Morton63(double x, double y, double z) {
+    const double scale = 2097152.0;
+    return (ExpandBits21(Quantize(x, scale)) << 2) | (ExpandBits21(Quantize(y, scale)) << 1) | ExpandBits21(Quantize(z, scale));
+}
+
+void LinearBVH::RadixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, int key_bits) {
+    const size_t n = keys.size();
+    std::vector<uint64_t> keys_tmp(n);
+    std::vector<uint32_t> values_tmp(n);
+    const int passes = (key_bits + 7) / 8;
+    std::vector<size_t> offsets(static_cast<size_t>(omp_get_max_threads()) * 256);
+
+    for (int pass = 0; pass < passes; pass++) {
+        const int shift = pass * 8;
+
+        #pragma omp parallel
+        {
+            const int t = omp_get_thread_num();
+            const int nt = omp_get_num_threads();
+            const size_t begin = n * t / nt, end = n * (t + 1) / nt;
+            size_t* count = &offsets[static_cast<size_t>(t) * 256];
+
+            std::fill(count, count + 256, 0);
+            for (size_t i = begin; i < end; i++) count[(keys[i] >> shift) & 0xff]++;
+
+            #pragma omp barrier
+            #pragma omp single
+            {
+                // digit-major then thread-major so the sort stays stable
+                size_t sum = 0;
+                for (int d = 0; d < 256; d++) {
+                    for (int k = 0; k < nt; k++) {
+                        size_t c = offsets[static_cast<size_t>(k) * 256 + d];
+                        offsets[static_cast<size_t>(k) * 256 + d] = sum;
+                        sum += c;
+                    }
+                }
+            }
+
+            for (size_t i = begin; i < end; i++) {
+                size_t pos = count[(keys[i] >> shift) & 0xff]++;
+                keys_tmp[pos] = keys[i];
+                values_tmp[pos] = values[i];
+            }
+        }
+        keys.swap(keys_tmp);
+        values.swap(values_tmp);
+    }
+}
+
+std::shared_ptr<bvh_node> LinearBVH::Build(const hittable_list& list, const Options& options) {
+    const size_t n = list.objects.size();
+    if (n == 0) return nullptr;
+    if (n == 1) return std::make_shared<bvh_node>(list);
+
+    // centroid bounds (not the object bounds, infinite planes would flatten every code)
+    std::vector<aabb> boxes(n);
+    aabb centroids;
+    #pragma omp parallel
+    {
+        aabb local;
+        #pragma omp for schedule(static)
+        for (long i = 0; i < static_cast<long>(n); i++) {
+            boxes[i] = list.objects[i]->bounding_box();
+            Point3 c = Centroid(boxes[i]);
+            local = aabb(local, aabb(c, c));
+        }
+        #pragma omp critical
+        centroids = aabb(centroids, local);
+    }
+
+    const bool wide = options.morton_bits > 30;
+    const double ex = centroids.x.max - centroids.x.min;
+    const double ey = centroids.y.max - centroids.y.min;
+    const double ez = centroids.z.max - centroids.z.min;
+
+    std::vector<uint64_t> codes(n);
+    std::vector<uint32_t> order(n);
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < static_cast<long>(n); i++) {
+        Point3 c = Centroid(boxes[i]);
+        double x = ex > 0 ? (c.x - centroids.x.min) / ex : 0.0;
+        double y = ey > 0 ? (c.y - centroids.y.min) / ey : 0.0;
+        double z = ez > 0 ? (c.z - centroids.z.min) / ez : 0.0;
+        codes[i] = wide ? Morton63(x, y, z) : Morton30(x, y, z);
+        order[i] = static_cast<uint32_t>(i);
+    }
+
+    RadixSort(codes, order, wide ? 63 : 30);
+
+    Hierarchy h;
+    h.nodes.resize(n - 1);
+    h.leaf_parent.resize(n);
+    h.leaf_box.resize(n);
+    h.leaves.resize(n);
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < static_cast<long>(n); i++) {
+        h.leaves[i] = list.objects[order[i]];
+        h.leaf_box[i] = boxes[order[i]];
+    }
+
+    EmitHierarchy(h, codes);
+    if (options.treelet_passes <= 0) BottomUp(h, false);
+    for (int pass = 0; pass < options.treelet_passes; pass++) BottomUp(h, true);
+
+    std::shared_ptr<bvh_node> root;
+    #pragma omp parallel
+    #pragma omp single
+    root = Convert(h, 0);
+    return root;
+}
+
+void LinearBVH::EmitHierarchy(Hierarchy& h, const std::vector<uint64_t>& codes) {
+    const long n = static_cast<long>(codes.size());
+
+    // length of the common prefix of keys i and j, equal codes are told apart by their index
+    auto delta = [&](long i, long j) -> int {
+        if (j < 0 || j >= n) return -1;
+        if (codes[i] == codes[j]) return 64 + __builtin_clzll(static_cast<uint64_t>(i ^ j));
+        return __builtin_clzll(codes[i] ^ codes[j]);
+    };
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n - 1; i++) {
+        // direction of the range covered by node i
+        const int d = delta(i, i + 1) - delta(i, i - 1) > 0 ? 1 : -1;
+        const int delta_min = delta(i, i - d);
+
+        // other end of the range
+        long l_max = 2;
+        while (delta(i, i + l_max * d) > delta_min) l_max *= 2;
+        long l = 0;
+        for (long t = l_max / 2; t >= 1; t /= 2) {
+            if (delta(i, i + (l + t) * d) > delta_min) l += t;
+        }
+        const long j = i + l * d;
+
+        // split position: highest differing bit inside the range
+        const int delta_node = delta(i, j);
+        long s = 0;
+        for (long div = 2; ; div *= 2) {
+            long t = (l + div - 1) / div;
+            if (delta(i, i + (s + t) * d) > delta_node) s += t;
+            if (t <= 1) break;
+        }
+        const long gamma = i + s * d + std::min(d, 0);
+
+        Node& node = h.nodes[i];
+        if (std::min(i, j) == gamma) { node.left = ~static_cast<int>(gamma); h.leaf_parent[gamma] = static_cast<int>(i); }
+        else                         { node.left = static_cast<int>(gamma); h.nodes[gamma].parent = static_cast<int>(i); }
+        if (std::max(i, j) == gamma + 1) { node.right = ~static_cast<int>(gamma + 1); h.leaf_parent[gamma + 1] = static_cast<int>(i); }
+        else                             { node.right = static_cast<int>(gamma + 1); h.nodes[gamma + 1].parent = static_cast<int>(i); }
+    }
+    h.nodes[0].parent = -1;
+}
+
+void LinearBVH::BottomUp(Hierarchy& h, bool restructure) {
+    const long n = static_cast<long>(h.leaves.size());
+    std::vector<std::atomic<int>> visits(n - 1);
+    for (auto& v : visits) v.store(0, std::memory_order_relaxed);
+
+    // one walk per leaf, the second child to arrive processes the parent so
+    // both subtrees are final (and restructured) by then
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; i++) {
+        int node = h.leaf_parent[i];
+        while (node >= 0) {
+            if (visits[node].fetch_add(1, std::memory_order_acq_rel) == 0) break;
+
+            Node& current = h.nodes[node];
+            auto child_box   = [&](int c) { return c >= 0 ? h.nodes[c].box : h.leaf_box[~c]; };
+            auto child_cost  = [&](int c) { return c >= 0 ? h.nodes[c].cost : bvh_node::surface_area(h.leaf_box[~c]); };
+            auto child_count = [&](int c) { return c >= 0 ? h.nodes[c].count : 1u; };
+            current.box = aabb(child_box(current.left), child_box(current.right));
+            current.count = child_count(current.left) + child_count(current.right);
+            current.cost = bvh_node::surface_area(current.box) + child_cost(current.left) + child_cost(current.right);
+
+            if (restructure) RestructureTreelet(h, node);
+            node = current.parent;
+        }
+    }
+}
+
+void LinearBVH::RestructureTreelet(Hierarchy& h, int root) {
+    // grow the treelet by opening the internal node with the largest area
+    int leaves[kTreeletLeaves];
+    int internal[kTreeletLeaves];
+    int leaf_count = 0, internal_count = 0;
+    leaves[leaf_count++] = h.nodes[root].left;
+    leaves[leaf_count++] = h.nodes[root].right;
+
+    while (leaf_count < kTreeletLeaves) {
+        int best = -1;
+        double best_area = -1.0;
+        for (int k = 0; k < leaf_count; k++) {
+            if (leaves[k] < 0) continue;
+            double area = bvh_node::surface_area(h.nodes[leaves[k]].box);
+            if (area > best_area) { best_area = area; best = k; }
+        }
+        if (best < 0) break;
+
+        int opened = leaves[best];
+        internal[internal_count++] = opened;
+        leaves[best] = h.nodes[opened].left;
+        leaves[leaf_count++] = h.nodes[opened].right;
+    }
+    if (leaf_count < 3) return;
+
+    // optimal topology over every subset of the treelet leaves (dynamic programming)
+    const int full = (1 << leaf_count) - 1;
+    aabb box[1 << kTreeletLeaves];
+    double cost[1 << kTreeletLeaves];
+    uint32_t count[1 << kTreeletLeaves];
+    int split[1 << kTreeletLeaves];
+
+    for (int s = 1; s <= full; s++) {
+        const int low = s & -s;
+        if (s == low) {
+            int c = leaves[__builtin_ctz(s)];
+            box[s] = c >= 0 ? h.nodes[c].box : h.leaf_box[~c];
+            cost[s] = c >= 0 ? h.nodes[c].cost : bvh_node::surface_area(box[s]);
+            count[s] = c >= 0 ? h.nodes[c].count : 1u;
+            continue;
+        }
+        box[s] = aabb(box[low], box[s ^ low]);
+        count[s] = count[low] + count[s ^ low];
+
+        // partitions containing the lowest leaf, so each one is tried once
+        double best = std::numeric_limits<double>::infinity();
+        for (int p = (s - 1) & s; p > 0; p = (p - 1) & s) {
+            if (!(p & low)) continue;
+            double c = cost[p] + cost[s ^ p];
+            if (c < best) { best = c; split[s] = p; }
+        }
+        cost[s] = bvh_node::surface_area(box[s]) + best;
+    }
+
+    if (cost[full] >= h.nodes[root].cost * (1.0 - 1e-9)) return;
+
+    // rebuild the treelet in place, reusing its internal nodes
+    int stack_set[kTreeletLeaves], stack_node[kTreeletLeaves];
+    int top = 0, next_internal = 0;
+    stack_set[top] = full;
+    stack_node[top++] = root;
+    while (top > 0) {
+        top--;
+        const int s = stack_set[top];
+        const int node_index = stack_node[top];
+        const int parts[2] = {split[s], s ^ split[s]};
+        int children[2];
+
+        for (int k = 0; k < 2; k++) {
+            const int part = parts[k];
+            if ((part & (part - 1)) == 0) {
+                children[k] = leaves[__builtin_ctz(part)];
+            } else {
+                children[k] = internal[next_internal++];
+                Node& inner = h.nodes[children[k]];
+                inner.box = box[part];
+                inner.cost = cost[part];
+                inner.count = count[part];
+                stack_set[top] = part;
+                stack_node[top++] = children[k];
+            }
+            if (children[k] >= 0) h.nodes[children[k]].parent = node_index;
+            else h.leaf_parent[~children[k]] = node_index;
+        }
+        h.nodes[node_index].left = children[0];
+        h.nodes[node_index].right = children[1];
+    }
+    h.nodes[root].cost = cost[full];
+}
+
+std::shared_ptr<bvh_node> LinearBVH::Convert(const Hierarchy& h, int index) {
+    const Node& node = h.nodes[index];
+    std::shared_ptr<hittable> left, right;
+
+    auto child = [&](int c) -> std::shared_ptr<hittable> {
+        return c >= 0 ? std::static_pointer_cast<hittable>(Convert(h, c)) : h.leaves[~c];
+    };
+
+    if (node.count > kTaskGrain) {
+        #pragma omp task default(shared)
+        left = child(node.left);
+        right = child(node.right);
+        #pragma omp taskwait
+    } else {
+        left = child(node.left);
+        right = child(node.right);
+    }
+    return std::make_shared<bvh_node>(left, right, node.box);
+}
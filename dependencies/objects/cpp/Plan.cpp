@@ -7,6 +7,7 @@
 #include <cmath>
 
 bool Plan::hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec) const {
+    RT_STAT_PRIMITIVE(Plane);
     // ray-plane intersection: t = (point - origin) . normal / (direction . normal)
     auto denom = dot(normal, r.direction());
 
@@ -22,6 +23,7 @@ bool Plan::hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec
     rec.p = r.at(t);
     rec.set_face_normal(r, normal);
     rec.mat_ptr = mat_ptr;
+    rec.object = this;
 
     return true;
 }
\ No newline at end of file
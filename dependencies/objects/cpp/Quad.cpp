@@ -0,0 +1,31 @@
+/*
+    Quad.cpp
+    Ray-parallelogram intersection: plane hit, then planar coordinates in [0, 1]^2
+*/
+
+#include "../hpp/Quad.hpp"
+#include <cmath>
+
+bool Quad::hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec) const {
+    RT_STAT_PRIMITIVE(Quad);
+    double denom = dot(normal, r.direction());
+
+    // ray parallel to the plane
+    if (std::fabs(denom) < 1e-8) return false;
+
+    double t = dot(normal, Q - r.origin()) / denom;
+    if (t < *ray_tmin || t > *ray_tmax) return false;
+
+    Point3 p = r.at(t);
+    Vector3 planar = p - Q;
+    double a = dot(m_w, planar.cross(v));
+    double b = dot(m_w, u.cross(planar));
+    if (a < 0.0 || a > 1.0 || b < 0.0 || b > 1.0) return false;
+
+    rec.t = t;
+    rec.p = p;
+    rec.set_face_normal(r, normal);
+    rec.mat_ptr = mat_ptr;
+    rec.object = this;
+    return true;
+}
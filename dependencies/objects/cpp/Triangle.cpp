@@ -7,6 +7,7 @@
 #include <cmath>
 
 bool Triangle::hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec) const {
+    RT_STAT_PRIMITIVE(Triangle);
     // Moller-Trumbore intersection algorithm
     const double EPSILON = 1e-8;
     
@@ -41,6 +42,7 @@ bool Triangle::hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record&
     rec.p = r.at(t);
     rec.set_face_normal(r, normal);
     rec.mat_ptr = mat_ptr;
+    rec.object = this;
     
     return true;
 }
@@ -27,6 +27,12 @@ public:
 
     virtual bool hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec) const override;
 
+    std::shared_ptr<hittable> translated(const Vector3& offset) const override {
+        auto moved = std::make_shared<Cylinder>(*this);
+        moved->base = base + offset;
+        return moved;
+    }
+
     aabb bounding_box() const override {
     Point3 top = base + axis * height;
     
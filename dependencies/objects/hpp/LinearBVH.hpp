@@ -0,0 +1,57 @@
+/*
+    LinearBVH.hpp
+    Linear BVH builder (LBVH): Morton codes of the centroids, parallel radix sort,
+    hierarchy emitted from the sorted codes, optional treelet refinement
+*/
+
+#ifndef LINEARBVH_HPP
+#define LINEARBVH_HPP
+
+#include "objects/hpp/_Hittable_object_list.hpp"
+#include "objects/hpp/_bvh_node.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class LinearBVH {
+public:
+    struct Options {
+        int morton_bits = 63;     // 30 (10 bits per axis) or 63 (21 bits per axis)
+        int treelet_passes = 0;   // treelet restructuring passes, 0 = plain LBVH
+    };
+
+    // builds a regular bvh_node tree, so refit/SAH monitoring/saving work unchanged
+    static std::shared_ptr<bvh_node> Build(const hittable_list& list, const Options& options);
+    static std::shared_ptr<bvh_node> Build(const hittable_list& list) { return Build(list, Options()); }
+
+    // stable parallel LSD radix sort of (key, value) pairs on the low key_bits bits
+    static void RadixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, int key_bits);
+
+    static uint64_t Morton30(double x, double y, double z);   // coordinates in [0, 1]
+    static uint64_t Morton63(double x, double y, double z);
+
+private:
+    // children >= 0 are internal nodes, children < 0 are sorted leaves ~index
+    struct Node {
+        aabb box;
+        int left = 0, right = 0;
+        int parent = -1;
+        uint32_t count = 0;   // primitives below the node
+        double cost = 0.0;    // SAH cost of the subtree (not normalized by the root area)
+    };
+
+    struct Hierarchy {
+        std::vector<Node> nodes;              // n - 1 internal nodes, root is 0
+        std::vector<int> leaf_parent;
+        std::vector<aabb> leaf_box;
+        std::vector<std::shared_ptr<hittable>> leaves;  // primitives in Morton order
+    };
+
+    static void EmitHierarchy(Hierarchy& h, const std::vector<uint64_t>& codes);
+    // bottom-up pass (boxes, counts, costs), restructuring treelets on the way if asked
+    static void BottomUp(Hierarchy& h, bool restructure);
+    static void RestructureTreelet(Hierarchy& h, int root);
+    static std::shared_ptr<bvh_node> Convert(const Hierarchy& h, int node);
+};
+
+#endif
@@ -30,6 +30,7 @@ public:
     }
 
     virtual bool hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec) const override {
+        RT_STAT_PRIMITIVE(Parallelepiped);
         // slab method: find intersection intervals for each axis
         double t_min = *ray_tmin;
         double t_max = *ray_tmax;
@@ -81,6 +82,7 @@ public:
         rec.t = t_min;
         rec.p = r.at(t_min);
         rec.mat_ptr = mat_ptr;
+        rec.object = this;
         
         // compute normal based on which face was hit
         Vector3 outward_normal(0, 0, 0);
@@ -93,6 +95,13 @@ public:
         return true;
     }
 
+    std::shared_ptr<hittable> translated(const Vector3& offset) const override {
+        auto moved = std::make_shared<Parallepiped>(*this);
+        moved->p_min = p_min + offset;
+        moved->p_max = p_max + offset;
+        return moved;
+    }
+
     aabb bounding_box() const override {
     return aabb(
         Point3(std::fmin(p_min.x, p_max.x) - 0.001, std::fmin(p_min.y, p_max.y) - 0.001, std::fmin(p_min.z, p_max.z) - 0.001),
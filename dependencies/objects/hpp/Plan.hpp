@@ -21,6 +21,12 @@ public:
     virtual bool hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec) const override;
 
    
+    std::shared_ptr<hittable> translated(const Vector3& offset) const override {
+        auto moved = std::make_shared<Plan>(*this);
+        moved->point = point + offset;
+        return moved;
+    }
+
     aabb bounding_box() const override {
     double limit = 1e8; 
     return aabb(Point3(-limit, -limit, -limit), Point3(limit, limit, limit));
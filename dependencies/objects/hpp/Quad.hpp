@@ -0,0 +1,57 @@
+/*
+    Quad.hpp
+    Parallelogram primitive: corner Q and edges u, v (points Q + a*u + b*v, a and b in [0, 1])
+    The front face is on the side of u x v, as for area lights
+*/
+
+#ifndef QUAD_HPP
+#define QUAD_HPP
+
+#include "_Generic.hpp"
+#include "utils/hpp/Vector3.hpp"
+#include "materials/hpp/Material.hpp"
+#include <cmath>
+#include <memory>
+
+class Quad : public hittable {
+public:
+    Point3 Q;             // corner
+    Vector3 u, v;         // edges
+    Vector3 normal;       // unit u x v
+    double area;
+    std::shared_ptr<Material> mat_ptr;
+
+    Quad() {}
+
+    Quad(Point3 Q_, Vector3 u_, Vector3 v_, std::shared_ptr<Material> m)
+        : Q(Q_), u(u_), v(v_), mat_ptr(m) {
+        Vector3 n = u.cross(v);
+        area = n.length();
+        normal = area > 0 ? n / area : Vector3(0, 0, 1);
+        m_w = area > 0 ? n / dot(n, n) : Vector3(0, 0, 0);
+    }
+
+    bool hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec) const override;
+
+    std::shared_ptr<hittable> translated(const Vector3& offset) const override {
+        auto moved = std::make_shared<Quad>(*this);
+        moved->Q = Q + offset;
+        return moved;
+    }
+
+    aabb bounding_box() const override {
+        Point3 corners[4] = {Q, Q + u, Q + v, Q + u + v};
+        Point3 lo = corners[0], hi = corners[0];
+        for (const Point3& c : corners) {
+            lo = Point3(std::fmin(lo.x, c.x), std::fmin(lo.y, c.y), std::fmin(lo.z, c.z));
+            hi = Point3(std::fmax(hi.x, c.x), std::fmax(hi.y, c.y), std::fmax(hi.z, c.z));
+        }
+        // same small margin as Triangle, a quad is flat along one axis
+        return aabb(lo - Vector3(0.0001, 0.0001, 0.0001), hi + Vector3(0.0001, 0.0001, 0.0001));
+    }
+
+private:
+    Vector3 m_w;          // (u x v) / |u x v|^2, gives the planar coordinates of a hit
+};
+
+#endif
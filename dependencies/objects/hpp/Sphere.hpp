@@ -20,6 +20,7 @@ class sphere : public hittable {
         : center(center), radius(std::fmax(0,radius)), mat_ptr(m) {}
 
     bool hit(const Ray& r, double *ray_tmin, double *ray_tmax, hit_record& rec) const override {
+        RT_STAT_PRIMITIVE(Sphere);
         // solve quadratic: |P(t) - C|^2 = r^2
         Vector3 oc = center - r.origin();
         auto a = r.direction().lengthSquared();
@@ -41,12 +42,19 @@ class sphere : public hittable {
         rec.t = root;
         rec.p = r.at(rec.t);
         rec.mat_ptr = mat_ptr;
+        rec.object = this;
         // normal points outward from center
         Vector3 outward_normal = (rec.p - center) / radius;
         rec.set_face_normal(r, outward_normal);
         return true;
     }
 
+    std::shared_ptr<hittable> translated(const Vector3& offset) const override {
+        auto moved = std::make_shared<sphere>(*this);
+        moved->center = center + offset;
+        return moved;
+    }
+
     aabb bounding_box() const override {
     return aabb(center - Vector3(radius, radius, radius), 
                 center + Vector3(radius, radius, radius));
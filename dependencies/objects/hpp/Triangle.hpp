@@ -30,6 +30,14 @@ public:
 
     virtual bool hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec) const override;
 
+    std::shared_ptr<hittable> translated(const Vector3& offset) const override {
+        auto moved = std::make_shared<Triangle>(*this);
+        moved->v0 = v0 + offset;
+        moved->v1 = v1 + offset;
+        moved->v2 = v2 + offset;
+        return moved;
+    }
+
     aabb bounding_box() const override {
     double min_x = fmin(fmin(v0.x, v1.x), v2.x);
     double min_y = fmin(fmin(v0.y, v1.y), v2.y);
@@ -4,6 +4,7 @@
 #include "utils/hpp/Vector3.hpp"
 #include "utils/hpp/interval.hpp"
 #include "camera/hpp/Ray.hpp"
+#include "utils/hpp/RenderStats.hpp"
 
 class aabb {
 public:
@@ -34,6 +35,7 @@ public:
 
     // Ray-AABB intersection test using the "slab" method
     bool hit(const Ray& r, interval ray_t) const {
+        RT_STAT(aabb_tests);
         for (int a = 0; a < 3; a++) {
             auto invD = 1.0 / r.direction()[a];
             auto orig = r.origin()[a];
@@ -12,6 +12,7 @@
 #include <memory>
 
 class Material;
+class hittable;
 
 // stores information about a ray-object intersection
 class hit_record {
@@ -21,6 +22,7 @@ class hit_record {
     double t;          // ray parameter (p = origin + t*direction)
     bool front_face;   // true if ray hits front surface
     std::shared_ptr<Material> mat_ptr;
+    const hittable* object = nullptr;  // primitive that was hit (emitter lookup)
     Vector3 LocalColor; 
     double ColorIntensity; 
 
@@ -40,6 +42,10 @@ class hittable {
 
     // return the bounding box of the object
     virtual aabb bounding_box() const = 0;
+
+    // copy of the object moved by offset, nullptr if it can't be moved
+    // (shared objects are never modified in place so a background BVH build can read them)
+    virtual std::shared_ptr<hittable> translated(const Vector3& offset) const { return nullptr; }
 };
 
 #endif
\ No newline at end of file
@@ -11,8 +11,15 @@ class bvh_node : public hittable {
   public:
     bvh_node(const hittable_list& list) : bvh_node(list.objects, 0, list.objects.size()) {}
 
-    bvh_node(const std::vector<std::shared_ptr<hittable>>& src_objects, size_t start, size_t end) {
-        auto objects = src_objects; // mutable copy for sorting
+    bvh_node(const std::vector<std::shared_ptr<hittable>>& src_objects, size_t start, size_t end)
+        : bvh_node(std::vector<std::shared_ptr<hittable>>(src_objects), start, end) {}
+
+    bvh_node(std::vector<std::shared_ptr<hittable>>&& objects, size_t start, size_t end)
+        : bvh_node(&objects, start, end) {}
+
+    // sorts (*objects)[start, end) in place, the children share the same vector
+    bvh_node(std::vector<std::shared_ptr<hittable>>* sorted, size_t start, size_t end) {
+        auto& objects = *sorted;
 
         // Choose a random axis to split objects
         int axis = random_int(0, 2); 
@@ -37,15 +44,25 @@ class bvh_node : public hittable {
             std::sort(objects.begin() + start, objects.begin() + end, comparator);
 
             auto mid = start + object_span / 2;
-            left = std::make_shared<bvh_node>(objects, start, mid);
-            right = std::make_shared<bvh_node>(objects, mid, end);
+            left = std::make_shared<bvh_node>(sorted, start, mid);
+            right = std::make_shared<bvh_node>(sorted, mid, end);
         }
 
         bbox = aabb(left->bounding_box(), right->bounding_box());
+        adopt_children();
     }
 
+    // links two already built children (used when loading a prebuilt hierarchy)
+    bvh_node(std::shared_ptr<hittable> l, std::shared_ptr<hittable> r, const aabb& box)
+        : left(std::move(l)), right(std::move(r)), bbox(box) { adopt_children(); }
+
+    // nodes are linked to their parent so a refit only walks the path to the root
+    bvh_node(const bvh_node&) = delete;
+    bvh_node& operator=(const bvh_node&) = delete;
+
     // BVH intersection: the key optimization step
     bool hit(const Ray& r, double* ray_tmin, double* ray_tmax, hit_record& rec) const override {
+        RT_STAT(bvh_nodes);
         // If the ray doesn't hit the node's bounding box, ignore all contents
         if (!bbox.hit(r, interval(*ray_tmin, *ray_tmax)))
             return false;
@@ -62,10 +79,85 @@ class bvh_node : public hittable {
 
     aabb bounding_box() const override { return bbox; }
 
+    const std::shared_ptr<hittable>& left_child() const { return left; }
+    const std::shared_ptr<hittable>& right_child() const { return right; }
+
+    bvh_node* parent() const { return parent_node; }
+
+    // swaps a direct child (a primitive), boxes are fixed by refit_up()
+    bool replace_child(const hittable* old_child, const std::shared_ptr<hittable>& new_child) {
+        bool found = false;
+        if (left.get() == old_child) { left = new_child; found = true; }
+        if (right.get() == old_child) { right = new_child; found = true; }
+        return found;
+    }
+
+    // recomputes this box from the children, then the ancestors while their box changes
+    void refit_up() {
+        for (bvh_node* node = this; node; node = node->parent_node) {
+            aabb box(node->left->bounding_box(), node->right->bounding_box());
+            if (same_box(box, node->bbox)) return;
+            node->bbox = box;
+        }
+    }
+
+    // recomputes every box bottom-up, the topology is kept
+    aabb refit() {
+        bbox = aabb(refit_child(left), refit_child(right));
+        return bbox;
+    }
+
+    // calls fn(parent, leaf) for every primitive below this node
+    template <typename Fn>
+    void for_each_leaf(Fn&& fn) {
+        for (auto* child : {&left, &right}) {
+            if (auto node = dynamic_cast<bvh_node*>(child->get())) node->for_each_leaf(fn);
+            else if (child == &left || left != right) fn(this, child->get());
+        }
+    }
+
+    // surface area heuristic cost of the tree, relative to tracing one primitive.
+    // refits keep the topology, so this grows as moved primitives stretch the boxes
+    double sah_cost() const {
+        double area = surface_area(bbox);
+        if (area <= 0.0) return traversal_cost + child_cost(left) + child_cost(right);
+        return traversal_cost + (surface_area(left->bounding_box()) * child_cost(left) +
+                                 surface_area(right->bounding_box()) * child_cost(right)) / area;
+    }
+
+    static double surface_area(const aabb& box) {
+        double dx = box.x.max - box.x.min, dy = box.y.max - box.y.min, dz = box.z.max - box.z.min;
+        if (dx < 0 || dy < 0 || dz < 0) return 0.0;
+        return 2.0 * (dx*dy + dy*dz + dz*dx);
+    }
+
   private:
     std::shared_ptr<hittable> left;
     std::shared_ptr<hittable> right;
     aabb bbox;
+    bvh_node* parent_node = nullptr;
+
+    static constexpr double traversal_cost = 1.0;  // box test, relative to a primitive test
+
+    void adopt_children() {
+        if (auto l = dynamic_cast<bvh_node*>(left.get())) l->parent_node = this;
+        if (auto r = dynamic_cast<bvh_node*>(right.get())) r->parent_node = this;
+    }
+
+    double child_cost(const std::shared_ptr<hittable>& child) const {
+        if (auto node = dynamic_cast<const bvh_node*>(child.get())) return node->sah_cost();
+        return 1.0;  // a single-primitive leaf stores it twice and hit() tests both
+    }
+
+    static bool same_box(const aabb& a, const aabb& b) {
+        return a.x.min == b.x.min && a.x.max == b.x.max && a.y.min == b.y.min &&
+               a.y.max == b.y.max && a.z.min == b.z.min && a.z.max == b.z.max;
+    }
+
+    static aabb refit_child(const std::shared_ptr<hittable>& child) {
+        if (auto node = dynamic_cast<bvh_node*>(child.get())) return node->refit();
+        return child->bounding_box();
+    }
 
     // Comparators for spatial sorting
     static bool box_compare(const std::shared_ptr<hittable> a, const std::shared_ptr<hittable> b, int axis_index) {
@@ -0,0 +1,72 @@
+/*
+    DefaultScene.cpp
+    Built-in random spheres scene
+*/
+
+#include "../hpp/DefaultScene.hpp"
+#include "objects/hpp/Sphere.hpp"
+#include "materials/hpp/MaterialLibrary.hpp"
+#include "lights/hpp/PointLight.hpp"
+#include "utils/hpp/Trace.hpp"
+#include <iostream>
+
+void DefaultScene::Build(Scene& scene, double aspect_ratio) {
+    TraceScope trace("build default scene", "scene");
+    std::cout << "Building default scene with 3 large spheres and many small spheres..." << std::endl;
+    
+    scene.SetupCamera(
+        Point3(13, 2, 3),
+        Point3(0, 0, 0),
+        Vector3(0, 1, 0),
+        20.0,
+        aspect_ratio,
+        0.1,
+        10.0
+    );
+    
+    // materials go through the library so that they get material IDs like loaded scenes
+    MaterialLibrary& materials = scene.GetMaterials();
+    auto ground = materials.Intern(MaterialLibrary::LambertianType, Vector3(0.5, 0.5, 0.5));
+    scene.AddObject(std::make_shared<sphere>(Point3(0, -1000, 0), 1000, ground));
+    
+    for (int a = -11; a < 11; a++) {
+        for (int b = -11; b < 11; b++) {
+            auto choose_mat = random_double();
+            Point3 center(a + 0.9*random_double(), 0.2, b + 0.9*random_double());
+            
+            if ((center - Point3(4, 0.2, 0)).length() > 0.9) {
+                std::shared_ptr<Material> sphere_material;
+                
+                if (choose_mat < 0.8) {
+                    auto albedo = Vector3(random_double(), random_double(), random_double()) *
+                                  Vector3(random_double(), random_double(), random_double());
+                    sphere_material = materials.Intern(MaterialLibrary::LambertianType, albedo);
+                } else if (choose_mat < 0.95) {
+                    auto albedo = Vector3(0.5 + 0.5*random_double(),
+                                         0.5 + 0.5*random_double(),
+                                         0.5 + 0.5*random_double());
+                    auto fuzz = 0.5 * random_double();
+                    sphere_material = materials.Intern(MaterialLibrary::MetalType, albedo, fuzz);
+                } else {
+                    sphere_material = materials.Intern(MaterialLibrary::DielectricType, Vector3(1, 1, 1), 0.0, 1.5);
+                }
+                
+                scene.AddObject(std::make_shared<sphere>(center, 0.2, sphere_material));
+            }
+        }
+    }
+    
+    auto material1 = materials.Intern(MaterialLibrary::DielectricType, Vector3(1, 1, 1), 0.0, 1.5);
+    scene.AddObject(std::make_shared<sphere>(Point3(0, 1, 0), 1.0, material1));
+    
+    auto material2 = materials.Intern(MaterialLibrary::LambertianType, Vector3(0.4, 0.2, 0.1));
+    scene.AddObject(std::make_shared<sphere>(Point3(-4, 1, 0), 1.0, material2));
+    
+    auto material3 = materials.Intern(MaterialLibrary::MetalType, Vector3(0.7, 0.6, 0.5), 0.0);
+    scene.AddObject(std::make_shared<sphere>(Point3(4, 1, 0), 1.0, material3));
+    
+    auto light = std::make_shared<PointLight>(Point3(5, 5, 5), Vector3(1.0, 1.0, 1.0));
+    scene.AddLight(light);
+    
+    std::cout << "Default scene created!" << std::endl;
+}
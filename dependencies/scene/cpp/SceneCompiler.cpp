@@ -0,0 +1,439 @@
+/*
+    SceneCompiler.cpp
+    Binary scene writer and mmap based loader
+*/
+
+#include "../hpp/SceneCompiler.hpp"
+#include "../hpp/Sceneloader.hpp"
+#include "utils/hpp/Trace.hpp"
+#include "objects/hpp/Sphere.hpp"
+#include "objects/hpp/Plan.hpp"
+#include "objects/hpp/Cylinder.hpp"
+#include "objects/hpp/Cone.hpp"
+#include "objects/hpp/Triangle.hpp"
+#include "objects/hpp/Parallepiped.hpp"
+#include "objects/hpp/Quad.hpp"
+#include "materials/hpp/Lambertian.hpp"
+#include "materials/hpp/Metal.hpp"
+#include "materials/hpp/Dielectric.hpp"
+#include "materials/hpp/Emissive.hpp"
+#include "lights/hpp/PointLight.hpp"
+#include "lights/hpp/DirectionalLight.hpp"
+#include "lights/hpp/SpotLight.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace scenefile;
+
+namespace {
+
+void PutVec3(double* dst, const Vector3& v) { dst[0] = v.x; dst[1] = v.y; dst[2] = v.z; }
+Vector3 GetVec3(const double* src) { return Vector3(src[0], src[1], src[2]); }
+
+size_t Align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+// flattened scene, ready to be written
+struct PackedScene {
+    std::vector<PackedMaterial> materials;
+    std::vector<PackedPrimitive> primitives;
+    std::vector<PackedLight> lights;
+    PackedCamera camera;
+    std::vector<PackedBvhNode> nodes;
+};
+
+// returns the material index, identical pointers share one record
+uint32_t PackMaterial(const std::shared_ptr<Material>& m, PackedScene& out,
+                      std::unordered_map<const Material*, uint32_t>& seen) {
+    auto it = seen.find(m.get());
+    if (it != seen.end()) return it->second;
+
+    PackedMaterial pm{};
+    if (auto l = std::dynamic_pointer_cast<Lambertian>(m)) {
+        pm.type = 0; PutVec3(pm.color, l->albedo);
+    } else if (auto me = std::dynamic_pointer_cast<Metal>(m)) {
+        pm.type = 1; PutVec3(pm.color, me->albedo); pm.param = me->fuzz;
+    } else if (auto d = std::dynamic_pointer_cast<Dielectric>(m)) {
+        pm.type = 2; PutVec3(pm.color, Vector3(1, 1, 1)); pm.param = d->ir;
+    } else if (auto e = std::dynamic_pointer_cast<Emissive>(m)) {
+        pm.type = 3; PutVec3(pm.color, e->radiance);
+    } else {
+        // unknown material, fall back to a grey diffuse
+        pm.type = 0; PutVec3(pm.color, m ? m->baseColor() : Vector3(0.5, 0.5, 0.5));
+    }
+
+    uint32_t index = static_cast<uint32_t>(out.materials.size());
+    out.materials.push_back(pm);
+    seen[m.get()] = index;
+    return index;
+}
+
+bool PackPrimitive(const std::shared_ptr<hittable>& obj, PackedScene& out,
+                   std::unordered_map<const Material*, uint32_t>& mats) {
+    PackedPrimitive p{};
+    if (auto s = std::dynamic_pointer_cast<sphere>(obj)) {
+        p.type = SphereType; p.material = PackMaterial(s->mat_ptr, out, mats);
+        PutVec3(p.data, s->center); p.data[3] = s->radius;
+    } else if (auto pl = std::dynamic_pointer_cast<Plan>(obj)) {
+        p.type = PlaneType; p.material = PackMaterial(pl->mat_ptr, out, mats);
+        PutVec3(p.data, pl->point); PutVec3(p.data + 3, pl->normal);
+    } else if (auto c = std::dynamic_pointer_cast<Cylinder>(obj)) {
+        p.type = CylinderType; p.material = PackMaterial(c->mat_ptr, out, mats);
+        PutVec3(p.data, c->base); PutVec3(p.data + 3, c->axis); p.data[6] = c->radius; p.data[7] = c->height;
+    } else if (auto co = std::dynamic_pointer_cast<Cone>(obj)) {
+        p.type = ConeType; p.material = PackMaterial(co->mat_ptr, out, mats);
+        PutVec3(p.data, co->apex); PutVec3(p.data + 3, co->axis); p.data[6] = co->angle; p.data[7] = co->height;
+    } else if (auto t = std::dynamic_pointer_cast<Triangle>(obj)) {
+        p.type = TriangleType; p.material = PackMaterial(t->mat_ptr, out, mats);
+        PutVec3(p.data, t->v0); PutVec3(p.data + 3, t->v1); PutVec3(p.data + 6, t->v2);
+    } else if (auto b = std::dynamic_pointer_cast<Parallepiped>(obj)) {
+        p.type = BoxType; p.material = PackMaterial(b->mat_ptr, out, mats);
+        PutVec3(p.data, b->p_min); PutVec3(p.data + 3, b->p_max);
+    } else if (auto q = std::dynamic_pointer_cast<Quad>(obj)) {
+        p.type = QuadType; p.material = PackMaterial(q->mat_ptr, out, mats);
+        PutVec3(p.data, q->Q); PutVec3(p.data + 3, q->u); PutVec3(p.data + 6, q->v);
+    } else {
+        return false;
+    }
+    out.primitives.push_back(p);
+    return true;
+}
+
+bool PackLight(const std::shared_ptr<Light>& light, PackedScene& out) {
+    PackedLight pl{};
+    PutVec3(pl.position, light->position);
+    PutVec3(pl.intensity, light->intensity);
+    if (auto d = std::dynamic_pointer_cast<DirectionalLight>(light)) {
+        pl.type = DirectionalType; PutVec3(pl.direction, d->direction);
+    } else if (auto s = std::dynamic_pointer_cast<SpotLight>(light)) {
+        pl.type = SpotType; PutVec3(pl.direction, s->direction);
+        pl.inner_deg = s->inner_angle * 180.0 / M_PI;
+        pl.outer_deg = s->outer_angle * 180.0 / M_PI;
+    } else if (std::dynamic_pointer_cast<PointLight>(light)) {
+        pl.type = PointType;
+    } else {
+        return false;
+    }
+    out.lights.push_back(pl);
+    return true;
+}
+
+// pre-order flattening, returns the encoded child reference
+int32_t PackNode(const std::shared_ptr<hittable>& node, PackedScene& out,
+                 const std::unordered_map<const hittable*, int32_t>& prim_index) {
+    auto bvh = std::dynamic_pointer_cast<bvh_node>(node);
+    if (!bvh) {
+        auto it = prim_index.find(node.get());
+        return it == prim_index.end() ? -1 : ~it->second;
+    }
+
+    int32_t index = static_cast<int32_t>(out.nodes.size());
+    out.nodes.push_back(PackedBvhNode{});
+    aabb box = bvh->bounding_box();
+    int32_t l = PackNode(bvh->left_child(), out, prim_index);
+    int32_t r = PackNode(bvh->right_child(), out, prim_index);
+
+    PackedBvhNode& n = out.nodes[index];
+    n.min[0] = box.x.min; n.min[1] = box.y.min; n.min[2] = box.z.min;
+    n.max[0] = box.x.max; n.max[1] = box.y.max; n.max[2] = box.z.max;
+    n.left = l;
+    n.right = r;
+    return index;
+}
+
+std::shared_ptr<Material> MakeMaterial(const PackedMaterial& pm, MaterialLibrary& library) {
+    return library.Intern(pm.type, GetVec3(pm.color), pm.param, pm.param);
+}
+
+std::shared_ptr<hittable> MakePrimitive(const PackedPrimitive& p, const std::shared_ptr<Material>& m) {
+    const double* d = p.data;
+    switch (p.type) {
+        case SphereType:   return std::make_shared<sphere>(GetVec3(d), d[3], m);
+        case PlaneType:    return std::make_shared<Plan>(GetVec3(d), GetVec3(d + 3), m);
+        case CylinderType: return std::make_shared<Cylinder>(GetVec3(d), GetVec3(d + 3), d[6], d[7], m);
+        case ConeType:     return std::make_shared<Cone>(GetVec3(d), GetVec3(d + 3), d[6], d[7], m);
+        case TriangleType: return std::make_shared<Triangle>(GetVec3(d), GetVec3(d + 3), GetVec3(d + 6), m);
+        case BoxType:      return std::make_shared<Parallepiped>(GetVec3(d), GetVec3(d + 3), m);
+        case QuadType:     return std::make_shared<Quad>(GetVec3(d), GetVec3(d + 3), GetVec3(d + 6), m);
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Light> MakeLight(const PackedLight& pl) {
+    switch (pl.type) {
+        case PointType:
+            return std::make_shared<PointLight>(GetVec3(pl.position), GetVec3(pl.intensity));
+        case DirectionalType:
+            return std::make_shared<DirectionalLight>(GetVec3(pl.direction), GetVec3(pl.intensity));
+        case SpotType:
+            return std::make_shared<SpotLight>(GetVec3(pl.position), GetVec3(pl.direction), GetVec3(pl.intensity),
+                                               pl.inner_deg, pl.outer_deg);
+    }
+    return nullptr;
+}
+
+// read-only mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                m_data = static_cast<const char*>(p);
+                m_size = static_cast<size_t>(st.st_size);
+                madvise(p, m_size, MADV_WILLNEED);
+            }
+        }
+        close(fd);
+    }
+    ~MappedFile() { if (m_data) munmap(const_cast<char*>(m_data), m_size); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+// turns a section entry into a typed pointer, nullptr if it does not fit in the file
+template <typename T>
+const T* FixupSection(const MappedFile& file, const SectionEntry& e) {
+    if (e.count == 0) return nullptr;
+    if (e.offset % alignof(T) != 0) return nullptr;
+    if (e.offset > file.size() || e.count > (file.size() - e.offset) / sizeof(T)) return nullptr;
+    return reinterpret_cast<const T*>(file.data() + e.offset);
+}
+
+} // namespace
+
+bool SceneCompiler::IsCompiledScene(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    char magic[8] = {};
+    in.read(magic, sizeof(magic));
+    return in && std::memcmp(magic, kMagic, sizeof(magic)) == 0;
+}
+
+bool SceneCompiler::CompileJSON(const std::string& json_file, const std::string& out_file, bool with_bvh) {
+    Scene scene;
+    SceneLoader::LoadJSON(json_file, scene);
+    if (scene.GetPrimitives().objects.empty() && scene.GetLights().Lights_list.empty()) {
+        std::cerr << "ERROR: nothing to compile in " << json_file << std::endl;
+        return false;
+    }
+    return Save(scene, out_file, with_bvh);
+}
+
+bool SceneCompiler::Save(const Scene& scene, const std::string& out_file, bool with_bvh) {
+    PackedScene packed;
+    std::unordered_map<const Material*, uint32_t> material_index;
+    std::unordered_map<const hittable*, int32_t> prim_index;
+
+    for (const auto& obj : scene.GetPrimitives().objects) {
+        int32_t index = static_cast<int32_t>(packed.primitives.size());
+        if (PackPrimitive(obj, packed, material_index)) {
+            prim_index[obj.get()] = index;
+        } else {
+            std::cerr << "Warning: unsupported object skipped in compiled scene" << std::endl;
+        }
+    }
+    for (const auto& light : scene.GetLights().Lights_list) {
+        if (!PackLight(light, packed)) {
+            std::cerr << "Warning: unsupported light skipped in compiled scene" << std::endl;
+        }
+    }
+
+    const Camera& cam = scene.GetCamera();
+    PutVec3(packed.camera.look_from, cam.look_from);
+    PutVec3(packed.camera.look_at, cam.look_at);
+    PutVec3(packed.camera.view_up, cam.view_up);
+    packed.camera.vfov = cam.vfov_deg;
+    packed.camera.aperture = cam.aperture;
+    packed.camera.focus_dist = cam.focus_dist;
+
+    // every primitive must be reachable from the stored tree, otherwise drop it
+    if (with_bvh && prim_index.size() == scene.GetPrimitives().objects.size() && !prim_index.empty()) {
+        std::shared_ptr<bvh_node> root = scene.GetBVH();
+        if (!root) root = std::make_shared<bvh_node>(scene.GetPrimitives());
+        PackNode(root, packed, prim_index);
+    }
+
+    // section layout
+    SceneFileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.endian = kEndianMarker;
+
+    size_t offset = Align8(sizeof(SceneFileHeader));
+    auto place = [&](Section s, size_t count, size_t record_size) {
+        header.sections[s].offset = offset;
+        header.sections[s].count = count;
+        offset = Align8(offset + count * record_size);
+    };
+    place(Materials, packed.materials.size(), sizeof(PackedMaterial));
+    place(Primitives, packed.primitives.size(), sizeof(PackedPrimitive));
+    place(Lights, packed.lights.size(), sizeof(PackedLight));
+    place(CameraParams, 1, sizeof(PackedCamera));
+    place(BvhNodes, packed.nodes.size(), sizeof(PackedBvhNode));
+    header.file_size = offset;
+
+    std::ofstream out(out_file, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "ERROR: cannot write " << out_file << std::endl;
+        return false;
+    }
+
+    auto write_at = [&](Section s, const void* data, size_t bytes) {
+        out.seekp(static_cast<std::streamoff>(header.sections[s].offset));
+        if (bytes > 0) out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_at(Materials, packed.materials.data(), packed.materials.size() * sizeof(PackedMaterial));
+    write_at(Primitives, packed.primitives.data(), packed.primitives.size() * sizeof(PackedPrimitive));
+    write_at(Lights, packed.lights.data(), packed.lights.size() * sizeof(PackedLight));
+    write_at(CameraParams, &packed.camera, sizeof(PackedCamera));
+    write_at(BvhNodes, packed.nodes.data(), packed.nodes.size() * sizeof(PackedBvhNode));
+
+    // pad the tail so the file size matches the header
+    out.seekp(0, std::ios::end);
+    while (static_cast<size_t>(out.tellp()) < header.file_size) out.put('\0');
+
+    if (!out) {
+        std::cerr << "ERROR: write failed for " << out_file << std::endl;
+        return false;
+    }
+
+    std::cout << "Compiled scene written to " << out_file << ": "
+              << packed.primitives.size() << " primitives, "
+              << packed.materials.size() << " materials, "
+              << packed.lights.size() << " lights, "
+              << packed.nodes.size() << " BVH nodes" << std::endl;
+    return true;
+}
+
+bool SceneCompiler::Load(const std::string& filename, Scene& scene, double aspect_ratio, bool use_bvh) {
+    TraceScope trace("load compiled scene", "scene");
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    MappedFile file(filename);
+    if (!file.data()) {
+        std::cerr << "ERROR: cannot map compiled scene " << filename << std::endl;
+        return false;
+    }
+    if (file.size() < sizeof(SceneFileHeader)) {
+        std::cerr << "ERROR: truncated compiled scene " << filename << std::endl;
+        return false;
+    }
+
+    const auto* header = reinterpret_cast<const SceneFileHeader*>(file.data());
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->endian != kEndianMarker) {
+        std::cerr << "ERROR: " << filename << " is not a compiled scene for this platform" << std::endl;
+        return false;
+    }
+    if (header->version < 1 || header->version > kVersion) {
+        std::cerr << "ERROR: compiled scene version " << header->version
+                  << " not supported (expected " << kVersion << ")" << std::endl;
+        return false;
+    }
+    if (header->file_size != file.size()) {
+        std::cerr << "ERROR: compiled scene size mismatch in " << filename << std::endl;
+        return false;
+    }
+
+    const auto& sec = header->sections;
+    const auto* materials = FixupSection<PackedMaterial>(file, sec[Materials]);
+    const auto* prims = FixupSection<PackedPrimitive>(file, sec[Primitives]);
+    const auto* lights = FixupSection<PackedLight>(file, sec[Lights]);
+    const auto* camera = FixupSection<PackedCamera>(file, sec[CameraParams]);
+    const auto* nodes = FixupSection<PackedBvhNode>(file, sec[BvhNodes]);
+
+    if ((sec[Materials].count && !materials) || (sec[Primitives].count && !prims) ||
+        (sec[Lights].count && !lights) || !camera || (sec[BvhNodes].count && !nodes)) {
+        std::cerr << "ERROR: corrupted section table in " << filename << std::endl;
+        return false;
+    }
+
+    std::cout << "Loading compiled scene..." << std::endl;
+
+    // build into a scratch scene so a corrupted file leaves the caller's scene untouched
+    Scene loaded;
+    loaded.SetBVHBuilder(scene.GetBVHBuilder());
+    loaded.SetRebuildThreshold(scene.GetRebuildThreshold());
+
+    loaded.SetupCamera(GetVec3(camera->look_from), GetVec3(camera->look_at), GetVec3(camera->view_up),
+                       camera->vfov, aspect_ratio, camera->aperture, camera->focus_dist);
+
+    std::vector<std::shared_ptr<Material>> mats(sec[Materials].count);
+    for (size_t i = 0; i < mats.size(); i++) mats[i] = MakeMaterial(materials[i], loaded.GetMaterials());
+
+    size_t prim_count = sec[Primitives].count;
+    std::vector<std::shared_ptr<hittable>> objects(prim_count);
+    for (size_t i = 0; i < prim_count; i++) {
+        if (prims[i].material >= mats.size()) {
+            std::cerr << "ERROR: bad material index in " << filename << std::endl;
+            return false;
+        }
+        objects[i] = MakePrimitive(prims[i], mats[prims[i].material]);
+        if (!objects[i]) {
+            std::cerr << "ERROR: unknown primitive type " << prims[i].type << " in " << filename << std::endl;
+            return false;
+        }
+        loaded.AddObject(objects[i]);
+    }
+
+    for (size_t i = 0; i < sec[Lights].count; i++) {
+        if (auto light = MakeLight(lights[i])) loaded.AddLight(light);
+    }
+
+    if (use_bvh && nodes) {
+        // children are stored after their parent, so build from the back
+        size_t node_count = sec[BvhNodes].count;
+        std::vector<std::shared_ptr<bvh_node>> built(node_count);
+        auto child = [&](int32_t ref, size_t parent) -> std::shared_ptr<hittable> {
+            if (ref < 0) {
+                size_t p = static_cast<size_t>(~ref);
+                return p < prim_count ? objects[p] : nullptr;
+            }
+            size_t n = static_cast<size_t>(ref);
+            return (n > parent && n < node_count) ? built[n] : nullptr;
+        };
+        for (size_t i = node_count; i-- > 0;) {
+            const PackedBvhNode& n = nodes[i];
+            auto l = child(n.left, i);
+            auto r = child(n.right, i);
+            if (!l || !r) {
+                std::cerr << "ERROR: corrupted BVH in " << filename << std::endl;
+                return false;
+            }
+            aabb box(Point3(n.min[0], n.min[1], n.min[2]), Point3(n.max[0], n.max[1], n.max[2]));
+            built[i] = std::make_shared<bvh_node>(l, r, box);
+        }
+        loaded.SetBVH(built[0]);
+        std::cout << "Prebuilt BVH installed (" << node_count << " nodes)." << std::endl;
+    } else if (use_bvh) {
+        loaded.BuildBVH();
+    }
+
+    scene.Clear();
+    scene = std::move(loaded);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> ms = t1 - t0;
+    std::cout << "Compiled scene loaded: " << prim_count << " primitives in " << ms.count() << " ms" << std::endl;
+    return true;
+}
@@ -0,0 +1,314 @@
+/*
+    SceneGenerator.cpp
+    Procedural scenes: spheres, triangle soup or terrain, point lights, material mix
+    One emitter drives every output so they all describe the same scene
+*/
+
+#include "../hpp/SceneGenerator.hpp"
+#include "../hpp/SceneCompiler.hpp"
+#include "objects/hpp/Sphere.hpp"
+#include "objects/hpp/Triangle.hpp"
+#include "lights/hpp/PointLight.hpp"
+#include "utils/hpp/Trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace {
+
+// mt19937_64 is fully specified by the standard, the distributions are not:
+// doubles are built from its raw bits so a seed gives the same scene everywhere
+class Random {
+public:
+    explicit Random(uint64_t seed) : m_rng(seed) {}
+    double Next() { return (m_rng() >> 11) * (1.0 / 9007199254740992.0); }
+    double Range(double lo, double hi) { return lo + (hi - lo) * Next(); }
+    size_t Index(size_t count) { return std::min(static_cast<size_t>(Next() * count), count - 1); }
+
+private:
+    std::mt19937_64 m_rng;
+};
+
+// material palette: kColors diffuse, kColors metal, one glass
+const int kColors = 8;
+const int kGlass = 2 * kColors;
+
+class Sink {
+public:
+    virtual ~Sink() = default;
+    virtual void Camera(const Point3& from, const Point3& at, double fov) = 0;
+    virtual void Material(int index, int type, const Vector3& color, double fuzz) = 0;
+    virtual void Sphere(const Point3& center, double radius, int material) = 0;
+    virtual void Triangle(const Point3& a, const Point3& b, const Point3& c, int material) = 0;
+    virtual void Light(const Point3& position, const Vector3& intensity) = 0;
+};
+
+// sum of a few random waves, amplitude about 1
+class Terrain {
+public:
+    explicit Terrain(Random& random, double size) {
+        for (Wave& w : m_waves) {
+            w.fx = random.Range(0.5, 3.0) * M_PI / size;
+            w.fy = random.Range(0.5, 3.0) * M_PI / size;
+            w.px = random.Range(0.0, 2.0 * M_PI);
+            w.py = random.Range(0.0, 2.0 * M_PI);
+            w.a = random.Range(0.2, 0.5);
+        }
+    }
+
+    double Height(double x, double y) const {
+        double h = 0.0;
+        for (const Wave& w : m_waves) h += w.a * std::sin(w.fx * x + w.px) * std::cos(w.fy * y + w.py);
+        return h;
+    }
+
+private:
+    struct Wave { double fx, fy, px, py, a; };
+    Wave m_waves[4];
+};
+
+void Emit(const SceneGenerator::Options& o, Sink& sink) {
+    Random random(o.seed);
+
+    // the volume grows with the primitive count so the density stays the same
+    const double size = std::max(8.0, 1.2 * std::cbrt(static_cast<double>(o.spheres + o.triangles)));
+    const double relief = 0.08 * size;   // terrain amplitude, spheres float above it
+
+    sink.Camera(Point3(0, -2.6 * size, 1.3 * size), Point3(0, 0, 0.25 * size), 40.0);
+
+    for (int i = 0; i < kColors; i++) {
+        sink.Material(i, MaterialLibrary::LambertianType,
+                      Vector3(random.Range(0.1, 0.9), random.Range(0.1, 0.9), random.Range(0.1, 0.9)), 0.0);
+    }
+    for (int i = 0; i < kColors; i++) {
+        sink.Material(kColors + i, MaterialLibrary::MetalType,
+                      Vector3(random.Range(0.5, 1.0), random.Range(0.5, 1.0), random.Range(0.5, 1.0)), random.Range(0.0, 0.4));
+    }
+    sink.Material(kGlass, MaterialLibrary::DielectricType, Vector3(1, 1, 1), 0.0);
+
+    const double total = std::max(o.diffuse + o.metal + o.glass, 1e-9);
+    auto pick_material = [&]() {
+        double u = random.Next() * total;
+        if (u < o.diffuse) return static_cast<int>(random.Index(kColors));
+        if (u < o.diffuse + o.metal) return kColors + static_cast<int>(random.Index(kColors));
+        return kGlass;
+    };
+
+    for (size_t i = 0; i < o.spheres; i++) {
+        double radius = random.Range(0.15, 0.5);
+        Point3 center(random.Range(-size, size), random.Range(-size, size), random.Range(relief + radius, size));
+        sink.Sphere(center, radius, pick_material());
+    }
+
+    if (o.triangle_mode == SceneGenerator::TriangleMode::Surface && o.triangles > 0) {
+        // n x n grid of quads, two triangles each (count rounded to 2 n^2)
+        const size_t n = std::max<size_t>(1, static_cast<size_t>(std::llround(std::sqrt(o.triangles / 2.0))));
+        Terrain terrain(random, size);
+        const int material = pick_material();
+        auto vertex = [&](size_t i, size_t j) {
+            double x = -size + 2.0 * size * i / n;
+            double y = -size + 2.0 * size * j / n;
+            return Point3(x, y, relief * terrain.Height(x, y));
+        };
+        for (size_t j = 0; j < n; j++) {
+            for (size_t i = 0; i < n; i++) {
+                Point3 a = vertex(i, j), b = vertex(i + 1, j), c = vertex(i + 1, j + 1), d = vertex(i, j + 1);
+                sink.Triangle(a, b, c, material);
+                sink.Triangle(a, c, d, material);
+            }
+        }
+    } else {
+        for (size_t i = 0; i < o.triangles; i++) {
+            Point3 center(random.Range(-size, size), random.Range(-size, size), random.Range(relief, size));
+            Point3 v[3];
+            for (Point3& p : v) p = center + Vector3(random.Range(-0.6, 0.6), random.Range(-0.6, 0.6), random.Range(-0.6, 0.6));
+            sink.Triangle(v[0], v[1], v[2], pick_material());
+        }
+    }
+
+    // no falloff on point lights: the total intensity is shared between them
+    for (size_t i = 0; i < o.lights; i++) {
+        Point3 position(random.Range(-size, size), random.Range(-size, size), 1.5 * size);
+        double tint = random.Range(0.8, 1.0);
+        sink.Light(position, Vector3(1.0, tint, tint * tint) * (1.2 / o.lights));
+    }
+}
+
+class SceneSink : public Sink {
+public:
+    SceneSink(Scene& scene, double aspect_ratio) : m_scene(scene), m_aspect(aspect_ratio) {}
+
+    void Camera(const Point3& from, const Point3& at, double fov) override {
+        m_scene.SetupCamera(from, at, Vector3(0, 0, 1), fov, m_aspect, 0.0, (at - from).length());
+    }
+    void Material(int index, int type, const Vector3& color, double fuzz) override {
+        m_materials.resize(std::max<size_t>(m_materials.size(), index + 1));
+        m_materials[index] = m_scene.GetMaterials().Intern(type, color, fuzz, 1.5);
+    }
+    void Sphere(const Point3& center, double radius, int material) override {
+        m_scene.AddObject(std::make_shared<sphere>(center, radius, m_materials[material]));
+    }
+    void Triangle(const Point3& a, const Point3& b, const Point3& c, int material) override {
+        m_scene.AddObject(std::make_shared<::Triangle>(a, b, c, m_materials[material]));
+    }
+    void Light(const Point3& position, const Vector3& intensity) override {
+        m_scene.AddLight(std::make_shared<PointLight>(position, intensity));
+    }
+
+private:
+    Scene& m_scene;
+    double m_aspect;
+    std::vector<std::shared_ptr<::Material>> m_materials;
+};
+
+// one object per line, materials referenced by name
+class JSONSink : public Sink {
+public:
+    explicit JSONSink(std::ostream& out) : m_out(out) {}
+
+    void Camera(const Point3& from, const Point3& at, double fov) override {
+        Open("camera", "{");
+        m_out << "\"position\": " << Vec(from) << ", \"lookat\": " << Vec(at)
+              << ", \"up\": [0, 0, 1], \"fov\": " << fov << ", \"aperture\": 0.0";
+    }
+    void Material(int index, int type, const Vector3& color, double fuzz) override {
+        static const char* names[] = {"lambertian", "metal", "dielectric"};
+        Item("materials", "{");
+        m_out << "\"" << Name(index) << "\": {\"type\": \"" << names[type] << "\", \"color\": " << Vec(color)
+              << ", \"fuzz\": " << fuzz << "}";
+    }
+    void Sphere(const Point3& center, double radius, int material) override {
+        Item("objects", "[");
+        m_out << "{\"type\": \"sphere\", \"center\": " << Vec(center) << ", \"radius\": " << Num(radius)
+              << ", \"material\": \"" << Name(material) << "\"}";
+    }
+    void Triangle(const Point3& a, const Point3& b, const Point3& c, int material) override {
+        Item("objects", "[");
+        m_out << "{\"type\": \"triangle\", \"v0\": " << Vec(a) << ", \"v1\": " << Vec(b) << ", \"v2\": " << Vec(c)
+              << ", \"material\": \"" << Name(material) << "\"}";
+    }
+    void Light(const Point3& position, const Vector3& intensity) override {
+        Item("lights", "[");
+        m_out << "{\"type\": \"point\", \"position\": " << Vec(position) << ", \"intensity\": " << Vec(intensity) << "}";
+    }
+
+    void Finish() {
+        Close();
+        if (!m_hasObjects) m_out << ",\n\"objects\": []";
+        m_out << "\n}\n";
+    }
+
+private:
+    static std::string Name(int material) {
+        if (material == kGlass) return "gen_glass";
+        return (material < kColors ? "gen_diffuse" : "gen_metal") + std::to_string(material % kColors);
+    }
+    static std::string Num(double v) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.7g", v);
+        return buffer;
+    }
+    static std::string Vec(const Vector3& v) { return "[" + Num(v.x) + ", " + Num(v.y) + ", " + Num(v.z) + "]"; }
+
+    // starts a top-level section, closing the previous one
+    void Open(const std::string& section, const char* bracket) {
+        Close();
+        m_out << (m_section.empty() ? "{\n" : ",\n") << "\"" << section << "\": " << bracket << "\n";
+        m_section = section;
+        m_hasObjects |= section == "objects";
+        m_closing = bracket[0] == '[' ? "]" : "}";
+        m_first = true;
+    }
+    void Item(const std::string& section, const char* bracket) {
+        if (m_section != section) Open(section, bracket);
+        if (!m_first) m_out << ",\n";
+        m_first = false;
+    }
+    void Close() {
+        if (!m_section.empty()) m_out << "\n" << m_closing;
+    }
+
+    std::ostream& m_out;
+    std::string m_section;
+    std::string m_closing;
+    bool m_first = true;
+    bool m_hasObjects = false;
+};
+
+} // namespace
+
+void SceneGenerator::Generate(const Options& options, Scene& scene, double aspect_ratio) {
+    TraceScope trace("generate scene", "scene");
+    trace.Arg("spheres", static_cast<long long>(options.spheres)).Arg("triangles", static_cast<long long>(options.triangles));
+    std::cout << "Generating scene: " << options.spheres << " spheres, " << options.triangles << " triangles ("
+              << (options.triangle_mode == TriangleMode::Surface ? "surface" : "soup") << "), "
+              << options.lights << " lights, seed " << options.seed << std::endl;
+
+    SceneSink sink(scene, aspect_ratio);
+    Emit(options, sink);
+    std::cout << "Scene generated: " << scene.GetObjects().objects.size() << " primitives" << std::endl;
+}
+
+bool SceneGenerator::WriteJSON(const Options& options, const std::string& filename) {
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "ERROR: cannot write " << filename << std::endl;
+        return false;
+    }
+    std::vector<char> buffer(1 << 20);
+    out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+
+    JSONSink sink(out);
+    Emit(options, sink);
+    sink.Finish();
+    out.flush();
+    if (!out) {
+        std::cerr << "ERROR: write failed for " << filename << std::endl;
+        return false;
+    }
+    std::cout << "Generated scene written to " << filename << std::endl;
+    return true;
+}
+
+bool SceneGenerator::WriteCompiled(const Options& options, const std::string& filename, bool with_bvh) {
+    Scene scene;
+    Generate(options, scene);
+    // LBVH: the median split builder does not keep up at 10^7 primitives
+    scene.SetBVHBuilder(BVHBuilder::Linear);
+    if (with_bvh) scene.BuildBVH();
+    return SceneCompiler::Save(scene, filename, with_bvh);
+}
+
+bool SceneGenerator::ParseArgs(const std::vector<std::string>& args, Options& options, std::vector<std::string>& rest) {
+    for (size_t i = 0; i < args.size(); i++) {
+        const std::string& arg = args[i];
+        bool has_value = i + 1 < args.size();
+        if (arg == "--spheres" && has_value) options.spheres = std::strtoull(args[++i].c_str(), nullptr, 10);
+        else if (arg == "--triangles" && has_value) options.triangles = std::strtoull(args[++i].c_str(), nullptr, 10);
+        else if (arg == "--lights" && has_value) options.lights = std::strtoull(args[++i].c_str(), nullptr, 10);
+        else if (arg == "--seed" && has_value) options.seed = std::strtoull(args[++i].c_str(), nullptr, 10);
+        else if (arg == "--surface") options.triangle_mode = TriangleMode::Surface;
+        else if (arg == "--soup") options.triangle_mode = TriangleMode::Soup;
+        else if (arg == "--mix" && has_value) {
+            if (std::sscanf(args[++i].c_str(), "%lf,%lf,%lf", &options.diffuse, &options.metal, &options.glass) != 3) return false;
+            if (options.diffuse < 0 || options.metal < 0 || options.glass < 0) return false;
+        }
+        else rest.push_back(arg);
+    }
+    return true;
+}
+
+std::string SceneGenerator::Usage() {
+    return "  --spheres N        spheres (default 10000)\n"
+           "  --triangles M      triangles (default 0)\n"
+           "  --surface | --soup triangles as a tessellated terrain or a random soup (default)\n"
+           "  --lights K         point lights (default 4)\n"
+           "  --mix D,M,G        diffuse, metal, glass weights (default 0.7,0.2,0.1)\n"
+           "  --seed S           generator seed (default 1)\n";
+}
@@ -0,0 +1,122 @@
+/*
+    SceneReloader.cpp
+    JSON diff and in-place scene update
+*/
+
+#include "../hpp/SceneReloader.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+namespace {
+
+const json& Section(const json& doc, const char* name) {
+    static const json empty = json::array();
+    auto it = doc.find(name);
+    return it == doc.end() ? empty : *it;
+}
+
+} // namespace
+
+bool SceneReloader::ReadJSON(const std::string& filename, json& out) {
+    std::ifstream file(filename);
+    if (!file.is_open()) return false;
+    try {
+        out = json::parse(file);
+    } catch (const std::exception& e) {
+        // typically a half-written file, the next change will be picked up
+        std::cerr << "JSON parsing error: " << e.what() << std::endl;
+        return false;
+    }
+    return out.is_object();
+}
+
+bool SceneReloader::SetBaseline(const std::string& filename, SceneLoader::ObjectMap object_map) {
+    m_objectMap = std::move(object_map);
+    m_hasBaseline = ReadJSON(filename, m_baseline) && m_objectMap.size() == Section(m_baseline, "objects").size();
+    return m_hasBaseline;
+}
+
+bool SceneReloader::SameStructure(const json& before, const json& after) {
+    // a material definition change touches every user of it
+    if (Section(before, "materials") != Section(after, "materials")) return false;
+
+    const json& a = Section(before, "objects");
+    const json& b = Section(after, "objects");
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].value("type", "") != b[i].value("type", "")) return false;
+    }
+    return true;
+}
+
+SceneReloader::Result SceneReloader::Reload(const std::string& filename, Scene& scene, double aspect_ratio) {
+    Result result;
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    json next;
+    if (!ReadJSON(filename, next)) return result;
+    result.ok = true;
+
+    if (!m_hasBaseline || !SameStructure(m_baseline, next)) {
+        result.full_reload = true;
+        ClearBaseline();
+        return result;
+    }
+
+    try {
+        // objects: rebuild only the ones whose description changed
+        const json& old_objects = Section(m_baseline, "objects");
+        const json& new_objects = Section(next, "objects");
+        size_t scene_objects = scene.GetPrimitives().objects.size();
+        for (size_t i = 0; i < new_objects.size(); i++) {
+            if (old_objects[i] == new_objects[i]) continue;
+
+            // skipped entries have no primitive to patch, invalid ones would leave a hole
+            long slot = m_objectMap[i];
+            auto object = slot < 0 ? nullptr : SceneLoader::CreateObjectJSON(new_objects[i], scene);
+            if (!object || static_cast<size_t>(slot) >= scene_objects) {
+                result.full_reload = true;   // scene does not match the file anymore
+                break;
+            }
+            scene.ReplaceObject(static_cast<size_t>(slot), object);
+            result.objects_updated++;
+        }
+
+        // lights are few: patch by index, or rebuild the list if the count changed
+        const json& old_lights = Section(m_baseline, "lights");
+        const json& new_lights = Section(next, "lights");
+        if (old_lights.size() == new_lights.size() && scene.GetLights().Lights_list.size() == new_lights.size()) {
+            for (size_t i = 0; i < new_lights.size(); i++) {
+                if (old_lights[i] == new_lights[i]) continue;
+                if (auto light = SceneLoader::CreateLightJSON(new_lights[i])) {
+                    scene.SetLight(i, light);
+                    result.lights_updated++;
+                }
+            }
+        } else {
+            scene.ClearLights();
+            for (const auto& item : new_lights) SceneLoader::ParseLightJSON(item, scene);
+            result.lights_updated = new_lights.size();
+        }
+
+        if (Section(m_baseline, "camera") != Section(next, "camera") && next.contains("camera")) {
+            SceneLoader::ParseCameraJSON(next["camera"], scene, aspect_ratio);
+            result.camera_updated = true;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Hot reload error: " << e.what() << std::endl;
+        result.full_reload = true;
+    }
+
+    // after a full reload the object map is stale until the caller sets a new baseline
+    if (result.full_reload) ClearBaseline();
+    else m_baseline = std::move(next);
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> ms = t2 - t1;
+    result.ms = ms.count();
+    return result;
+}
@@ -1,7 +1,7 @@
 /*
     Sceneloader.cpp
     JSON scene parser implementation
-    Supports spheres, planes, cylinders, cones, triangles and point lights
+    Supports spheres, planes, cylinders, cones, triangles, quads, emitters and point lights
 */
 
 #include "../hpp/Sceneloader.hpp"
@@ -11,6 +11,7 @@
 #include "objects/hpp/Cone.hpp"
 #include "objects/hpp/Triangle.hpp"
 #include "objects/hpp/Parallepiped.hpp"
+#include "objects/hpp/Quad.hpp"
 #include "materials/hpp/Lambertian.hpp"
 #include "materials/hpp/Metal.hpp"
 #include "materials/hpp/Dielectric.hpp"
@@ -19,13 +20,20 @@
 #include "lights/hpp/DirectionalLight.hpp"
 #include "lights/hpp/SpotLight.hpp"
 
+#include "utils/hpp/MemoryUsage.hpp"
+#include "utils/hpp/Trace.hpp"
+
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <utility>
+#include <vector>
 
 
 
 
-void SceneLoader::LoadJSON(const std::string& filename, Scene& scene, double aspect_ratio) {
+void SceneLoader::LoadJSON(const std::string& filename, Scene& scene, double aspect_ratio, ObjectMap* object_map) {
+    TraceScope trace("load json", "scene");
     std::ifstream file(filename);
     if (!file.is_open()) {
         std::cerr << "ERROR: JSON file not found " << filename << std::endl;
@@ -41,26 +49,26 @@ void SceneLoader::LoadJSON(const std::string& filename, Scene& scene, double asp
             ParseCameraJSON(data["camera"], scene, aspect_ratio);
         }
 
+        // shared materials must exist before objects reference them
+        if (data.contains("materials")) {
+            ParseMaterialsJSON(data["materials"], scene);
+        }
+
         // parse all objects
+        if (object_map) object_map->clear();
         for (const auto& item : data["objects"]) {
-            std::string type = item["type"];
-            if (type == "sphere") ParseSphereJSON(item, scene);
-            else if (type == "plane") ParsePlaneJSON(item, scene);
-            else if (type == "cylinder") ParseCylinderJSON(item, scene);
-            else if (type == "cone") ParseConeJSON(item, scene);
-            else if (type == "triangle") ParseTriangleJSON(item, scene);
-            else if (type == "parallepiped" || type == "box") ParseParallelepipedJSON(item, scene);
+            long slot = ParseObjectJSON(item, scene);
+            if (object_map) object_map->push_back(slot);
         }
 
         // parse lights if present
         if (data.contains("lights")) {
             for (const auto& item : data["lights"]) {
-                std::string type = item["type"];
-                if (type == "point") ParsePointLightJSON(item, scene);
-                else if (type == "directional" || type == "sun") ParseDirectionalLightJSON(item, scene);
-                else if (type == "spot" || type == "spotlight") ParseSpotLightJSON(item, scene);
+                ParseLightJSON(item, scene);
             }
         }
+        std::cout << "Materials: " << scene.GetMaterials().UniqueCount() << " unique for "
+                  << scene.GetMaterials().RequestCount() << " references" << std::endl;
         std::cout << "JSON scene loaded!" << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "JSON parsing error: " << e.what() << std::endl;
@@ -68,7 +76,8 @@ void SceneLoader::LoadJSON(const std::string& filename, Scene& scene, double asp
 }
 
 
-void SceneLoader::LoadJSONBVH(const std::string& filename, Scene& scene, double aspect_ratio) {
+void SceneLoader::LoadJSONBVH(const std::string& filename, Scene& scene, double aspect_ratio, ObjectMap* object_map) {
+    TraceScope trace("load json (bvh)", "scene");
     std::ifstream file(filename);
     if (!file.is_open()) {
         std::cerr << "ERROR: JSON file not found " << filename << std::endl;
@@ -83,156 +92,395 @@ void SceneLoader::LoadJSONBVH(const std::string& filename, Scene& scene, double
             ParseCameraJSON(data["camera"], scene, aspect_ratio);
         }
 
+        if (data.contains("materials")) {
+            ParseMaterialsJSON(data["materials"], scene);
+        }
+
         // 1. Chargement des primitives
+        if (object_map) object_map->clear();
         for (const auto& item : data["objects"]) {
-            std::string type = item["type"];
-            if (type == "sphere") ParseSphereJSON(item, scene);
-            else if (type == "plane") ParsePlaneJSON(item, scene);
-            else if (type == "cylinder") ParseCylinderJSON(item, scene);
-            else if (type == "cone") ParseConeJSON(item, scene);
-            else if (type == "triangle") ParseTriangleJSON(item, scene);
-            else if (type == "parallepiped" || type == "box") ParseParallelepipedJSON(item, scene);
+            long slot = ParseObjectJSON(item, scene);
+            if (object_map) object_map->push_back(slot);
         }
 
         // 2. OPTIMISATION : Construction du BVH
-        auto& world = const_cast<hittable_list&>(scene.GetObjects());
-        if (!world.objects.empty()) {
-            std::cout << "Building BVH for " << world.objects.size() << " objects..." << std::endl;
-            auto bvh_root = std::make_shared<bvh_node>(world);
-            world.clear();
-            world.add(bvh_root);
+        if (!scene.GetObjects().objects.empty()) {
+            std::cout << "Building BVH for " << scene.GetObjects().objects.size() << " objects..." << std::endl;
+            scene.BuildBVH();
             std::cout << "BVH hierarchy constructed." << std::endl;
         }
 
         // 3. Chargement des lumières
         if (data.contains("lights")) {
             for (const auto& item : data["lights"]) {
-                std::string type = item["type"];
-                if (type == "point") ParsePointLightJSON(item, scene);
-                else if (type == "directional") ParseDirectionalLightJSON(item, scene);
-                else if (type == "spot") ParseSpotLightJSON(item, scene);
+                ParseLightJSON(item, scene);
             }
         }
+        std::cout << "Materials: " << scene.GetMaterials().UniqueCount() << " unique for "
+                  << scene.GetMaterials().RequestCount() << " references" << std::endl;
         std::cout << "JSON scene loaded!" << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "JSON parsing error: " << e.what() << std::endl;
     }
 }
+// SAX handler for LoadJSONStream: builds a small DOM for one array element of
+// "objects"/"lights" at a time, hands it to the parsers and drops it.
+// Other top-level sections (camera, materials) are small and built whole.
+class SceneSaxHandler : public nlohmann::json_sax<json> {
+public:
+    SceneSaxHandler(Scene& scene, double aspect_ratio, SceneLoader::ObjectMap* object_map)
+        : m_scene(scene), m_aspect(aspect_ratio), m_objectMap(object_map) {
+        if (m_objectMap) m_objectMap->clear();
+    }
+
+    bool null() override { return Value(nullptr); }
+    bool boolean(bool val) override { return Value(val); }
+    bool number_integer(number_integer_t val) override { return Value(val); }
+    bool number_unsigned(number_unsigned_t val) override { return Value(val); }
+    bool number_float(number_float_t val, const string_t&) override { return Value(val); }
+    bool string(string_t& val) override { return Value(val); }
+    bool binary(binary_t& val) override { return Value(json::binary(val)); }
+
+    bool start_object(std::size_t) override { return StartContainer(json::object()); }
+    bool start_array(std::size_t) override {
+        // "objects": [ ... ] and "lights": [ ... ] are streamed element by element
+        if (m_stack.empty() && m_depth == 1 && (m_section == "objects" || m_section == "lights")) {
+            m_streaming = true;
+            m_depth++;
+            return true;
+        }
+        return StartContainer(json::array());
+    }
+
+    bool key(string_t& val) override {
+        if (m_stack.empty() && m_depth == 1) m_section = val;
+        else m_key = val;
+        return true;
+    }
+
+    bool end_object() override { return EndContainer(); }
+    bool end_array() override {
+        if (m_stack.empty() && m_streaming && m_depth == 2) {
+            m_streaming = false;
+            m_depth--;
+            return true;
+        }
+        return EndContainer();
+    }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) override {
+        std::cerr << "JSON parsing error at byte " << position << ": " << ex.what() << std::endl;
+        return false;
+    }
+
+    // objects waiting for a named material that was not parsed yet
+    // (added out of file order, hence the object map)
+    void FlushDeferred() {
+        for (const auto& entry : m_deferred) AddObject(entry.first, entry.second);
+        m_deferred.clear();
+    }
+
+    size_t ElementCount() const { return m_elements; }
+
+private:
+    bool Value(json v) {
+        if (m_stack.empty()) return true;  // scalar section or stray value: ignored
+        Attach(std::move(v));
+        return true;
+    }
+
+    bool StartContainer(json v) {
+        if (m_depth == 0) {       // the root object itself is never materialized
+            m_depth = 1;
+            return true;
+        }
+        json* node = m_stack.empty() ? &(m_current = std::move(v)) : Attach(std::move(v));
+        m_stack.push_back(node);
+        m_depth++;
+        return true;
+    }
+
+    bool EndContainer() {
+        m_depth--;
+        if (m_stack.empty()) return true;  // end of the root object
+        m_stack.pop_back();
+        if (m_stack.empty()) Complete();
+        return true;
+    }
+
+    json* Attach(json v) {
+        json& parent = *m_stack.back();
+        if (parent.is_array()) {
+            parent.push_back(std::move(v));
+            return &parent.back();
+        }
+        json& slot = parent[m_key];
+        slot = std::move(v);
+        return &slot;
+    }
+
+    void AddObject(size_t index, const json& item) {
+        long slot = SceneLoader::ParseObjectJSON(item, m_scene);
+        if (!m_objectMap) return;
+        if (m_objectMap->size() <= index) m_objectMap->resize(index + 1, -1);
+        (*m_objectMap)[index] = slot;
+    }
+
+    // one complete value: a streamed element or a whole small section
+    void Complete() {
+        if (m_streaming && m_section == "objects") {
+            m_elements++;
+            size_t index = m_objects++;
+            if (!m_materials_seen && m_current.contains("material") && m_current["material"].is_string() &&
+                !m_scene.GetMaterials().HasNamed(m_current["material"])) {
+                m_deferred.emplace_back(index, std::move(m_current));
+            } else {
+                AddObject(index, m_current);
+            }
+        } else if (m_streaming && m_section == "lights") {
+            m_elements++;
+            SceneLoader::ParseLightJSON(m_current, m_scene);
+        } else if (m_section == "camera") {
+            SceneLoader::ParseCameraJSON(m_current, m_scene, m_aspect);
+        } else if (m_section == "materials") {
+            SceneLoader::ParseMaterialsJSON(m_current, m_scene);
+            m_materials_seen = true;
+            FlushDeferred();
+        }
+        m_current = json();
+    }
+
+    Scene& m_scene;
+    double m_aspect;
+    SceneLoader::ObjectMap* m_objectMap;
+    int m_depth = 0;                 // container nesting, root object = 1
+    bool m_streaming = false;        // inside "objects"/"lights" array
+    bool m_materials_seen = false;
+    std::string m_section;           // current top-level key
+    std::string m_key;               // pending key inside the value being built
+    json m_current;                  // value being built
+    std::vector<json*> m_stack;      // open containers of m_current
+    std::vector<std::pair<size_t, json>> m_deferred;  // (objects index, description)
+    size_t m_elements = 0;
+    size_t m_objects = 0;
+};
+
+bool SceneLoader::LoadJSONStream(const std::string& filename, Scene& scene, double aspect_ratio, bool build_bvh,
+                                 ObjectMap* object_map) {
+    TraceScope trace("load json (streaming)", "scene");
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: JSON file not found " << filename << std::endl;
+        return false;
+    }
+
+    // larger read buffer, the parser pulls one character at a time
+    std::vector<char> buffer(1 << 20);
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+
+    size_t rss_before = CurrentResidentBytes();
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::cout << "Streaming JSON..." << std::endl;
+
+    bool ok = false;
+    try {
+        SceneSaxHandler handler(scene, aspect_ratio, object_map);
+        ok = json::sax_parse(file, &handler);
+        handler.FlushDeferred();
+        if (!ok) {
+            std::cerr << "JSON streaming stopped, scene is incomplete" << std::endl;
+        }
+
+        auto t2 = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::milli> parse_ms = t2 - t1;
+        std::cout << "Parsed " << handler.ElementCount() << " elements in " << parse_ms.count() << " ms" << std::endl;
+
+        if (build_bvh && !scene.GetObjects().objects.empty()) {
+            std::cout << "Building BVH for " << scene.GetObjects().objects.size() << " objects..." << std::endl;
+            scene.BuildBVH();
+            std::cout << "BVH hierarchy constructed." << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "JSON parsing error: " << e.what() << std::endl;
+        ok = false;
+    }
+
+    size_t rss_after = CurrentResidentBytes();
+    std::cout << "Materials: " << scene.GetMaterials().UniqueCount() << " unique for "
+              << scene.GetMaterials().RequestCount() << " references" << std::endl;
+    std::cout << "Memory: +" << BytesToMiB(rss_after > rss_before ? rss_after - rss_before : 0)
+              << " MiB resident for the scene, peak RSS " << BytesToMiB(PeakResidentBytes()) << " MiB" << std::endl;
+    if (ok) std::cout << "JSON scene loaded!" << std::endl;
+    return ok;
+}
+
 // helper to parse Vector3 from JSON array
 Vector3 LoadVec3(const json& j) { return Vector3(j[0], j[1], j[2]); }
 
-void SceneLoader::ParseSphereJSON(const json& j, Scene& scene) {
+// material type from a name ("metal") or the numeric material_type (1)
+static int MaterialTypeJSON(const json& t) {
+    if (t.is_number()) return t.get<int>();
+    std::string name = t;
+    if (name == "metal") return MaterialLibrary::MetalType;
+    if (name == "dielectric" || name == "glass") return MaterialLibrary::DielectricType;
+    if (name == "emissive" || name == "light") return MaterialLibrary::EmissiveType;
+    return MaterialLibrary::LambertianType;
+}
+
+// material parameters: {"type": "metal", "color": [..], "fuzz": 0.1, "ior": 1.5}
+// emitters: {"type": "emissive", "color": [..], "strength": 10} (radiance = color * strength)
+// type_key is "type" in material definitions and "material_type" inline in objects
+static std::shared_ptr<Material> MaterialFromJSON(const json& j, Scene& scene, const char* type_key = "type") {
+    int type = j.contains(type_key) ? MaterialTypeJSON(j[type_key]) : MaterialLibrary::LambertianType;
+    Vector3 col = j.contains("color") ? LoadVec3(j["color"]) : Vector3(1.0, 1.0, 1.0);
+    if (type == MaterialLibrary::EmissiveType) col = col * j.value("strength", 1.0);
+    double fuzz = j.value("fuzz", 0.1);
+    double ior = j.value("ior", 1.5);
+    return scene.GetMaterials().Intern(type, col, fuzz, ior);
+}
+
+void SceneLoader::ParseMaterialsJSON(const json& j, Scene& scene) {
+    // accepts {"name": {...}, ...} or [{"name": "...", ...}, ...]
+    if (j.is_object()) {
+        for (auto it = j.begin(); it != j.end(); ++it) {
+            scene.GetMaterials().AddNamed(it.key(), MaterialFromJSON(it.value(), scene));
+        }
+    } else {
+        for (const auto& item : j) {
+            scene.GetMaterials().AddNamed(item["name"], MaterialFromJSON(item, scene));
+        }
+    }
+}
+
+std::shared_ptr<Material> SceneLoader::ParseObjectMaterialJSON(const json& j, Scene& scene) {
+    if (j.contains("material")) {
+        const json& ref = j["material"];
+        if (ref.is_object()) return MaterialFromJSON(ref, scene);
+
+        auto m = scene.GetMaterials().GetNamed(ref);
+        if (m) return m;
+        std::cerr << "Warning: unknown material '" << ref.get<std::string>() << "', using inline parameters" << std::endl;
+    }
+    // inline parameters: material_type + color (+ optional fuzz / ior)
+    return MaterialFromJSON(j, scene, "material_type");
+}
+
+long SceneLoader::ParseObjectJSON(const json& item, Scene& scene) {
+    auto object = CreateObjectJSON(item, scene);
+    if (!object) return -1;
+    scene.AddObject(object);
+    return static_cast<long>(scene.GetPrimitives().objects.size()) - 1;
+}
+
+void SceneLoader::ParseLightJSON(const json& item, Scene& scene) {
+    if (auto light = CreateLightJSON(item)) scene.AddLight(light);
+}
+
+std::shared_ptr<hittable> SceneLoader::CreateObjectJSON(const json& item, Scene& scene) {
+    std::string type = item["type"];
+    if (type == "sphere") return ParseSphereJSON(item, scene);
+    if (type == "plane") return ParsePlaneJSON(item, scene);
+    if (type == "cylinder") return ParseCylinderJSON(item, scene);
+    if (type == "cone") return ParseConeJSON(item, scene);
+    if (type == "triangle") return ParseTriangleJSON(item, scene);
+    if (type == "parallepiped" || type == "box") return ParseParallelepipedJSON(item, scene);
+    if (type == "quad" || type == "parallelogram") return ParseQuadJSON(item, scene);
+    return nullptr;
+}
+
+std::shared_ptr<Light> SceneLoader::CreateLightJSON(const json& item) {
+    std::string type = item["type"];
+    if (type == "point") return ParsePointLightJSON(item);
+    if (type == "directional" || type == "sun") return ParseDirectionalLightJSON(item);
+    if (type == "spot" || type == "spotlight") return ParseSpotLightJSON(item);
+    return nullptr;
+}
+
+std::shared_ptr<hittable> SceneLoader::ParseSphereJSON(const json& j, Scene& scene) {
     auto center = LoadVec3(j["center"]);
     double r = j["radius"];
-    auto col = LoadVec3(j["color"]);
-    int mat = j["material_type"];  // 0=lambertian, 1=metal, 2=dielectric
+    auto m = ParseObjectMaterialJSON(j, scene);
 
-    std::shared_ptr<Material> m;
-    if (mat == 0) m = std::make_shared<Lambertian>(col);
-    else if (mat == 1) m = std::make_shared<Metal>(col, 0.1);
-    else m = std::make_shared<Dielectric>(1.5);
-
-    scene.AddObject(std::make_shared<sphere>(center, r, m));
+    return std::make_shared<sphere>(center, r, m);
 }
 
-void SceneLoader::ParsePlaneJSON(const json& j, Scene& scene) {
+std::shared_ptr<hittable> SceneLoader::ParsePlaneJSON(const json& j, Scene& scene) {
     auto pt = LoadVec3(j["point"]);
     auto norm = LoadVec3(j["normal"]);
-    auto col = LoadVec3(j["color"]);
-    int mat = j["material_type"];
-
-    std::shared_ptr<Material> m;
-    if (mat == 0) m = std::make_shared<Lambertian>(col);
-    else if (mat == 1) m = std::make_shared<Metal>(col, 0.1);
-    else m = std::make_shared<Dielectric>(1.5);
+    auto m = ParseObjectMaterialJSON(j, scene);
 
-    scene.AddObject(std::make_shared<Plan>(pt, norm, m));
+    return std::make_shared<Plan>(pt, norm, m);
 }
 
-void SceneLoader::ParsePointLightJSON(const json& j, Scene& scene) {
+std::shared_ptr<Light> SceneLoader::ParsePointLightJSON(const json& j) {
     auto pos = LoadVec3(j["position"]);
     auto intensity = LoadVec3(j["intensity"]);
     
-    scene.AddLight(std::make_shared<PointLight>(pos, intensity));
+    return std::make_shared<PointLight>(pos, intensity);
 }
 
-void SceneLoader::ParseDirectionalLightJSON(const json& j, Scene& scene) {
+std::shared_ptr<Light> SceneLoader::ParseDirectionalLightJSON(const json& j) {
     auto dir = LoadVec3(j["direction"]);
     auto intensity = LoadVec3(j["intensity"]);
     
-    scene.AddLight(std::make_shared<DirectionalLight>(dir, intensity));
+    return std::make_shared<DirectionalLight>(dir, intensity);
 }
 
-void SceneLoader::ParseSpotLightJSON(const json& j, Scene& scene) {
+std::shared_ptr<Light> SceneLoader::ParseSpotLightJSON(const json& j) {
     auto pos = LoadVec3(j["position"]);
     auto dir = LoadVec3(j["direction"]);
     auto intensity = LoadVec3(j["intensity"]);
     double inner_angle = j.value("inner_angle", 20.0);  // default 20 degrees
     double outer_angle = j.value("outer_angle", 30.0);  // default 30 degrees
     
-    scene.AddLight(std::make_shared<SpotLight>(pos, dir, intensity, inner_angle, outer_angle));
+    return std::make_shared<SpotLight>(pos, dir, intensity, inner_angle, outer_angle);
 }
 
-void SceneLoader::ParseCylinderJSON(const json& j, Scene& scene) {
+std::shared_ptr<hittable> SceneLoader::ParseCylinderJSON(const json& j, Scene& scene) {
     auto base = LoadVec3(j["base"]);
     auto axis = LoadVec3(j["axis"]);
     double radius = j["radius"];
     double height = j["height"];
-    auto col = LoadVec3(j["color"]);
-    int mat = j["material_type"];
+    auto m = ParseObjectMaterialJSON(j, scene);
 
-    std::shared_ptr<Material> m;
-    if (mat == 0) m = std::make_shared<Lambertian>(col);
-    else if (mat == 1) m = std::make_shared<Metal>(col, 0.1);
-    else m = std::make_shared<Dielectric>(1.5);
-
-    scene.AddObject(std::make_shared<Cylinder>(base, axis, radius, height, m));
+    return std::make_shared<Cylinder>(base, axis, radius, height, m);
 }
 
-void SceneLoader::ParseConeJSON(const json& j, Scene& scene) {
+std::shared_ptr<hittable> SceneLoader::ParseConeJSON(const json& j, Scene& scene) {
     auto apex = LoadVec3(j["apex"]);
     auto axis = LoadVec3(j["axis"]);
     double angle_deg = j["angle"];
     double angle = angle_deg * M_PI / 180.0;  // convert degrees to radians
     double height = j["height"];
-    auto col = LoadVec3(j["color"]);
-    int mat = j["material_type"];
-
-    std::shared_ptr<Material> m;
-    if (mat == 0) m = std::make_shared<Lambertian>(col);
-    else if (mat == 1) m = std::make_shared<Metal>(col, 0.1);
-    else m = std::make_shared<Dielectric>(1.5);
+    auto m = ParseObjectMaterialJSON(j, scene);
 
-    scene.AddObject(std::make_shared<Cone>(apex, axis, angle, height, m));
+    return std::make_shared<Cone>(apex, axis, angle, height, m);
 }
 
-void SceneLoader::ParseTriangleJSON(const json& j, Scene& scene) {
+std::shared_ptr<hittable> SceneLoader::ParseTriangleJSON(const json& j, Scene& scene) {
     auto v0 = LoadVec3(j["v0"]);
     auto v1 = LoadVec3(j["v1"]);
     auto v2 = LoadVec3(j["v2"]);
-    auto col = LoadVec3(j["color"]);
-    int mat = j["material_type"];
-
-    std::shared_ptr<Material> m;
-    if (mat == 0) m = std::make_shared<Lambertian>(col);
-    else if (mat == 1) m = std::make_shared<Metal>(col, 0.1);
-    else m = std::make_shared<Dielectric>(1.5);
+    auto m = ParseObjectMaterialJSON(j, scene);
 
-    scene.AddObject(std::make_shared<Triangle>(v0, v1, v2, m));
+    return std::make_shared<Triangle>(v0, v1, v2, m);
 }
 
-void SceneLoader::ParseParallelepipedJSON(const json& j, Scene& scene) {
+std::shared_ptr<hittable> SceneLoader::ParseParallelepipedJSON(const json& j, Scene& scene) {
     auto p_min = LoadVec3(j["p_min"]);
     auto p_max = LoadVec3(j["p_max"]);
-    auto col = LoadVec3(j["color"]);
-    int mat = j["material_type"];
+    auto m = ParseObjectMaterialJSON(j, scene);
+
+    return std::make_shared<Parallepiped>(p_min, p_max, m);
+}
 
-    std::shared_ptr<Material> m;
-    if (mat == 0) m = std::make_shared<Lambertian>(col);
-    else if (mat == 1) m = std::make_shared<Metal>(col, 0.1);
-    else m = std::make_shared<Dielectric>(1.5);
+std::shared_ptr<hittable> SceneLoader::ParseQuadJSON(const json& j, Scene& scene) {
+    auto corner = LoadVec3(j["corner"]);
+    auto u = LoadVec3(j["u"]);
+    auto v = LoadVec3(j["v"]);
+    auto m = ParseObjectMaterialJSON(j, scene);
 
-    scene.AddObject(std::make_shared<Parallepiped>(p_min, p_max, m));
+    return std::make_shared<Quad>(corner, u, v, m);
 }
 
 void SceneLoader::ParseCameraJSON(const json& j, Scene& scene, double aspect_ratio) {
@@ -9,6 +9,9 @@
 #include "materials/hpp/Lambertian.hpp"
 #include "materials/hpp/Metal.hpp"
 #include "materials/hpp/Dielectric.hpp"
+#include "utils/hpp/Trace.hpp"
+#include <chrono>
+#include <iostream>
 
 
 
@@ -24,4 +27,131 @@ Scene::Scene() {
     auto aperture = 0.1;
     s_camera.Setup(lookfrom, lookat, vup, 20, 1.0, aperture, dist_to_focus);
 
+}
+
+void Scene::BuildBVH() {
+    DiscardRebuild();
+    if (s_Bvh) s_ObjectList = s_Primitives;
+    if (s_ObjectList.objects.empty()) return;
+
+    SetBVH(BuildHierarchy(s_ObjectList, s_BvhBuilder));
+}
+
+std::shared_ptr<bvh_node> Scene::BuildHierarchy(const hittable_list& primitives, BVHBuilder builder) {
+    TraceScope trace("build bvh", "bvh");
+    trace.Arg("primitives", static_cast<long long>(primitives.objects.size())).Arg("builder", static_cast<int>(builder));
+    if (builder == BVHBuilder::Median) return std::make_shared<bvh_node>(primitives);
+
+    LinearBVH::Options options;
+    options.treelet_passes = builder == BVHBuilder::LinearRefined ? 2 : 0;
+    return LinearBVH::Build(primitives, options);
+}
+
+void Scene::SetBVH(std::shared_ptr<bvh_node> root) {
+    DiscardRebuild();
+    if (!s_Bvh) s_Primitives = s_ObjectList;
+    s_Bvh = std::move(root);
+    IndexLeaves();
+    AttachBVH();
+}
+
+void Scene::IndexLeaves() {
+    s_LeafParent.clear();
+    s_Bvh->for_each_leaf([this](bvh_node* parent, const hittable* leaf) { s_LeafParent[leaf] = parent; });
+}
+
+void Scene::AttachBVH() {
+    s_ObjectList.clear();
+    s_ObjectList.add(s_Bvh);
+    // primitives added after the build are traced from the flat list
+    for (const auto& object : s_Primitives.objects) {
+        if (!s_LeafParent.count(object.get())) s_ObjectList.add(object);
+    }
+
+    s_BvhBuildCost = s_BvhCost = s_Bvh->sah_cost();
+    s_BvhCostDirty = false;
+}
+
+bool Scene::ReplaceLeaf(const hittable* old_leaf, const std::shared_ptr<hittable>& new_leaf) {
+    auto it = s_LeafParent.find(old_leaf);
+    if (it == s_LeafParent.end()) return false;
+
+    bvh_node* parent = it->second;
+    parent->replace_child(old_leaf, new_leaf);
+    s_LeafParent.erase(it);
+    s_LeafParent[new_leaf.get()] = parent;
+    parent->refit_up();
+    s_BvhCostDirty = true;
+    return true;
+}
+
+void Scene::ReplaceObject(size_t index, std::shared_ptr<hittable> object) {
+    s_Lights.area_lights.Replace(GetPrimitives().objects.at(index).get(), object);
+    if (!s_Bvh) {
+        s_ObjectList.objects.at(index) = std::move(object);
+        return;
+    }
+
+    auto& slot = s_Primitives.objects.at(index);
+    if (s_Rebuild.valid()) s_PendingEdits.emplace_back(slot, object);
+    if (!ReplaceLeaf(slot.get(), object)) {
+        // not in the tree (added after the build): traced from the flat list
+        for (auto& o : s_ObjectList.objects) {
+            if (o == slot) o = object;
+        }
+    }
+    slot = std::move(object);
+}
+
+bool Scene::TranslateObject(size_t index, const Vector3& offset) {
+    auto moved = GetPrimitives().objects.at(index)->translated(offset);
+    if (!moved) return false;
+    ReplaceObject(index, std::move(moved));
+    return true;
+}
+
+double Scene::GetBVHCostRatio() {
+    if (!s_Bvh || s_BvhBuildCost <= 0.0) return 1.0;
+    if (s_BvhCostDirty) {
+        s_BvhCost = s_Bvh->sah_cost();
+        s_BvhCostDirty = false;
+    }
+    return s_BvhCost / s_BvhBuildCost;
+}
+
+bool Scene::MonitorBVH() {
+    if (!s_Bvh) return false;
+
+    if (s_Rebuild.valid()) {
+        if (s_Rebuild.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+        InstallRebuild(s_Rebuild.get());
+        return true;
+    }
+
+    double ratio = GetBVHCostRatio();
+    if (ratio > s_RebuildThreshold) {
+        std::cout << "BVH cost x" << ratio << " since the last build, rebuilding in the background" << std::endl;
+        // primitives are replaced, never modified in place, so the copy can be read from another thread
+        s_PendingEdits.clear();
+        s_Rebuild = std::async(std::launch::async, [primitives = s_Primitives, builder = s_BvhBuilder]() {
+            if (Trace::Enabled()) Trace::SetThreadName("bvh rebuild");
+            return BuildHierarchy(primitives, builder);
+        });
+    }
+    return false;
+}
+
+void Scene::InstallRebuild(std::shared_ptr<bvh_node> root) {
+    s_Bvh = std::move(root);
+    IndexLeaves();
+    // the tree was built from a snapshot: replay what changed since
+    for (const auto& edit : s_PendingEdits) ReplaceLeaf(edit.first.get(), edit.second);
+    s_PendingEdits.clear();
+    AttachBVH();
+}
+
+void Scene::DiscardRebuild() {
+    if (s_Rebuild.valid()) s_Rebuild.wait();
+    s_Rebuild = {};
+    s_PendingEdits.clear();
 }
\ No newline at end of file
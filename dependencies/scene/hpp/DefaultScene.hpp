@@ -0,0 +1,18 @@
+/*
+    DefaultScene.hpp
+    Built-in random spheres scene (3 large spheres and many small ones)
+    Used by the UI "Default" scene and by the render benchmark
+*/
+
+#ifndef DEFAULTSCENE_HPP
+#define DEFAULTSCENE_HPP
+
+#include "scene.hpp"
+
+class DefaultScene {
+public:
+    // fills the scene; call seed_random() first for a reproducible layout
+    static void Build(Scene& scene, double aspect_ratio = 16.0/9.0);
+};
+
+#endif
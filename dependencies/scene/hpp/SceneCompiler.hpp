@@ -0,0 +1,101 @@
+/*
+    SceneCompiler.hpp
+    Compiled (binary) scene format
+    Converts JSON scenes to a versioned blob that is loaded with mmap instead of parsed
+*/
+
+#ifndef SCENECOMPILER_HPP
+#define SCENECOMPILER_HPP
+
+#include <cstdint>
+#include <string>
+#include "scene.hpp"
+
+// On-disk layout (native endianness, every section 8-byte aligned):
+//   SceneFileHeader | materials | primitives | lights | camera | bvh nodes
+// Sections are referenced by byte offset from the start of the file, the
+// loader turns them into typed pointers into the mapping (pointer fixup).
+namespace scenefile {
+
+const char     kMagic[8]       = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+const uint32_t kVersion        = 2;   // 2: quads and emissive materials (version 1 files still load)
+const uint32_t kEndianMarker   = 0x01020304;
+
+enum Section : uint32_t { Materials = 0, Primitives, Lights, CameraParams, BvhNodes, SectionCount };
+
+enum PrimitiveType : uint32_t { SphereType = 0, PlaneType, CylinderType, ConeType, TriangleType, BoxType, QuadType };
+enum LightType : uint32_t { PointType = 0, DirectionalType, SpotType };
+
+struct SectionEntry {
+    uint64_t offset;   // byte offset from the start of the file
+    uint64_t count;    // number of records
+};
+
+struct SceneFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint64_t file_size;
+    SectionEntry sections[SectionCount];
+};
+
+// material_type as in the JSON format: 0 = lambertian, 1 = metal, 2 = dielectric,
+// 3 = emissive (color holds the radiance)
+struct PackedMaterial {
+    uint32_t type;
+    uint32_t pad;
+    double   color[3];
+    double   param;    // fuzz for metal, index of refraction for dielectric
+};
+
+// data layout per type:
+//   sphere   : center[3] radius          plane : point[3] normal[3]
+//   cylinder : base[3] axis[3] radius h  cone  : apex[3] axis[3] angle(rad) h
+//   triangle : v0[3] v1[3] v2[3]         box   : p_min[3] p_max[3]
+//   quad     : corner[3] u[3] v[3]
+struct PackedPrimitive {
+    uint32_t type;
+    uint32_t material;  // index in the materials section
+    double   data[9];
+};
+
+struct PackedLight {
+    uint32_t type;
+    uint32_t pad;
+    double   position[3];
+    double   direction[3];
+    double   intensity[3];
+    double   inner_deg, outer_deg;
+};
+
+struct PackedCamera {
+    double look_from[3], look_at[3], view_up[3];
+    double vfov, aperture, focus_dist;
+};
+
+// children >= 0 index other nodes, children < 0 encode primitive ~child
+// nodes are stored in pre-order so children always come after their parent
+struct PackedBvhNode {
+    double  min[3], max[3];
+    int32_t left, right;
+};
+
+} // namespace scenefile
+
+class SceneCompiler {
+public:
+    // JSON -> binary converter, optionally stores a prebuilt BVH
+    static bool CompileJSON(const std::string& json_file, const std::string& out_file, bool with_bvh = true);
+
+    // writes an in-memory scene (primitives, materials, lights, camera, BVH if any)
+    static bool Save(const Scene& scene, const std::string& out_file, bool with_bvh = true);
+
+    // maps a compiled scene and builds the objects from the packed records
+    // use_bvh: install the stored hierarchy (or build one if the file has none)
+    static bool Load(const std::string& filename, Scene& scene, double aspect_ratio = 16.0/9.0, bool use_bvh = true);
+
+    // true if the file starts with the compiled scene magic
+    static bool IsCompiledScene(const std::string& filename);
+};
+
+#endif
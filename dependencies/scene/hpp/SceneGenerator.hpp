@@ -0,0 +1,46 @@
+/*
+    SceneGenerator.hpp
+    Seeded procedural scenes for scaling tests (up to ~10^7 primitives)
+    Built in memory, or written as JSON / compiled scenes without going through a Scene
+*/
+
+#ifndef SCENEGENERATOR_HPP
+#define SCENEGENERATOR_HPP
+
+#include "scene.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class SceneGenerator {
+public:
+    enum class TriangleMode { Soup = 0, Surface };
+
+    struct Options {
+        uint64_t seed = 1;
+        size_t spheres = 10000;
+        size_t triangles = 0;
+        TriangleMode triangle_mode = TriangleMode::Soup;   // random soup or a tessellated terrain
+        size_t lights = 4;
+        // relative weights of the material mix, normalized by the generator
+        double diffuse = 0.7;
+        double metal = 0.2;
+        double glass = 0.1;
+    };
+
+    // same seed, same options -> same scene, whatever the output
+    static void Generate(const Options& options, Scene& scene, double aspect_ratio = 16.0 / 9.0);
+
+    // streamed to disk, memory stays flat whatever the primitive count
+    static bool WriteJSON(const Options& options, const std::string& filename);
+
+    // generated in memory, then saved with SceneCompiler
+    static bool WriteCompiled(const Options& options, const std::string& filename, bool with_bvh = true);
+
+    // parses "--spheres N --triangles M --surface --lights K --mix d,m,g --seed S",
+    // unknown arguments are returned in rest
+    static bool ParseArgs(const std::vector<std::string>& args, Options& options, std::vector<std::string>& rest);
+    static std::string Usage();
+};
+
+#endif
@@ -0,0 +1,45 @@
+/*
+    SceneReloader.hpp
+    Incremental reload of a JSON scene
+    Diffs the new file against the loaded one and patches the scene in place
+*/
+
+#ifndef SCENERELOADER_HPP
+#define SCENERELOADER_HPP
+
+#include <string>
+#include "scene.hpp"
+#include "Sceneloader.hpp"
+
+class SceneReloader {
+public:
+    struct Result {
+        bool ok = false;              // false: file unreadable or invalid, scene untouched
+        bool full_reload = false;     // structural change, the caller must reload everything (and set a new baseline)
+        size_t objects_updated = 0;
+        size_t lights_updated = 0;
+        bool camera_updated = false;
+        double ms = 0.0;
+
+        bool Changed() const { return full_reload || objects_updated || lights_updated || camera_updated; }
+    };
+
+    // remembers the document the scene was just built from and where its objects went
+    bool SetBaseline(const std::string& filename, SceneLoader::ObjectMap object_map);
+    void ClearBaseline() { m_hasBaseline = false; m_baseline = json(); m_objectMap.clear(); }
+
+    // diffs filename against the baseline and updates changed objects, lights and
+    // camera in place (BVH refitted, not rebuilt); the baseline becomes the new file
+    Result Reload(const std::string& filename, Scene& scene, double aspect_ratio = 16.0/9.0);
+
+private:
+    static bool ReadJSON(const std::string& filename, json& out);
+    // true if both documents have the same objects/materials layout (only values differ)
+    static bool SameStructure(const json& before, const json& after);
+
+    json m_baseline;
+    SceneLoader::ObjectMap m_objectMap;  // baseline "objects" index -> primitive index
+    bool m_hasBaseline = false;
+};
+
+#endif
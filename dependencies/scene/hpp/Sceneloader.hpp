@@ -8,6 +8,7 @@
 #define SCENELOADER_HPP
 
 #include <string>
+#include <vector>
 #include "scene.hpp"
 #include "../../utils/hpp/json.hpp" 
 
@@ -15,24 +16,50 @@ using json = nlohmann::json;
 
 class SceneLoader {
 public:
-    
+    // "objects" entry i -> index of its primitive in the scene, -1 if the entry was skipped
+    // (entries are not always added in file order, see LoadJSONStream)
+    using ObjectMap = std::vector<long>;
+
     // loads scene from JSON file (aspect_ratio needed for camera setup)
-    static void LoadJSON(const std::string& filename, Scene& scene, double aspect_ratio = 16.0/9.0);
-    static void LoadJSONBVH(const std::string& filename, Scene& scene, double aspect_ratio = 16.0/9.0);
+    // object_map, if given, is filled for hot reload
+    static void LoadJSON(const std::string& filename, Scene& scene, double aspect_ratio = 16.0/9.0, ObjectMap* object_map = nullptr);
+    static void LoadJSONBVH(const std::string& filename, Scene& scene, double aspect_ratio = 16.0/9.0, ObjectMap* object_map = nullptr);
+
+    // SAX based loader: objects are built while the file is read, no DOM of the whole file
+    // false if the file can't be read or is not valid JSON (the scene is then incomplete)
+    static bool LoadJSONStream(const std::string& filename, Scene& scene, double aspect_ratio = 16.0/9.0, bool build_bvh = true,
+                               ObjectMap* object_map = nullptr);
+
+    // builds one object/light from its JSON description without adding it
+    // (materials are interned in the scene library), nullptr for unknown types
+    static std::shared_ptr<hittable> CreateObjectJSON(const json& item, Scene& scene);
+    static std::shared_ptr<Light> CreateLightJSON(const json& item);
 
 private:
-    
+    friend class SceneSaxHandler;
+    friend class SceneReloader;
+
+    // create + add to the scene; the object's primitive index, -1 if nothing was added
+    static long ParseObjectJSON(const json& item, Scene& scene);
+    static void ParseLightJSON(const json& item, Scene& scene);
+
     // parsers for each object type
-    static void ParseSphereJSON(const json& j, Scene& scene);
-    static void ParsePlaneJSON(const json& j, Scene& scene);
-    static void ParseCylinderJSON(const json& j, Scene& scene);
-    static void ParseConeJSON(const json& j, Scene& scene);
-    static void ParseTriangleJSON(const json& j, Scene& scene);
-    static void ParseParallelepipedJSON(const json& j, Scene& scene);
-    static void ParsePointLightJSON(const json& j, Scene& scene);
-    static void ParseDirectionalLightJSON(const json& j, Scene& scene);
-    static void ParseSpotLightJSON(const json& j, Scene& scene);
+    static std::shared_ptr<hittable> ParseSphereJSON(const json& j, Scene& scene);
+    static std::shared_ptr<hittable> ParsePlaneJSON(const json& j, Scene& scene);
+    static std::shared_ptr<hittable> ParseCylinderJSON(const json& j, Scene& scene);
+    static std::shared_ptr<hittable> ParseConeJSON(const json& j, Scene& scene);
+    static std::shared_ptr<hittable> ParseTriangleJSON(const json& j, Scene& scene);
+    static std::shared_ptr<hittable> ParseParallelepipedJSON(const json& j, Scene& scene);
+    static std::shared_ptr<hittable> ParseQuadJSON(const json& j, Scene& scene);
+    static std::shared_ptr<Light> ParsePointLightJSON(const json& j);
+    static std::shared_ptr<Light> ParseDirectionalLightJSON(const json& j);
+    static std::shared_ptr<Light> ParseSpotLightJSON(const json& j);
     
+    // "materials" section: named, fully parameterized materials
+    static void ParseMaterialsJSON(const json& j, Scene& scene);
+    // material of an object: "material" name/definition or inline material_type + color
+    static std::shared_ptr<Material> ParseObjectMaterialJSON(const json& j, Scene& scene);
+
     // camera configuration parser
     static void ParseCameraJSON(const json& j, Scene& scene, double aspect_ratio);
 };
@@ -9,10 +9,20 @@
 
 #include "../../camera/hpp/Camera.hpp"
 #include "../../objects/hpp/_Hittable_object_list.hpp"
+#include "../../objects/hpp/_bvh_node.hpp"
+#include "../../objects/hpp/LinearBVH.hpp"
 #include "../../lights/hpp/Light_list.hpp"
+#include "../../materials/hpp/MaterialLibrary.hpp"
+#include <future>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+// Median: recursive median split on a random axis (best traversal, slowest build)
+// Linear: LBVH from 63-bit Morton codes, LinearRefined adds two treelet passes
+enum class BVHBuilder { Median = 0, Linear, LinearRefined };
+
 class Scene {
 public:
     Scene(); 
@@ -21,10 +31,20 @@ public:
     const Camera& GetCamera() const { return s_camera; }
     const hittable_list& GetObjects() const { return s_ObjectList; }
     const Light_list& GetLights() const { return s_Lights; }
+
+    // flat list of primitives, even when they are wrapped in a BVH
+    const hittable_list& GetPrimitives() const { return s_Bvh ? s_Primitives : s_ObjectList; }
+    const std::shared_ptr<bvh_node>& GetBVH() const { return s_Bvh; }
+
+    // shared materials (named + deduplicated inline ones)
+    MaterialLibrary& GetMaterials() { return s_Materials; }
+    const MaterialLibrary& GetMaterials() const { return s_Materials; }
     
    
     // add objects and lights to the scene
     void AddObject(std::shared_ptr<hittable> object) { 
+        s_Lights.area_lights.Add(object);     // emitters are also lights
+        if (s_Bvh) s_Primitives.add(object);  // traced outside the BVH until the next BuildBVH()
         s_ObjectList.add(object); 
     }
     void AddLight(std::shared_ptr<Light> light) { 
@@ -40,18 +60,71 @@ public:
     // direct camera access for setup
     Camera& GetCameraMutable() { return s_camera; }
 
+    // wraps the current primitives in a BVH, the flat list is kept for saving/editing
+    void BuildBVH();
+    // builder used by BuildBVH() and the background rebuilds
+    void SetBVHBuilder(BVHBuilder builder) { s_BvhBuilder = builder; }
+    BVHBuilder GetBVHBuilder() const { return s_BvhBuilder; }
+    static std::shared_ptr<bvh_node> BuildHierarchy(const hittable_list& primitives, BVHBuilder builder);
+    // installs an already built hierarchy over the current primitives
+    void SetBVH(std::shared_ptr<bvh_node> root);
+
+    // in-place edits (hot reload, animation): index follows GetPrimitives() / the lights order
+    // the BVH boxes are refitted along the path of the edited primitive only
+    void ReplaceObject(size_t index, std::shared_ptr<hittable> object);
+    // moves a primitive (a moved copy replaces it), false if its type can't be moved
+    bool TranslateObject(size_t index, const Vector3& offset);
+    void SetLight(size_t index, std::shared_ptr<Light> light) { s_Lights.set(index, std::move(light)); }
+    void ClearLights() { s_Lights.clear(); }
+    // refits every BVH box (edits already refit their own path)
+    void RefitBVH() { if (s_Bvh) { s_Bvh->refit(); s_BvhCostDirty = true; } }
+
+    // BVH quality: SAH cost of the refitted tree over its cost right after the build
+    double GetBVHCostRatio();
+    void SetRebuildThreshold(double ratio) { s_RebuildThreshold = ratio; }
+    double GetRebuildThreshold() const { return s_RebuildThreshold; }
+    bool IsRebuildingBVH() const { return s_Rebuild.valid(); }
+    // quality monitor, call once per frame: starts a background rebuild when the cost
+    // ratio passes the threshold and installs it once done; true when the BVH was swapped
+    bool MonitorBVH();
+
     // reset scene to empty state
     void Clear() {
+        DiscardRebuild();
         s_ObjectList.clear();
+        s_Primitives.clear();
+        s_Bvh.reset();
+        s_LeafParent.clear();
         s_Lights.clear();
+        s_Lights.area_lights.Clear();
+        s_Materials.Clear();
     }
 
    
 
 private:
     Camera s_camera;            // scene camera
-    hittable_list s_ObjectList; // all objects in scene
+    hittable_list s_ObjectList; // what rays are traced against (primitives or BVH root)
+    hittable_list s_Primitives; // primitives held by s_Bvh
+    std::shared_ptr<bvh_node> s_Bvh;
+    std::unordered_map<const hittable*, bvh_node*> s_LeafParent;  // primitive -> its BVH leaf node
+
+    double s_BvhBuildCost = 0.0;
+    double s_BvhCost = 0.0;
+    bool s_BvhCostDirty = false;
+    double s_RebuildThreshold = 1.5;
+    BVHBuilder s_BvhBuilder = BVHBuilder::Median;
+    std::future<std::shared_ptr<bvh_node>> s_Rebuild;
+    // edits made while s_Rebuild runs, replayed on the new tree (old, new)
+    std::vector<std::pair<std::shared_ptr<hittable>, std::shared_ptr<hittable>>> s_PendingEdits;
+
+    void IndexLeaves();
+    void AttachBVH();
+    bool ReplaceLeaf(const hittable* old_leaf, const std::shared_ptr<hittable>& new_leaf);
+    void InstallRebuild(std::shared_ptr<bvh_node> root);
+    void DiscardRebuild();
     Light_list s_Lights;        // all light sources
+    MaterialLibrary s_Materials;
 };
 
 #endif
\ No newline at end of file
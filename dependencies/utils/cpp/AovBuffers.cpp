@@ -0,0 +1,91 @@
+/*
+    AovBuffers.cpp
+    Allocation of the enabled passes and their EXR layout
+*/
+
+#include "../hpp/AovBuffers.hpp"
+#include "../hpp/ExrWriter.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+const char* const kNames[kAovCount] = {"color", "albedo", "normal", "depth", "object", "material", "samples"};
+
+template <typename T>
+void Allocate(std::vector<T>& plane, bool enabled, size_t size) {
+    if (enabled) plane.assign(size, T());
+    else std::vector<T>().swap(plane);   // disabled passes give their memory back
+}
+
+} // namespace
+
+const char* AovBuffers::Name(Aov aov) {
+    int index = static_cast<int>(aov);
+    return index >= 0 && index < kAovCount ? kNames[index] : "unknown";
+}
+
+bool AovBuffers::ParseList(const std::string& list, unsigned& passes) {
+    passes = 0;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item.empty()) continue;
+        if (item == "all") {
+            passes = kAllPasses;
+            continue;
+        }
+        const char* const* found = std::find(kNames, kNames + kAovCount, item);
+        if (found == kNames + kAovCount) return false;
+        passes |= 1u << (found - kNames);
+    }
+    return true;
+}
+
+void AovBuffers::Resize(int width, int height) {
+    m_width = std::max(width, 0);
+    m_height = std::max(height, 0);
+    const size_t size = static_cast<size_t>(m_width) * m_height;
+    for (int c = 0; c < 3; c++) {
+        Allocate(m_color[c], Has(Aov::Color), size);
+        Allocate(m_albedo[c], Has(Aov::Albedo), size);
+        Allocate(m_normal[c], Has(Aov::Normal), size);
+    }
+    Allocate(m_depth, Has(Aov::Depth), size);
+    Allocate(m_objectId, Has(Aov::ObjectId), size);
+    Allocate(m_materialId, Has(Aov::MaterialId), size);
+    Allocate(m_sampleCount, Has(Aov::SampleCount), size);
+}
+
+double AovBuffers::Get(Aov aov, int channel, int x, int y) const {
+    if (!Has(aov) || Empty()) return 0.0;
+    const size_t i = Index(x, y);
+    switch (aov) {
+        case Aov::Color: return Half::ToFloat(m_color[channel][i]);
+        case Aov::Albedo: return Half::ToFloat(m_albedo[channel][i]);
+        case Aov::Normal: return Half::ToFloat(m_normal[channel][i]);
+        case Aov::Depth: return m_depth[i];
+        case Aov::ObjectId: return m_objectId[i];
+        case Aov::MaterialId: return m_materialId[i];
+        case Aov::SampleCount: return m_sampleCount[i];
+        default: return 0.0;
+    }
+}
+
+bool AovBuffers::WriteEXR(const std::string& filename) const {
+    using Type = ExrWriter::PixelType;
+    std::vector<ExrWriter::Channel> channels;
+    auto add3 = [&](Aov aov, const std::vector<uint16_t>* planes, const std::string& layer, const char* components) {
+        if (!Has(aov)) return;
+        for (int c = 0; c < 3; c++) channels.push_back({layer + components[c], Type::Half, planes[c].data()});
+    };
+    add3(Aov::Color, m_color, "", "RGB");
+    add3(Aov::Albedo, m_albedo, "albedo.", "RGB");
+    add3(Aov::Normal, m_normal, "normal.", "XYZ");
+    if (Has(Aov::Depth)) channels.push_back({"Z", Type::Float, m_depth.data()});
+    if (Has(Aov::ObjectId)) channels.push_back({"object.id", Type::Uint, m_objectId.data()});
+    if (Has(Aov::MaterialId)) channels.push_back({"material.id", Type::Uint, m_materialId.data()});
+    if (Has(Aov::SampleCount)) channels.push_back({"samples.count", Type::Uint, m_sampleCount.data()});
+    return ExrWriter::Write(filename, m_width, m_height, std::move(channels));
+}
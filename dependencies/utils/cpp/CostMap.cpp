@@ -0,0 +1,69 @@
+/*
+    CostMap.cpp
+    Percentile scaling and false-colour conversion of the per-pixel costs
+*/
+
+#include "../hpp/CostMap.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void CostMap::Resize(int width, int height) {
+    m_width = std::max(width, 0);
+    m_height = std::max(height, 0);
+    for (auto& values : m_values) values.assign(static_cast<size_t>(m_width) * m_height, 0.0f);
+}
+
+double CostMap::Scale(CostMetric metric) const {
+    std::vector<float> values = m_values[static_cast<int>(metric)];
+    if (values.empty()) return 0.0;
+    size_t k = static_cast<size_t>(0.99 * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k] > 0.0f ? values[k] : Max(metric);
+}
+
+double CostMap::Max(CostMetric metric) const {
+    const auto& values = m_values[static_cast<int>(metric)];
+    return values.empty() ? 0.0 : *std::max_element(values.begin(), values.end());
+}
+
+namespace {
+
+// piecewise linear ramp: dark blue, blue, cyan, green, yellow, red
+void HeatColor(double t, double& r, double& g, double& b) {
+    static const double stops[][3] = {
+        {0.00, 0.00, 0.20}, {0.00, 0.20, 1.00}, {0.00, 0.90, 1.00},
+        {0.10, 1.00, 0.10}, {1.00, 1.00, 0.00}, {1.00, 0.00, 0.00},
+    };
+    const int last = sizeof(stops) / sizeof(stops[0]) - 1;
+    t = std::min(std::max(t, 0.0), 1.0) * last;
+    int i = std::min(static_cast<int>(t), last - 1);
+    double f = t - i;
+    r = stops[i][0] + f * (stops[i + 1][0] - stops[i][0]);
+    g = stops[i][1] + f * (stops[i + 1][1] - stops[i][1]);
+    b = stops[i][2] + f * (stops[i + 1][2] - stops[i][2]);
+}
+
+} // namespace
+
+void CostMap::ToImage(CostMetric metric, Image& image) const {
+    const double scale = Scale(metric);
+    const int width = std::min(m_width, image.GetXsize());
+    const int height = std::min(m_height, image.GetYsize());
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double r, g, b;
+            HeatColor(scale > 0.0 ? Get(metric, x, y) / scale : 0.0, r, g, b);
+            image.SetPixel(x, y, r * 255.99, g * 255.99, b * 255.99);
+        }
+    }
+}
+
+const char* CostMap::MetricName(CostMetric metric) {
+    switch (metric) {
+        case CostMetric::Time: return "time";
+        case CostMetric::BVHNodes: return "bvh_nodes";
+        case CostMetric::PrimitiveTests: return "primitive_tests";
+        default: return "unknown";
+    }
+}
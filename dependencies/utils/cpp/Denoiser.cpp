@@ -0,0 +1,207 @@
+/*
+    Denoiser.cpp
+    A-trous passes over structure-of-arrays float planes: rows are spread over the
+    OpenMP threads, and each row is filtered tap by tap in SIMD-friendly loops
+*/
+
+#include "../hpp/Denoiser.hpp"
+#include "../hpp/Trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+constexpr float kLuminanceSigma = 4.0f;   // in standard deviations of the pixel mean
+constexpr float kDepthSigma = 1.0f;       // in depth gradients
+constexpr float kAlbedoSigma = 0.1f;
+constexpr float kEpsilon = 1e-4f;
+
+// B3 spline taps
+constexpr float kKernel[5] = {1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4, 1.0f / 16};
+
+// e^x for x <= 0, no libm call so the loops vectorize (relative error < 1e-3)
+inline float FastExp(float x) {
+    float t = std::max(x, -80.0f) * 1.44269504f;
+    float i = static_cast<float>(static_cast<int32_t>(t));
+    i = i > t ? i - 1.0f : i;
+    float f = t - i;
+    float p = 1.0f + f * (0.693147f + f * (0.240227f + f * (0.0555041f + f * 0.00961813f)));
+    int32_t bits = (static_cast<int32_t>(i) + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+inline float Luminance(float r, float g, float b) {
+    return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+}
+
+} // namespace
+
+void Denoiser::Denoise(const FeatureBuffers& features, const Options& options, std::vector<float> out[3]) {
+    TraceScope trace("denoise", "render");
+    const int w = features.GetWidth(), h = features.GetHeight();
+    const size_t n = static_cast<size_t>(w) * h;
+
+    for (int c = 0; c < 3; c++) {
+        const float* src = features.Channel(static_cast<Feature>(static_cast<int>(Feature::ColorR) + c));
+        out[c].assign(src, src + n);
+    }
+    if (n == 0 || options.strength <= 0.0 || options.iterations <= 0) return;
+
+    const float* albedo_r = features.Channel(Feature::AlbedoR);
+    const float* albedo_g = features.Channel(Feature::AlbedoG);
+    const float* albedo_b = features.Channel(Feature::AlbedoB);
+    const float* normal_x = features.Channel(Feature::NormalX);
+    const float* normal_y = features.Channel(Feature::NormalY);
+    const float* normal_z = features.Channel(Feature::NormalZ);
+    const float* depth = features.Channel(Feature::Depth);
+
+    std::vector<float> variance(features.Channel(Feature::Variance), features.Channel(Feature::Variance) + n);
+    std::vector<float> next[3], next_variance(n), luminance(n), sigma(n), gradient(n, 0.0f);
+    for (auto& plane : next) plane.resize(n);
+
+    // depth change to the next pixel, the tolerance of the depth weight
+    #pragma omp parallel for
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            const size_t i = static_cast<size_t>(y) * w + x;
+            if (depth[i] <= 0.0f) continue;
+            float g = 0.0f;
+            if (x > 0 && depth[i - 1] > 0.0f) g = std::max(g, std::fabs(depth[i] - depth[i - 1]));
+            if (x + 1 < w && depth[i + 1] > 0.0f) g = std::max(g, std::fabs(depth[i + 1] - depth[i]));
+            if (y > 0 && depth[i - w] > 0.0f) g = std::max(g, std::fabs(depth[i] - depth[i - w]));
+            if (y + 1 < h && depth[i + w] > 0.0f) g = std::max(g, std::fabs(depth[i + w] - depth[i]));
+            gradient[i] = g;
+        }
+    }
+
+    const float strength = static_cast<float>(options.strength) * kLuminanceSigma;
+    for (int iteration = 0; iteration < options.iterations; iteration++) {
+        const int step = 1 << iteration;
+
+        // luminance tolerance from the variance, smoothed over 3x3 (too noisy per pixel)
+        #pragma omp parallel for
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                const size_t i = static_cast<size_t>(y) * w + x;
+                luminance[i] = Luminance(out[0][i], out[1][i], out[2][i]);
+                float sum = 0.0f, weight = 0.0f;
+                for (int dy = -1; dy <= 1; dy++) {
+                    if (y + dy < 0 || y + dy >= h) continue;
+                    for (int dx = -1; dx <= 1; dx++) {
+                        if (x + dx < 0 || x + dx >= w) continue;
+                        const float k = (dx == 0 ? 0.5f : 0.25f) * (dy == 0 ? 0.5f : 0.25f);
+                        sum += k * variance[i + static_cast<ptrdiff_t>(dy) * w + dx];
+                        weight += k;
+                    }
+                }
+                sigma[i] = strength * std::sqrt(std::max(sum / weight, 0.0f)) + kEpsilon;
+            }
+        }
+
+        #pragma omp parallel
+        {
+            std::vector<float> sum_r(w), sum_g(w), sum_b(w), sum_w(w), sum_v(w);
+
+            #pragma omp for schedule(dynamic, 4)
+            for (int y = 0; y < h; y++) {
+                std::fill(sum_r.begin(), sum_r.end(), 0.0f);
+                std::fill(sum_g.begin(), sum_g.end(), 0.0f);
+                std::fill(sum_b.begin(), sum_b.end(), 0.0f);
+                std::fill(sum_w.begin(), sum_w.end(), 0.0f);
+                std::fill(sum_v.begin(), sum_v.end(), 0.0f);
+                const size_t row = static_cast<size_t>(y) * w;
+
+                for (int ty = -2; ty <= 2; ty++) {
+                    const int yy = y + ty * step;
+                    if (yy < 0 || yy >= h) continue;
+
+                    for (int tx = -2; tx <= 2; tx++) {
+                        const int dx = tx * step;
+                        const int x0 = std::max(0, -dx), x1 = std::min(w, w - dx);
+                        const float k = kKernel[tx + 2] * kKernel[ty + 2];
+                        const float distance = static_cast<float>(std::max(std::abs(tx), std::abs(ty)) * step);
+                        const size_t offset = static_cast<size_t>(yy) * w + dx;
+
+                        const float* cr = out[0].data();
+                        const float* cg = out[1].data();
+                        const float* cb = out[2].data();
+                        const float* lum = luminance.data();
+                        const float* sig = sigma.data();
+                        const float* var = variance.data();
+                        const float* grad = gradient.data();
+                        float* sr = sum_r.data();
+                        float* sg = sum_g.data();
+                        float* sb = sum_b.data();
+                        float* sw = sum_w.data();
+                        float* sv = sum_v.data();
+
+                        #pragma omp simd
+                        for (int x = x0; x < x1; x++) {
+                            const size_t i = row + x;
+                            const size_t j = offset + x;
+
+                            // geometry: same orientation (n.n)^128 and same depth, misses only with misses
+                            float d = normal_x[i] * normal_x[j] + normal_y[i] * normal_y[j] + normal_z[i] * normal_z[j];
+                            d = std::max(d, 0.0f);
+                            d *= d; d *= d; d *= d; d *= d; d *= d; d *= d; d *= d;
+                            const float both_miss = (depth[i] <= 0.0f && depth[j] <= 0.0f) ? 1.0f : 0.0f;
+                            const float w_normal = std::max(d, both_miss);
+                            const float w_depth = FastExp(-std::fabs(depth[i] - depth[j]) / (kDepthSigma * grad[i] * distance + 1e-3f));
+
+                            // appearance: albedo, then luminance within a few standard deviations
+                            const float da = std::fabs(albedo_r[i] - albedo_r[j]) + std::fabs(albedo_g[i] - albedo_g[j]) +
+                                             std::fabs(albedo_b[i] - albedo_b[j]);
+                            const float w_albedo = FastExp(-da / kAlbedoSigma);
+                            const float w_lum = FastExp(-std::fabs(lum[i] - lum[j]) / sig[i]);
+
+                            const float weight = k * w_normal * w_depth * w_albedo * w_lum;
+                            sr[x] += weight * cr[j];
+                            sg[x] += weight * cg[j];
+                            sb[x] += weight * cb[j];
+                            sw[x] += weight;
+                            sv[x] += weight * weight * var[j];
+                        }
+                    }
+                }
+
+                // the center tap has a positive weight unless the normal is degenerate
+                for (int x = 0; x < w; x++) {
+                    if (sum_w[x] <= 0.0f) {
+                        for (int c = 0; c < 3; c++) next[c][row + x] = out[c][row + x];
+                        next_variance[row + x] = variance[row + x];
+                        continue;
+                    }
+                    const float inv = 1.0f / sum_w[x];
+                    next[0][row + x] = sum_r[x] * inv;
+                    next[1][row + x] = sum_g[x] * inv;
+                    next[2][row + x] = sum_b[x] * inv;
+                    next_variance[row + x] = sum_v[x] * inv * inv;
+                }
+            }
+        }
+
+        for (int c = 0; c < 3; c++) out[c].swap(next[c]);
+        variance.swap(next_variance);
+    }
+}
+
+void Denoiser::Apply(const FeatureBuffers& features, const Options& options, Image& image) {
+    std::vector<float> color[3];
+    Denoise(features, options, color);
+
+    const int w = std::min(features.GetWidth(), image.GetXsize());
+    const int h = std::min(features.GetHeight(), image.GetYsize());
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            const size_t i = static_cast<size_t>(y) * features.GetWidth() + x;
+            image.SetPixel(x, y, std::sqrt(std::max(color[0][i], 0.0f)) * 255.99,
+                           std::sqrt(std::max(color[1][i], 0.0f)) * 255.99,
+                           std::sqrt(std::max(color[2][i], 0.0f)) * 255.99);
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/*
+    ExrWriter.cpp
+    Header attributes, offset table and scanline blocks of an OpenEXR file
+*/
+
+#include "../hpp/ExrWriter.hpp"
+#include "../hpp/Trace.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// the format is little-endian whatever the host
+void PutU8(std::string& out, uint8_t v) { out.push_back(static_cast<char>(v)); }
+
+void PutU32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+void PutU64(std::string& out, uint64_t v) {
+    for (int i = 0; i < 8; i++) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+void PutFloat(std::string& out, float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    PutU32(out, bits);
+}
+
+void PutString(std::string& out, const std::string& s) {
+    out += s;
+    out.push_back('\0');
+}
+
+void BeginAttribute(std::string& out, const char* name, const char* type, uint32_t size) {
+    PutString(out, name);
+    PutString(out, type);
+    PutU32(out, size);
+}
+
+void PutBox(std::string& out, const char* name, int width, int height) {
+    BeginAttribute(out, name, "box2i", 16);
+    PutU32(out, 0);
+    PutU32(out, 0);
+    PutU32(out, static_cast<uint32_t>(width - 1));
+    PutU32(out, static_cast<uint32_t>(height - 1));
+}
+
+bool IsLittleEndian() {
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+} // namespace
+
+bool ExrWriter::Write(const std::string& filename, int width, int height, std::vector<Channel> channels) {
+    TraceScope trace("save exr", "io");
+    if (width <= 0 || height <= 0 || channels.empty()) {
+        std::cerr << "ExrWriter: nothing to write to " << filename << std::endl;
+        return false;
+    }
+    std::sort(channels.begin(), channels.end(), [](const Channel& a, const Channel& b) { return a.name < b.name; });
+
+    std::string header;
+    PutU32(header, 20000630);   // magic number
+    PutU32(header, 2);          // version 2, single-part scanline
+
+    uint32_t list_size = 1;
+    for (const Channel& c : channels) list_size += static_cast<uint32_t>(c.name.size() + 1 + 16);
+    BeginAttribute(header, "channels", "chlist", list_size);
+    for (const Channel& c : channels) {
+        PutString(header, c.name);
+        PutU32(header, static_cast<uint32_t>(c.type));
+        PutU8(header, 0);       // pLinear
+        PutU8(header, 0);       // reserved
+        PutU8(header, 0);
+        PutU8(header, 0);
+        PutU32(header, 1);      // x / y sampling
+        PutU32(header, 1);
+    }
+    PutU8(header, 0);
+
+    BeginAttribute(header, "compression", "compression", 1);
+    PutU8(header, 0);           // NO_COMPRESSION
+    PutBox(header, "dataWindow", width, height);
+    PutBox(header, "displayWindow", width, height);
+    BeginAttribute(header, "lineOrder", "lineOrder", 1);
+    PutU8(header, 0);           // INCREASING_Y
+    BeginAttribute(header, "pixelAspectRatio", "float", 4);
+    PutFloat(header, 1.0f);
+    BeginAttribute(header, "screenWindowCenter", "v2f", 8);
+    PutFloat(header, 0.0f);
+    PutFloat(header, 0.0f);
+    BeginAttribute(header, "screenWindowWidth", "float", 4);
+    PutFloat(header, 1.0f);
+    PutU8(header, 0);           // end of header
+
+    // one block per scanline: y, byte count, then the row of each channel in turn
+    size_t row_bytes = 0;
+    for (const Channel& c : channels) row_bytes += PixelSize(c.type) * width;
+    const uint64_t block_size = 8 + row_bytes;
+    const uint64_t first_block = header.size() + 8 * static_cast<uint64_t>(height);
+    for (int y = 0; y < height; y++) PutU64(header, first_block + y * block_size);
+
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        std::cerr << "ExrWriter: cannot open " << filename << std::endl;
+        return false;
+    }
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    const bool little_endian = IsLittleEndian();
+    std::string block;
+    block.reserve(block_size);
+    for (int y = 0; y < height; y++) {
+        block.clear();
+        PutU32(block, static_cast<uint32_t>(y));
+        PutU32(block, static_cast<uint32_t>(row_bytes));
+        for (const Channel& c : channels) {
+            const size_t size = PixelSize(c.type);
+            const char* row = static_cast<const char*>(c.data) + static_cast<size_t>(y) * width * size;
+            if (little_endian) {
+                block.append(row, size * width);
+            } else {
+                for (int x = 0; x < width; x++) {
+                    for (size_t b = size; b-- > 0;) block.push_back(row[x * size + b]);
+                }
+            }
+        }
+        out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    }
+    if (!out) {
+        std::cerr << "ExrWriter: write failed for " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,14 @@
+/*
+    FeatureBuffers.cpp
+    Storage of the per-pixel feature planes
+*/
+
+#include "../hpp/FeatureBuffers.hpp"
+
+#include <algorithm>
+
+void FeatureBuffers::Resize(int width, int height) {
+    m_width = std::max(width, 0);
+    m_height = std::max(height, 0);
+    for (auto& values : m_values) values.assign(static_cast<size_t>(m_width) * m_height, 0.0f);
+}
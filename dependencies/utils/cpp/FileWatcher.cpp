@@ -0,0 +1,105 @@
+/*
+    FileWatcher.cpp
+    inotify based file change notification
+*/
+
+#include "../hpp/FileWatcher.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+namespace {
+
+long long ModificationTime(const std::string& filename) {
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0) return 0;
+#if defined(__APPLE__)
+    return st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    return st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+}
+
+} // namespace
+
+FileWatcher::~FileWatcher() {
+    Stop();
+}
+
+void FileWatcher::Stop() {
+#if defined(__linux__)
+    if (m_fd >= 0) close(m_fd);
+#endif
+    m_fd = -1;
+    m_wd = -1;
+    m_filename.clear();
+    m_basename.clear();
+    m_pending = false;
+}
+
+bool FileWatcher::Watch(const std::string& filename) {
+    Stop();
+    m_filename = filename;
+    m_mtime = ModificationTime(filename);
+
+    size_t slash = filename.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : filename.substr(0, slash == 0 ? 1 : slash);
+    m_basename = slash == std::string::npos ? filename : filename.substr(slash + 1);
+
+#if defined(__linux__)
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd >= 0) {
+        m_wd = inotify_add_watch(m_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (m_wd < 0) {
+            close(m_fd);
+            m_fd = -1;
+        }
+    }
+#endif
+    return true;
+}
+
+bool FileWatcher::ReadEvents() {
+#if defined(__linux__)
+    if (m_fd >= 0) {
+        alignas(struct inotify_event) char buffer[4096];
+        bool relevant = false;
+        while (true) {
+            ssize_t len = read(m_fd, buffer, sizeof(buffer));
+            if (len <= 0) break;  // EAGAIN: nothing more to read
+            for (char* p = buffer; p < buffer + len;) {
+                auto* ev = reinterpret_cast<struct inotify_event*>(p);
+                if (ev->len > 0 && m_basename == ev->name) relevant = true;
+                p += sizeof(struct inotify_event) + ev->len;
+            }
+        }
+        return relevant;
+    }
+#endif
+    // polling fallback
+    long long mtime = ModificationTime(m_filename);
+    if (mtime != 0 && mtime != m_mtime) {
+        m_mtime = mtime;
+        return true;
+    }
+    return false;
+}
+
+bool FileWatcher::Poll() {
+    if (m_filename.empty()) return false;
+
+    auto now = std::chrono::steady_clock::now();
+    if (ReadEvents()) {
+        m_pending = true;
+        m_lastEvent = now;
+    }
+    if (m_pending && now - m_lastEvent >= m_debounce) {
+        m_pending = false;
+        return true;
+    }
+    return false;
+}
@@ -1,13 +1,18 @@
 #include "../hpp/Image.hpp"
 #include <fstream>
 #include <vector> 
-#include <cstring> // Pour memset
+#include <algorithm>
+#include "../hpp/Trace.hpp"
+#include "../hpp/ImageWriter.hpp"
 
 // The default constructor.
 Image::Image()
 {
     m_xSize = 0;
     m_ySize = 0;
+    m_tilesX = 0;
+    m_tilesY = 0;
+    m_pRenderer = NULL;
     m_pTexture = NULL;
 }
 
@@ -18,95 +23,122 @@ Image::~Image()
         SDL_DestroyTexture(m_pTexture);
 }
 
-int Image::GetXsize(){return m_xSize; }; 
-int Image::GetYsize(){return m_ySize ;};
+int Image::GetXsize() const {return m_xSize; }; 
+int Image::GetYsize() const {return m_ySize ;};
 
 // Function to initialize.
 void Image::Initialize(const int xSize, const int ySize, SDL_Renderer* pRenderer)
 {
-    // Resize image data arrays.
-    m_rChannel.resize(xSize, std::vector<double>(ySize, 0));
-    m_gChannel.resize(xSize, std::vector<double>(ySize, 0));
-    m_bChannel.resize(xSize, std::vector<double>(ySize, 0));
+    // Resize image data array.
+    m_pixels.assign(static_cast<size_t>(xSize) * ySize * 3, 0.0);
     
     // Store the dimensions.
     m_xSize = xSize;
     m_ySize = ySize;
     
+    // Everything has to be uploaded once.
+    m_tilesX = (xSize + kTileSize - 1) / kTileSize;
+    m_tilesY = (ySize + kTileSize - 1) / kTileSize;
+    m_dirtyTiles.reset(new std::atomic<unsigned char>[static_cast<size_t>(m_tilesX) * m_tilesY]);
+    for (int t = 0; t < m_tilesX * m_tilesY; ++t)
+        m_dirtyTiles[t].store(1, std::memory_order_relaxed);
+    
     // Store the pointer to the renderer.
     m_pRenderer = pRenderer;
     
-    // Initialise the texture.
-    InitTexture();  
+    // Initialise the texture (headless images, e.g. benchmarks, have no renderer).
+    if (m_pRenderer != NULL)
+        InitTexture();  
 }
 
 // Function to set pixels.
 void Image::SetPixel(const int x, const int y, const double red, const double green, const double blue)
 {
-    m_rChannel.at(x).at(y) = red;
-    m_gChannel.at(x).at(y) = green;
-    m_bChannel.at(x).at(y) = blue;
+    double* pixel = &m_pixels[(static_cast<size_t>(y) * m_xSize + x) * 3];
+    pixel[0] = red;
+    pixel[1] = green;
+    pixel[2] = blue;
+    
+    // release after the pixel: a Display that clears the flag sees this value, or the flag stays set
+    m_dirtyTiles[(y / kTileSize) * m_tilesX + x / kTileSize].store(1, std::memory_order_release);
 }
 
 // Function to generate the display.
 void Image::Display()
 {
-    // Allocate memory for a pixel buffer.
-    Uint32 *tempPixels = new Uint32[m_xSize * m_ySize];
-    
-    // Clear the pixel buffer.
-    memset(tempPixels, 0, m_xSize * m_ySize * sizeof(Uint32));
-    
-    for (int x=0; x<m_xSize; ++x)
+    if (m_pTexture == NULL)
+        return;
+
+    // Upload the changed tiles, one locked span per tile row; nothing to convert when the image is unchanged.
+    for (int ty=0; ty<m_tilesY; ++ty)
     {
-        for (int y=0; y<m_ySize; ++y)
+        int first = -1, last = -1;
+        for (int tx=0; tx<m_tilesX; ++tx)
         {
-            tempPixels[(y*m_xSize)+x] = ConvertColor(m_rChannel.at(x).at(y), m_gChannel.at(x).at(y), m_bChannel.at(x).at(y));
+            if (m_dirtyTiles[ty*m_tilesX + tx].exchange(0, std::memory_order_acquire))
+            {
+                if (first < 0) first = tx;
+                last = tx;
+            }
         }
+        if (first >= 0)
+            UploadTiles(ty, first, last + 1);
     }
     
-    // Update the texture with the pixel buffer.
-    SDL_UpdateTexture(m_pTexture, NULL, tempPixels, m_xSize * sizeof(Uint32));  
-    
-    // Destroy the pixel buffer.
-    delete[] tempPixels;
+    // Copy the texture to the renderer, at the image size.
+    SDL_Rect bounds;
+    bounds.x = 0;
+    bounds.y = 0;
+    bounds.w = m_xSize;
+    bounds.h = m_ySize;
+    SDL_RenderCopy(m_pRenderer, m_pTexture, NULL, &bounds); 
+}
+
+// Function to convert a span of tiles into the texture.
+void Image::UploadTiles(const int ty, const int tx0, const int tx1)
+{
+    TraceScope trace("display conversion", "display");
+    SDL_Rect rect;
+    rect.x = tx0 * kTileSize;
+    rect.y = ty * kTileSize;
+    rect.w = std::min(tx1 * kTileSize, m_xSize) - rect.x;
+    rect.h = std::min(rect.y + kTileSize, m_ySize) - rect.y;
     
-    // Copy the texture to the renderer.
-    SDL_Rect srcRect, bounds;
-    srcRect.x = 0;
-    srcRect.y = 0;
-    srcRect.w = 1280;
-    srcRect.h = 720;
-    bounds = srcRect;
-    SDL_RenderCopy(m_pRenderer, m_pTexture, &srcRect, &bounds); 
+    // Write-only: every pixel of the locked rect is converted again.
+    void *texturePixels;
+    int pitch;
+    if (SDL_LockTexture(m_pTexture, &rect, &texturePixels, &pitch) != 0)
+        return;
+    for (int y=0; y<rect.h; ++y)
+    {
+        Uint32 *row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(texturePixels) + static_cast<size_t>(y) * pitch);
+        const double* pixel = &m_pixels[(static_cast<size_t>(rect.y + y) * m_xSize + rect.x) * 3];
+        for (int x=0; x<rect.w; ++x, pixel += 3)
+            row[x] = ConvertColor(pixel[0], pixel[1], pixel[2]);
+    }
+    SDL_UnlockTexture(m_pTexture);
 }
 
 // Function to return the image as an SDL2 texture.
 void Image::InitTexture()
 {
-    // Initialise the texture.
-    Uint32 rmask, gmask, bmask, amask;
+    // Streaming texture in the layout ConvertColor produces (bytes B, G, R, A in memory).
+    Uint32 format;
     
     #if SDL_BYTEORDER == SDL_BIG_ENDIAN
-    rmask = 0xff000000;
-    gmask = 0x00ff0000;
-    bmask = 0x0000ff00;
-    amask = 0x000000ff;
+    format = SDL_PIXELFORMAT_BGRA8888;
     #else
-    rmask = 0x000000ff;
-    gmask = 0x0000ff00;
-    bmask = 0x00ff0000;
-    amask = 0xff000000;
+    format = SDL_PIXELFORMAT_ARGB8888;
     #endif
     
     // Delete any previously created texture before we create a new one.
     if (m_pTexture != NULL)
         SDL_DestroyTexture(m_pTexture);
     
-    // Create the texture that will store the image.
-    SDL_Surface *tempSurface = SDL_CreateRGBSurface(0, m_xSize, m_ySize, 32, rmask, gmask, bmask, amask);
-    m_pTexture = SDL_CreateTextureFromSurface(m_pRenderer, tempSurface);
-    SDL_FreeSurface(tempSurface);   
+    // Create the texture that will store the image, filled by the next Display.
+    m_pTexture = SDL_CreateTexture(m_pRenderer, format, SDL_TEXTUREACCESS_STREAMING, m_xSize, m_ySize);
+    for (int t = 0; t < m_tilesX * m_tilesY; ++t)
+        m_dirtyTiles[t].store(1, std::memory_order_relaxed);
 }
 
 // Function to convert color to Uint32
@@ -127,14 +159,10 @@ Uint32 Image::ConvertColor(const double red, const double green, const double bl
 }
 
 void Image::SavePPM(const std::string& filename) {
-    std::ofstream out(filename);
-    out << "P3\n" << m_xSize << " " << m_ySize << "\n255\n";
-    for (int y = 0; y < m_ySize; ++y) {
-        for (int x = 0; x < m_xSize; ++x) {
-            out << static_cast<int>(m_rChannel[x][y]) << " "
-                << static_cast<int>(m_gChannel[x][y]) << " "
-                << static_cast<int>(m_bChannel[x][y]) << "\n";
-        }
-    }
-    out.close();
+    ImageWriter::WritePPM(ImageWriter::Capture(*this), filename);
+}
+
+void Image::CopyPixels(std::vector<float>& rgb) const {
+    rgb.resize(m_pixels.size());
+    for (size_t i = 0; i < m_pixels.size(); ++i) rgb[i] = static_cast<float>(m_pixels[i]);
 }
\ No newline at end of file
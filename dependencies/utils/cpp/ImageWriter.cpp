@@ -0,0 +1,288 @@
+/*
+    ImageWriter.cpp
+    Encoders of the binary image formats
+    PNG: rows filtered in parallel, then deflated in independent chunks whose raw streams
+    are concatenated (each chunk primed with the 32 KiB before it, as pigz does)
+*/
+
+#include "../hpp/ImageWriter.hpp"
+#include "../hpp/ExrWriter.hpp"
+#include "../hpp/Half.hpp"
+#include "../hpp/Trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <zlib.h>
+
+namespace {
+
+const char* const kFormatNames[kImageFormats] = {"ppm", "png", "exr", "exr-float"};
+const char* const kExtensions[kImageFormats] = {".ppm", ".png", ".exr", ".exr"};
+
+// same clamp as Image::ConvertColor
+unsigned char ToByte(float value) {
+    return static_cast<unsigned char>(std::min(255.0f, std::max(0.0f, value)));
+}
+
+bool WriteFile(const std::string& filename, const std::string& header, const unsigned char* data, size_t size) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        std::cerr << "ImageWriter: cannot open " << filename << std::endl;
+        return false;
+    }
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    if (!out) {
+        std::cerr << "ImageWriter: write failed for " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void PutU32BE(std::string& out, uint32_t v) {
+    for (int i = 3; i >= 0; i--) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+void PutChunk(std::string& out, const char* type, const unsigned char* data, size_t size) {
+    PutU32BE(out, static_cast<uint32_t>(size));
+    size_t start = out.size();
+    out.append(type, 4);
+    out.append(reinterpret_cast<const char*>(data), size);
+    uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(out.data() + start), static_cast<uInt>(size + 4));
+    PutU32BE(out, static_cast<uint32_t>(crc));
+}
+
+// branchless so that the row loop vectorizes
+inline int Paeth(int a, int b, int c) {
+    int pa = std::abs(b - c), pb = std::abs(a - c), pc = std::abs(a + b - 2 * c);
+    int bc = pb <= pc ? b : c;
+    return (pa <= pb && pa <= pc) ? a : bc;
+}
+
+// one row through one of the five PNG filters (none, sub, up, average, paeth);
+// above is a row of zeros for the first one
+// the first pixel has no left neighbour (a = c = 0), the loops start after it
+void ApplyFilter(int filter, const unsigned char* row, const unsigned char* above, int bytes, unsigned char* out) {
+    const int bpp = 3;
+    const int head = std::min(bpp, bytes);
+    switch (filter) {
+        case 1:
+            std::copy(row, row + head, out);
+            for (int i = bpp; i < bytes; i++) out[i] = static_cast<unsigned char>(row[i] - row[i - bpp]);
+            break;
+        case 2:
+            for (int i = 0; i < bytes; i++) out[i] = static_cast<unsigned char>(row[i] - above[i]);
+            break;
+        case 3:
+            for (int i = 0; i < head; i++) out[i] = static_cast<unsigned char>(row[i] - (above[i] >> 1));
+            for (int i = bpp; i < bytes; i++) out[i] = static_cast<unsigned char>(row[i] - ((row[i - bpp] + above[i]) >> 1));
+            break;
+        case 4:
+            for (int i = 0; i < head; i++) out[i] = static_cast<unsigned char>(row[i] - above[i]);
+            for (int i = bpp; i < bytes; i++) {
+                out[i] = static_cast<unsigned char>(row[i] - Paeth(row[i - bpp], above[i], above[i - bpp]));
+            }
+            break;
+        default:
+            std::copy(row, row + bytes, out);
+            break;
+    }
+}
+
+// filter type + filtered bytes of one row; picks the filter with the smallest sum of
+// absolute (signed) values, the usual heuristic. scratch holds bytes values
+void FilterRow(const unsigned char* row, const unsigned char* above, int bytes, unsigned char* scratch, unsigned char* out) {
+    int best = 0;
+    long best_sum = -1;
+    for (int filter = 0; filter < 5; filter++) {
+        ApplyFilter(filter, row, above, bytes, scratch);
+        long sum = 0;
+        for (int i = 0; i < bytes; i++) sum += std::abs(static_cast<int>(static_cast<signed char>(scratch[i])));
+        if (best_sum < 0 || sum < best_sum) {
+            best_sum = sum;
+            best = filter;
+            std::copy(scratch, scratch + bytes, out + 1);
+        }
+    }
+    out[0] = static_cast<unsigned char>(best);
+}
+
+// raw deflate of data[begin, end), primed with up to 32 KiB of the data before begin;
+// every chunk but the last ends on a byte boundary (sync flush) so the streams concatenate
+bool DeflateChunk(const unsigned char* data, size_t begin, size_t end, bool last, int level, std::string& out) {
+    z_stream stream = {};
+    if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+    if (begin > 0) {
+        size_t window = std::min<size_t>(begin, 32768);
+        deflateSetDictionary(&stream, data + begin - window, static_cast<uInt>(window));
+    }
+    out.resize(deflateBound(&stream, static_cast<uLong>(end - begin)) + 16);
+    stream.next_in = const_cast<Bytef*>(data + begin);
+    stream.avail_in = static_cast<uInt>(end - begin);
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+    int status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    bool ok = last ? status == Z_STREAM_END : status == Z_OK;
+    out.resize(out.size() - stream.avail_out);
+    deflateEnd(&stream);
+    return ok && stream.avail_in == 0;
+}
+
+} // namespace
+
+ImageWriter::Frame ImageWriter::Capture(const Image& image) {
+    Frame frame;
+    frame.width = image.GetXsize();
+    frame.height = image.GetYsize();
+    image.CopyPixels(frame.rgb);
+    return frame;
+}
+
+bool ImageWriter::Write(const Frame& frame, const std::string& filename, ImageFormat format) {
+    if (frame.width <= 0 || frame.height <= 0) {
+        std::cerr << "ImageWriter: empty image, " << filename << " not written" << std::endl;
+        return false;
+    }
+    switch (format) {
+        case ImageFormat::PNG: return WritePNG(frame, filename);
+        case ImageFormat::EXRHalf: return WriteEXR(frame, filename, true);
+        case ImageFormat::EXRFloat: return WriteEXR(frame, filename, false);
+        default: return WritePPM(frame, filename);
+    }
+}
+
+std::future<bool> ImageWriter::WriteAsync(const Image& image, const std::string& filename, ImageFormat format) {
+    Frame frame = Capture(image);
+    return std::async(std::launch::async, [frame = std::move(frame), filename, format]() {
+        if (Trace::Enabled()) Trace::SetThreadName("image writer");
+        return Write(frame, filename, format);
+    });
+}
+
+bool ImageWriter::WritePPM(const Frame& frame, const std::string& filename) {
+    TraceScope trace("save ppm", "io");
+    std::vector<unsigned char> bytes(frame.rgb.size());
+    for (size_t i = 0; i < bytes.size(); i++) bytes[i] = ToByte(frame.rgb[i]);
+    std::string header = "P6\n" + std::to_string(frame.width) + " " + std::to_string(frame.height) + "\n255\n";
+    return WriteFile(filename, header, bytes.data(), bytes.size());
+}
+
+bool ImageWriter::WritePNG(const Frame& frame, const std::string& filename, int level) {
+    TraceScope trace("save png", "io");
+    const int width = frame.width, height = frame.height;
+    const int row_bytes = 3 * width;
+    const size_t stride = static_cast<size_t>(row_bytes) + 1;
+
+    std::vector<unsigned char> pixels(frame.rgb.size());
+    for (size_t i = 0; i < pixels.size(); i++) pixels[i] = ToByte(frame.rgb[i]);
+
+    // filtering only reads the unfiltered row above, rows are independent
+    std::vector<unsigned char> filtered(stride * height);
+    const std::vector<unsigned char> zeros(row_bytes, 0);
+    #pragma omp parallel
+    {
+        std::vector<unsigned char> scratch(row_bytes);
+        #pragma omp for schedule(static)
+        for (int y = 0; y < height; y++) {
+            const unsigned char* row = pixels.data() + static_cast<size_t>(y) * row_bytes;
+            FilterRow(row, y > 0 ? row - row_bytes : zeros.data(), row_bytes, scratch.data(), filtered.data() + y * stride);
+        }
+    }
+
+    // ~256 KiB chunks: large enough for the ratio, small enough to keep every thread busy
+    const size_t total = filtered.size();
+    const size_t chunk_size = std::max<size_t>(stride, (static_cast<size_t>(256 * 1024) / stride) * stride);
+    const int chunks = static_cast<int>((total + chunk_size - 1) / chunk_size);
+    std::vector<std::string> compressed(chunks);
+    bool ok = true;
+    #pragma omp parallel for schedule(dynamic, 1) reduction(&& : ok)
+    for (int k = 0; k < chunks; k++) {
+        const size_t begin = k * chunk_size;
+        const size_t end = std::min(total, begin + chunk_size);
+        ok = DeflateChunk(filtered.data(), begin, end, k == chunks - 1, level, compressed[k]) && ok;
+    }
+    if (!ok) {
+        std::cerr << "ImageWriter: deflate failed for " << filename << std::endl;
+        return false;
+    }
+
+    // zlib stream: header, the concatenated raw streams, adler32 of the filtered data
+    std::string idat = "\x78\x9c";
+    for (const std::string& part : compressed) idat += part;
+    uLong adler = adler32(0L, Z_NULL, 0);
+    for (size_t offset = 0; offset < total; offset += 1u << 30) {
+        uInt length = static_cast<uInt>(std::min<size_t>(total - offset, 1u << 30));
+        adler = adler32(adler, filtered.data() + offset, length);
+    }
+    PutU32BE(idat, static_cast<uint32_t>(adler));
+
+    std::string png = "\x89PNG\r\n\x1a\n";
+    std::string ihdr;
+    PutU32BE(ihdr, static_cast<uint32_t>(width));
+    PutU32BE(ihdr, static_cast<uint32_t>(height));
+    ihdr += std::string("\x08\x02\x00\x00\x00", 5);   // 8-bit RGB, deflate, adaptive filters, no interlace
+    PutChunk(png, "IHDR", reinterpret_cast<const unsigned char*>(ihdr.data()), ihdr.size());
+    PutChunk(png, "IDAT", reinterpret_cast<const unsigned char*>(idat.data()), idat.size());
+    PutChunk(png, "IEND", nullptr, 0);
+    return WriteFile(filename, png, nullptr, 0);
+}
+
+bool ImageWriter::WriteEXR(const Frame& frame, const std::string& filename, bool half) {
+    const size_t count = static_cast<size_t>(frame.width) * frame.height;
+    // undo the display encoding: value = 255.99 * sqrt(linear)
+    auto linear = [&](size_t i, int c) {
+        float v = std::max(0.0f, frame.rgb[3 * i + c] / 255.99f);
+        return v * v;
+    };
+    std::vector<uint16_t> half_planes[3];
+    std::vector<float> float_planes[3];
+    std::vector<ExrWriter::Channel> channels;
+    const char* names[3] = {"R", "G", "B"};
+    for (int c = 0; c < 3; c++) {
+        if (half) {
+            half_planes[c].resize(count);
+            for (size_t i = 0; i < count; i++) half_planes[c][i] = Half::FromFloat(linear(i, c));
+            channels.push_back({names[c], ExrWriter::PixelType::Half, half_planes[c].data()});
+        } else {
+            float_planes[c].resize(count);
+            for (size_t i = 0; i < count; i++) float_planes[c][i] = linear(i, c);
+            channels.push_back({names[c], ExrWriter::PixelType::Float, float_planes[c].data()});
+        }
+    }
+    return ExrWriter::Write(filename, frame.width, frame.height, std::move(channels));
+}
+
+const char* ImageWriter::FormatName(ImageFormat format) {
+    int index = static_cast<int>(format);
+    return index >= 0 && index < kImageFormats ? kFormatNames[index] : "unknown";
+}
+
+const char* ImageWriter::Extension(ImageFormat format) {
+    int index = static_cast<int>(format);
+    return index >= 0 && index < kImageFormats ? kExtensions[index] : "";
+}
+
+bool ImageWriter::ParseFormat(const std::string& name, ImageFormat& format) {
+    for (int i = 0; i < kImageFormats; i++) {
+        if (name == kFormatNames[i]) {
+            format = static_cast<ImageFormat>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ImageWriter::FormatFromFilename(const std::string& filename, ImageFormat& format) {
+    for (int i = 0; i < kImageFormats; i++) {
+        const std::string extension = kExtensions[i];
+        if (filename.size() > extension.size() && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0) {
+            format = static_cast<ImageFormat>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,146 @@
+/*
+    LocalSocket.cpp
+    Socket setup and message framing
+*/
+
+#include "../hpp/LocalSocket.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// payloads are tiles at most, anything larger is a broken stream
+constexpr uint32_t kMaxPayload = 1u << 30;
+
+// a non-blocking peer that can't take any of a message for this long is given up
+constexpr int kSendTimeoutMs = 5000;
+
+bool Address(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "LocalSocket: path too long " << path << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+bool SendAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd out = {fd, POLLOUT, 0};
+            if (poll(&out, 1, kSendTimeoutMs) <= 0) return false;
+            continue;
+        }
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool ReceiveAll(int fd, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+int LocalSocket::Listen(const std::string& path) {
+    sockaddr_un address;
+    if (!Address(path, address)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        std::cerr << "LocalSocket: cannot listen on " << path << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int LocalSocket::Connect(const std::string& path) {
+    sockaddr_un address;
+    if (!Address(path, address)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "LocalSocket: cannot connect to " << path << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int LocalSocket::Accept(int listen_fd) {
+    return accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+}
+
+void LocalSocket::Close(int fd) {
+    if (fd >= 0) close(fd);
+}
+
+bool LocalSocket::Send(int fd, uint32_t type, const void* data, size_t size) {
+    const uint32_t header[2] = {type, static_cast<uint32_t>(size)};
+    return size <= kMaxPayload && SendAll(fd, header, sizeof(header)) && SendAll(fd, data, size);
+}
+
+bool LocalSocket::Receive(int fd, Message& message) {
+    uint32_t header[2];
+    if (!ReceiveAll(fd, header, sizeof(header)) || header[1] > kMaxPayload) return false;
+    message.type = header[0];
+    message.payload.resize(header[1]);
+    return ReceiveAll(fd, &message.payload[0], message.payload.size());
+}
+
+bool LocalSocket::SetNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool LocalSocket::ReceiveAvailable(int fd, std::string& buffer) {
+    char chunk[1 << 16];
+    for (;;) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            buffer.append(chunk, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n < 0 && errno == EINTR) continue;
+        return false;
+    }
+}
+
+bool LocalSocket::Extract(std::string& buffer, Message& message, bool& broken) {
+    broken = false;
+    uint32_t header[2];
+    if (buffer.size() < sizeof(header)) return false;
+    buffer.copy(reinterpret_cast<char*>(header), sizeof(header));
+    if (header[1] > kMaxPayload) {
+        broken = true;
+        return false;
+    }
+    if (buffer.size() < sizeof(header) + header[1]) return false;
+    message.type = header[0];
+    message.payload.assign(buffer, sizeof(header), header[1]);
+    buffer.erase(0, sizeof(header) + header[1]);
+    return true;
+}
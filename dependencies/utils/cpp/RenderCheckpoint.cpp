@@ -0,0 +1,159 @@
+/*
+    RenderCheckpoint.cpp
+    Checkpoint file layout, atomic save and scene fingerprint
+*/
+
+#include "../hpp/RenderCheckpoint.hpp"
+#include "../hpp/Trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+namespace {
+
+// magic, then the settings, then one uint32 count and three double sums per pixel
+// (native endianness: a checkpoint resumes on the machine type that wrote it)
+const char kMagic[8] = {'R', 'T', 'C', 'K', 'P', 'T', '0', '1'};
+
+struct FileHeader {
+    char magic[8];
+    int32_t width, height;
+    int32_t samples_per_pixel;
+    int32_t max_depth;
+    uint32_t sampler;
+    uint32_t seed;
+    uint64_t scene;
+};
+
+bool WriteAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+uint64_t RenderCheckpoint::Fingerprint(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) return 0;
+    uint64_t hash = 14695981039346656037ull;
+    std::vector<char> buffer(1 << 20);
+    while (in) {
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        const std::streamsize n = in.gcount();
+        for (std::streamsize i = 0; i < n; i++) {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+void RenderCheckpoint::Reset(const Settings& settings) {
+    m_settings = settings;
+    const size_t size = static_cast<size_t>(std::max(settings.width, 0)) * std::max(settings.height, 0);
+    m_counts.assign(size, 0);
+    m_sums.assign(size * 3, 0.0);
+}
+
+uint64_t RenderCheckpoint::TotalSamples() const {
+    uint64_t total = 0;
+    for (uint32_t count : m_counts) total += count;
+    return total;
+}
+
+bool RenderCheckpoint::Complete() const {
+    const uint32_t target = static_cast<uint32_t>(m_settings.samples_per_pixel);
+    return std::all_of(m_counts.begin(), m_counts.end(), [target](uint32_t count) { return count >= target; });
+}
+
+ImageWriter::Frame RenderCheckpoint::Resolve() const {
+    ImageWriter::Frame frame;
+    frame.width = m_settings.width;
+    frame.height = m_settings.height;
+    frame.rgb.resize(m_sums.size());
+    for (size_t i = 0; i < m_counts.size(); i++) {
+        const double n = m_counts[i] > 0 ? m_counts[i] : 1.0;
+        for (int c = 0; c < 3; c++) frame.rgb[i * 3 + c] = static_cast<float>(std::sqrt(m_sums[i * 3 + c] / n) * 255.99);
+    }
+    return frame;
+}
+
+bool RenderCheckpoint::Save(const std::string& filename) const {
+    TraceScope trace("save checkpoint", "io");
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.width = m_settings.width;
+    header.height = m_settings.height;
+    header.samples_per_pixel = m_settings.samples_per_pixel;
+    header.max_depth = m_settings.max_depth;
+    header.sampler = m_settings.sampler;
+    header.seed = m_settings.seed;
+    header.scene = m_settings.scene;
+
+    const std::string temp = filename + ".tmp";
+    int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "RenderCheckpoint: cannot create " << temp << std::endl;
+        return false;
+    }
+    bool ok = WriteAll(fd, &header, sizeof(header)) &&
+              WriteAll(fd, m_counts.data(), m_counts.size() * sizeof(uint32_t)) &&
+              WriteAll(fd, m_sums.data(), m_sums.size() * sizeof(double)) &&
+              fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    ok = ok && std::rename(temp.c_str(), filename.c_str()) == 0;
+    if (!ok) {
+        std::cerr << "RenderCheckpoint: cannot write " << filename << std::endl;
+        std::remove(temp.c_str());
+    }
+    return ok;
+}
+
+bool RenderCheckpoint::Load(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    FileHeader header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.width <= 0 || header.height <= 0) {
+        return false;
+    }
+    // the size must match the header before anything is allocated from it
+    // (a corrupt width/height would otherwise ask for gigabytes)
+    const uint64_t pixels = static_cast<uint64_t>(header.width) * static_cast<uint64_t>(header.height);
+    const uint64_t per_pixel = sizeof(uint32_t) + 3 * sizeof(double);
+    if (pixels > (UINT64_MAX - sizeof(FileHeader)) / per_pixel) return false;
+    const uint64_t expected = sizeof(FileHeader) + pixels * per_pixel;
+    in.seekg(0, std::ios::end);
+    const std::streamoff actual = in.tellg();
+    if (actual < 0 || static_cast<uint64_t>(actual) != expected) return false;
+    in.seekg(static_cast<std::streamoff>(sizeof(FileHeader)), std::ios::beg);
+
+    Settings settings;
+    settings.width = header.width;
+    settings.height = header.height;
+    settings.samples_per_pixel = header.samples_per_pixel;
+    settings.max_depth = header.max_depth;
+    settings.sampler = header.sampler;
+    settings.seed = header.seed;
+    settings.scene = header.scene;
+    Reset(settings);
+
+    in.read(reinterpret_cast<char*>(m_counts.data()), static_cast<std::streamsize>(m_counts.size() * sizeof(uint32_t)));
+    in.read(reinterpret_cast<char*>(m_sums.data()), static_cast<std::streamsize>(m_sums.size() * sizeof(double)));
+    if (!in || in.peek() != std::char_traits<char>::eof()) {
+        Reset(Settings());
+        return false;
+    }
+    return true;
+}
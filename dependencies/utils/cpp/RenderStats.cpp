@@ -0,0 +1,130 @@
+/*
+    RenderStats.cpp
+    Per-thread counter blocks, snapshots and console report of the render counters
+*/
+
+#include "../hpp/RenderStats.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct alignas(64) Block {
+    RenderCounters counters;
+};
+
+// live blocks, plus what the threads that exited had counted
+struct Registry {
+    std::mutex mutex;
+    std::vector<Block*> blocks;
+    RenderCounters retired;
+};
+
+// never destroyed: threads may still exit after static destructors ran
+Registry& GetRegistry() {
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+// owned by its thread, destroyed when the thread exits
+struct BlockOwner {
+    Block* block = new Block();
+
+    BlockOwner() {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.blocks.push_back(block);
+    }
+    ~BlockOwner() {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.retired += block->counters;
+        registry.blocks.erase(std::find(registry.blocks.begin(), registry.blocks.end(), block));
+        delete block;
+    }
+};
+
+} // namespace
+
+RenderCounters& RenderCounters::operator+=(const RenderCounters& other) {
+    primary_rays += other.primary_rays;
+    bounce_rays += other.bounce_rays;
+    shadow_rays += other.shadow_rays;
+    bvh_nodes += other.bvh_nodes;
+    aabb_tests += other.aabb_tests;
+    for (int k = 0; k < kPrimitiveKinds; k++) primitive_tests[k] += other.primitive_tests[k];
+    hits += other.hits;
+    shadow_cache_lookups += other.shadow_cache_lookups;
+    shadow_cache_hits += other.shadow_cache_hits;
+    return *this;
+}
+
+RenderCounters& RenderCounters::operator-=(const RenderCounters& other) {
+    primary_rays -= other.primary_rays;
+    bounce_rays -= other.bounce_rays;
+    shadow_rays -= other.shadow_rays;
+    bvh_nodes -= other.bvh_nodes;
+    aabb_tests -= other.aabb_tests;
+    for (int k = 0; k < kPrimitiveKinds; k++) primitive_tests[k] -= other.primitive_tests[k];
+    hits -= other.hits;
+    shadow_cache_lookups -= other.shadow_cache_lookups;
+    shadow_cache_hits -= other.shadow_cache_hits;
+    return *this;
+}
+
+RenderCounters* RenderStats::Register() {
+    static thread_local BlockOwner owner;
+    return &owner.block->counters;
+}
+
+RenderCounters RenderStats::Snapshot() {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    RenderCounters total = registry.retired;
+    for (const Block* block : registry.blocks) total += block->counters;
+    return total;
+}
+
+const char* RenderStats::KindName(PrimitiveKind kind) {
+    switch (kind) {
+        case PrimitiveKind::Sphere: return "sphere";
+        case PrimitiveKind::Plane: return "plane";
+        case PrimitiveKind::Triangle: return "triangle";
+        case PrimitiveKind::Cylinder: return "cylinder";
+        case PrimitiveKind::Cone: return "cone";
+        case PrimitiveKind::Parallelepiped: return "parallelepiped";
+        case PrimitiveKind::Quad: return "quad";
+        default: return "unknown";
+    }
+}
+
+void RenderStats::Print(std::ostream& out, const RenderCounters& c, double render_ms) {
+    if (!Enabled()) return;
+
+    char line[160];
+    double seconds = render_ms / 1000.0;
+    std::snprintf(line, sizeof(line), "  Rays: %llu (primary %llu, bounce %llu, shadow %llu), %.2f Mrays/s\n",
+                  (unsigned long long)c.rays(), (unsigned long long)c.primary_rays, (unsigned long long)c.bounce_rays,
+                  (unsigned long long)c.shadow_rays, seconds > 0.0 ? c.rays() / seconds * 1e-6 : 0.0);
+    out << line;
+    std::snprintf(line, sizeof(line), "  Per ray: %.2f BVH nodes, %.2f AABB tests, %.2f primitive tests, %.1f%% hits\n",
+                  c.per_ray(c.bvh_nodes), c.per_ray(c.aabb_tests), c.per_ray(c.primitive_total()), 100.0 * c.per_ray(c.hits));
+    out << line;
+
+    if (c.shadow_cache_lookups) {
+        std::snprintf(line, sizeof(line), "  Shadow cache: %.1f%% hits over %llu lookups (%.1f%% of shadow rays skip the BVH)\n",
+                      100.0 * c.shadow_cache_hits / c.shadow_cache_lookups, (unsigned long long)c.shadow_cache_lookups,
+                      c.shadow_rays ? 100.0 * c.shadow_cache_hits / c.shadow_rays : 0.0);
+        out << line;
+    }
+
+    out << "  Primitive tests:";
+    for (int k = 0; k < kPrimitiveKinds; k++) {
+        if (c.primitive_tests[k] == 0) continue;
+        out << " " << KindName(static_cast<PrimitiveKind>(k)) << " " << c.primitive_tests[k];
+    }
+    out << std::endl;
+}
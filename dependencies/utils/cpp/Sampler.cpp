@@ -0,0 +1,320 @@
+/*
+    Sampler.cpp
+    Hash-based sample generators: every value is a function of (seed, pixel, sample, dimension),
+    so the result does not depend on the thread that renders the pixel
+*/
+
+#include "../hpp/Sampler.hpp"
+#include "../hpp/Vector3.hpp"
+#include "../../libs.hpp"   // random_double() for the independent sampler
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// lowbias32 integer hash
+uint32_t Hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+uint32_t HashCombine(uint32_t seed, uint32_t value) {
+    return seed ^ (value + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+double ToUnit(uint32_t x) {
+    return x * (1.0 / 4294967296.0);
+}
+
+uint32_t ReverseBits(uint32_t x) {
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+// first two Sobol dimensions, a (0,2)-sequence: every power of two prefix is stratified in 2D
+uint32_t Sobol0(uint32_t index) {
+    return ReverseBits(index);
+}
+
+uint32_t Sobol1(uint32_t index) {
+    uint32_t result = 0;
+    for (uint32_t v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1) {
+        if (index & 1) result ^= v;
+    }
+    return result;
+}
+
+// Owen scrambling through a hash (Burley 2020, "Practical Hash-based Owen Scrambling"):
+// each bit is flipped depending on the bits above it only
+uint32_t LaineKarras(uint32_t x, uint32_t seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint32_t OwenScramble(uint32_t x, uint32_t seed) {
+    return ReverseBits(LaineKarras(ReverseBits(x), seed));
+}
+
+// random permutation of [0, length) (Kensler 2013, "Correlated Multi-Jittered Sampling")
+uint32_t Permute(uint32_t i, uint32_t length, uint32_t p) {
+    uint32_t w = length - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do {
+        i ^= p;
+        i *= 0xe170893du;
+        i ^= p >> 16;
+        i ^= (i & w) >> 4;
+        i ^= p >> 8;
+        i *= 0x0929eb3fu;
+        i ^= p >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | p >> 27;
+        i *= 0x6935fa69u;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303u;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3u;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3dfu;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= length);
+    return (i + p) % length;
+}
+
+// 64x64 tileable blue-noise ranks, built once with void-and-cluster (Ulichney 1993)
+constexpr int kMaskSize = 64;
+
+std::vector<float> BuildBlueNoiseMask() {
+    const int n = kMaskSize;
+    const int count = n * n;
+    const double sigma = 1.5;
+
+    // toroidal gaussian filter, indexed by the offset between two texels
+    std::vector<double> kernel(count);
+    for (int dy = 0; dy < n; dy++) {
+        for (int dx = 0; dx < n; dx++) {
+            int wx = std::min(dx, n - dx), wy = std::min(dy, n - dy);
+            kernel[dy * n + dx] = std::exp(-(wx * wx + wy * wy) / (2 * sigma * sigma));
+        }
+    }
+
+    std::vector<char> bits(count, 0);
+    std::vector<double> energy(count, 0.0);
+    auto toggle = [&](int p, bool on) {
+        bits[p] = on;
+        const double sign = on ? 1.0 : -1.0;
+        const int px = p % n, py = p / n;
+        for (int qy = 0; qy < n; qy++) {
+            const int row = ((qy - py + n) % n) * n;
+            for (int qx = 0; qx < n; qx++) energy[qy * n + qx] += sign * kernel[row + (qx - px + n) % n];
+        }
+    };
+    auto tightest_cluster = [&] {
+        int best = -1;
+        for (int p = 0; p < count; p++) {
+            if (bits[p] && (best < 0 || energy[p] > energy[best])) best = p;
+        }
+        return best;
+    };
+    auto largest_void = [&] {
+        int best = -1;
+        for (int p = 0; p < count; p++) {
+            if (!bits[p] && (best < 0 || energy[p] < energy[best])) best = p;
+        }
+        return best;
+    };
+
+    // initial pattern: 10% of the texels, then moved from clusters to voids until stable
+    const int ones = count / 10;
+    for (int i = 0; i < ones; i++) {
+        int p = static_cast<int>(Hash(i + 1) % count);
+        while (bits[p]) p = (p + 1) % count;
+        toggle(p, true);
+    }
+    for (int iteration = 0; iteration < count; iteration++) {
+        int cluster = tightest_cluster();
+        toggle(cluster, false);
+        int hole = largest_void();
+        toggle(hole, true);
+        if (hole == cluster) break;
+    }
+
+    std::vector<char> initial_bits = bits;
+    std::vector<double> initial_energy = energy;
+    std::vector<int> rank(count, 0);
+
+    // ranks below the initial pattern: remove the tightest cluster first
+    for (int r = ones - 1; r >= 0; r--) {
+        int cluster = tightest_cluster();
+        toggle(cluster, false);
+        rank[cluster] = r;
+    }
+    // ranks above: fill the largest void first
+    bits = initial_bits;
+    energy = initial_energy;
+    for (int r = ones; r < count; r++) {
+        int hole = largest_void();
+        toggle(hole, true);
+        rank[hole] = r;
+    }
+
+    std::vector<float> mask(count);
+    for (int p = 0; p < count; p++) mask[p] = (rank[p] + 0.5f) / count;
+    return mask;
+}
+
+const std::vector<float>& BlueNoiseMask() {
+    static const std::vector<float> mask = BuildBlueNoiseMask();
+    return mask;
+}
+
+// white noise from the per-thread generator, as the renderers always did
+class IndependentSampler : public Sampler {
+public:
+    IndependentSampler(int samples_per_pixel, uint32_t seed) : Sampler(samples_per_pixel, seed) {}
+
+protected:
+    double Sample1D(int) override { return random_double(); }
+    void Sample2D(int, double& u, double& v) override {
+        u = random_double();
+        v = random_double();
+    }
+};
+
+// jittered strata, shuffled independently per pixel and per dimension
+class StratifiedSampler : public Sampler {
+public:
+    StratifiedSampler(int samples_per_pixel, uint32_t seed)
+        : Sampler(samples_per_pixel, seed), m_grid(static_cast<int>(std::ceil(std::sqrt(static_cast<double>(m_spp))))) {}
+
+protected:
+    double Sample1D(int dimension) override {
+        const uint32_t seed = DimensionSeed(dimension);
+        const uint32_t stratum = Permute(m_index % m_spp, m_spp, seed);
+        return (stratum + ToUnit(Hash(HashCombine(seed, m_index)))) / m_spp;
+    }
+
+    // n x n grid with n = ceil(sqrt(spp)): all cells are hit when spp is a square
+    void Sample2D(int dimension, double& u, double& v) override {
+        const uint32_t seed = DimensionSeed(dimension);
+        const uint32_t cells = m_grid * m_grid;
+        const uint32_t cell = Permute(m_index % cells, cells, seed);
+        const uint32_t jitter = Hash(HashCombine(seed, m_index));
+        u = (cell % m_grid + ToUnit(Hash(jitter))) / m_grid;
+        v = (cell / m_grid + ToUnit(Hash(jitter ^ 0x5bd1e995u))) / m_grid;
+    }
+
+private:
+    uint32_t DimensionSeed(int dimension) const {
+        return Hash(HashCombine(HashCombine(HashCombine(m_seed, m_x), m_y), dimension));
+    }
+
+    uint32_t m_grid;
+};
+
+// Owen-scrambled Sobol: each 2D pair uses the first two Sobol dimensions with its
+// own shuffle of the sample index and its own scramble, per pixel
+class SobolSampler : public Sampler {
+public:
+    SobolSampler(int samples_per_pixel, uint32_t seed) : Sampler(samples_per_pixel, seed) {}
+
+protected:
+    double Sample1D(int dimension) override {
+        const uint32_t seed = SequenceSeed(dimension);
+        const uint32_t index = OwenScramble(m_index, seed);
+        return ToUnit(OwenScramble(Sobol0(index), HashCombine(seed, 0)));
+    }
+
+    void Sample2D(int dimension, double& u, double& v) override {
+        const uint32_t seed = SequenceSeed(dimension);
+        const uint32_t index = OwenScramble(m_index, seed);
+        u = ToUnit(OwenScramble(Sobol0(index), HashCombine(seed, 0)));
+        v = ToUnit(OwenScramble(Sobol1(index), HashCombine(seed, 1)));
+    }
+
+    virtual uint32_t SequenceSeed(int dimension) const {
+        return Hash(HashCombine(HashCombine(HashCombine(m_seed, m_x), m_y), dimension));
+    }
+};
+
+// One scrambled Sobol sequence for the whole image, rotated per pixel by a blue-noise
+// value (Georgiev & Fajardo 2016): at low spp the error is pushed to high frequencies,
+// which the eye (and a denoiser) averages away
+class BlueNoiseSampler : public SobolSampler {
+public:
+    BlueNoiseSampler(int samples_per_pixel, uint32_t seed) : SobolSampler(samples_per_pixel, seed), m_mask(BlueNoiseMask()) {}
+
+protected:
+    double Sample1D(int dimension) override {
+        return Rotate(SobolSampler::Sample1D(dimension), dimension, 0);
+    }
+
+    void Sample2D(int dimension, double& u, double& v) override {
+        SobolSampler::Sample2D(dimension, u, v);
+        u = Rotate(u, dimension, 0);
+        v = Rotate(v, dimension, 1);
+    }
+
+    uint32_t SequenceSeed(int dimension) const override {
+        return Hash(HashCombine(m_seed, dimension));
+    }
+
+private:
+    // each (dimension, component) reads the mask at its own toroidal offset
+    double Rotate(double value, int dimension, uint32_t component) const {
+        const uint32_t offset = Hash(HashCombine(HashCombine(m_seed ^ 0x68bc21ebu, dimension), component));
+        const int x = (m_x + static_cast<int>(offset & 0xffff)) & (kMaskSize - 1);
+        const int y = (m_y + static_cast<int>(offset >> 16)) & (kMaskSize - 1);
+        value += m_mask[y * kMaskSize + x];
+        return value >= 1.0 ? value - 1.0 : value;
+    }
+
+    const std::vector<float>& m_mask;
+};
+
+const char* const kTypeNames[kSamplerTypes] = {"independent", "stratified", "sobol", "bluenoise"};
+
+} // namespace
+
+std::unique_ptr<Sampler> Sampler::Create(SamplerType type, int samples_per_pixel, uint32_t seed) {
+    switch (type) {
+        case SamplerType::Stratified: return std::make_unique<StratifiedSampler>(samples_per_pixel, seed);
+        case SamplerType::Sobol: return std::make_unique<SobolSampler>(samples_per_pixel, seed);
+        case SamplerType::BlueNoise: return std::make_unique<BlueNoiseSampler>(samples_per_pixel, seed);
+        default: return std::make_unique<IndependentSampler>(samples_per_pixel, seed);
+    }
+}
+
+const char* Sampler::TypeName(SamplerType type) {
+    int index = static_cast<int>(type);
+    return index >= 0 && index < kSamplerTypes ? kTypeNames[index] : "unknown";
+}
+
+bool Sampler::ParseType(const std::string& name, SamplerType& type) {
+    for (int i = 0; i < kSamplerTypes; i++) {
+        if (name == kTypeNames[i]) {
+            type = static_cast<SamplerType>(i);
+            return true;
+        }
+    }
+    return false;
+}
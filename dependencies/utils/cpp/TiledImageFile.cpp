@@ -0,0 +1,263 @@
+/*
+    TiledImageFile.cpp
+    Shared mapping of the output image, tile table and checkpoints
+*/
+
+#include "../hpp/TiledImageFile.hpp"
+#include "../hpp/Trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// tile table: magic, width, height, tile size, samples, depth, sampler, seed, scene
+// fingerprint, then one byte per tile (1 = on disk)
+const char kTableMagic[8] = {'R', 'T', 'T', 'I', 'L', 'E', 'S', '2'};
+constexpr size_t kTableHeader = sizeof(kTableMagic) + 7 * sizeof(uint32_t) + sizeof(uint64_t);
+
+// finished tiles are made durable at most this often
+constexpr double kFlushSeconds = 2.0;
+
+std::string TablePath(const std::string& filename) { return filename + ".tiles"; }
+
+std::string PpmHeader(int width, int height) {
+    return "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+}
+
+std::string TableHeader(const RenderCheckpoint::Settings& settings, int tile_size) {
+    std::string header(kTableMagic, sizeof(kTableMagic));
+    const uint32_t fields[7] = {static_cast<uint32_t>(settings.width), static_cast<uint32_t>(settings.height),
+                                static_cast<uint32_t>(tile_size), static_cast<uint32_t>(settings.samples_per_pixel),
+                                static_cast<uint32_t>(settings.max_depth), settings.sampler, settings.seed};
+    header.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+    header.append(reinterpret_cast<const char*>(&settings.scene), sizeof(settings.scene));
+    return header;
+}
+
+bool WriteAll(int fd, const void* data, size_t size, off_t offset) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = pwrite(fd, p, size, offset);
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+        offset += n;
+    }
+    return true;
+}
+
+bool ReadAll(int fd, void* data, size_t size, off_t offset) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = pread(fd, p, size, offset);
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+        offset += n;
+    }
+    return true;
+}
+
+} // namespace
+
+bool TiledImageFile::Open(const std::string& filename, const RenderCheckpoint::Settings& settings, int tile_size) {
+    Close();
+    const int width = settings.width, height = settings.height;
+    if (width <= 0 || height <= 0 || tile_size <= 0) {
+        std::cerr << "TiledImageFile: invalid size " << width << "x" << height << " (tile " << tile_size << ")" << std::endl;
+        return false;
+    }
+    m_filename = filename;
+    m_settings = settings;
+    m_width = width;
+    m_height = height;
+    m_tileSize = tile_size;
+    m_tilesX = (width + tile_size - 1) / tile_size;
+    m_tilesY = (height + tile_size - 1) / tile_size;
+    m_headerSize = PpmHeader(width, height).size();
+    m_mapSize = m_headerSize + static_cast<size_t>(width) * height * 3;
+    m_done.assign(static_cast<size_t>(m_tilesX) * m_tilesY, 0);
+
+    m_resumed = Resume(filename);
+    if (!m_resumed && !Create(filename)) {
+        Close();
+        return false;
+    }
+    if (!Map()) {
+        Close();
+        return false;
+    }
+    m_remaining = static_cast<int>(std::count(m_done.begin(), m_done.end(), 0));
+    m_unflushed = 0;
+    m_lastFlush = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool TiledImageFile::Resume(const std::string& filename) {
+    m_fd = open(filename.c_str(), O_RDWR);
+    m_tableFd = open(TablePath(filename).c_str(), O_RDWR);
+    bool ok = m_fd >= 0 && m_tableFd >= 0;
+
+    struct stat st;
+    ok = ok && fstat(m_fd, &st) == 0 && static_cast<size_t>(st.st_size) == m_mapSize;
+
+    const std::string header = PpmHeader(m_width, m_height);
+    std::string found(header.size(), '\0');
+    ok = ok && ReadAll(m_fd, &found[0], found.size(), 0) && found == header;
+
+    const std::string table_header = TableHeader(m_settings, m_tileSize);
+    std::string table(table_header.size(), '\0');
+    ok = ok && fstat(m_tableFd, &st) == 0 && static_cast<size_t>(st.st_size) == kTableHeader + m_done.size();
+    ok = ok && ReadAll(m_tableFd, &table[0], table.size(), 0);
+    if (ok && table != table_header) {
+        std::cout << TablePath(filename) << " was written for another scene or other settings, starting over" << std::endl;
+        ok = false;
+    }
+    ok = ok && ReadAll(m_tableFd, m_done.data(), m_done.size(), kTableHeader);
+
+    if (!ok) {
+        // not ours or another size: start over
+        if (m_fd >= 0) close(m_fd);
+        if (m_tableFd >= 0) close(m_tableFd);
+        m_fd = m_tableFd = -1;
+        std::fill(m_done.begin(), m_done.end(), 0);
+    }
+    return ok;
+}
+
+bool TiledImageFile::Create(const std::string& filename) {
+    // the table goes first: an image without one is never taken for a partial render
+    m_tableFd = open(TablePath(filename).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_tableFd < 0) {
+        std::cerr << "TiledImageFile: cannot create " << TablePath(filename) << std::endl;
+        return false;
+    }
+    const std::string table_header = TableHeader(m_settings, m_tileSize);
+    if (!WriteAll(m_tableFd, table_header.data(), table_header.size(), 0) ||
+        !WriteAll(m_tableFd, m_done.data(), m_done.size(), kTableHeader)) {
+        std::cerr << "TiledImageFile: cannot write " << TablePath(filename) << std::endl;
+        return false;
+    }
+
+    m_fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+        std::cerr << "TiledImageFile: cannot create " << filename << std::endl;
+        return false;
+    }
+    // sparse: blocks are only allocated as tiles are written
+    const std::string header = PpmHeader(m_width, m_height);
+    if (ftruncate(m_fd, static_cast<off_t>(m_mapSize)) != 0 || !WriteAll(m_fd, header.data(), header.size(), 0)) {
+        std::cerr << "TiledImageFile: cannot size " << filename << " to " << m_mapSize << " bytes" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TiledImageFile::Map() {
+    void* p = mmap(nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "TiledImageFile: cannot map " << m_filename << std::endl;
+        return false;
+    }
+    m_map = static_cast<unsigned char*>(p);
+    // tiles touch scattered rows, reading ahead would only bring back pages of other tiles
+    madvise(p, m_mapSize, MADV_RANDOM);
+    return true;
+}
+
+void TiledImageFile::TileRect(int tile, int& x0, int& y0, int& x1, int& y1) const {
+    x0 = (tile % m_tilesX) * m_tileSize;
+    y0 = (tile / m_tilesX) * m_tileSize;
+    x1 = std::min(x0 + m_tileSize, m_width);
+    y1 = std::min(y0 + m_tileSize, m_height);
+}
+
+bool TiledImageFile::IsTileDone(int tile) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_done[tile] != 0;
+}
+
+int TiledImageFile::RemainingTiles() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_remaining;
+}
+
+bool TiledImageFile::WriteTile(int tile, const unsigned char* rgb) {
+    if (!m_map || tile < 0 || tile >= TileCount()) return false;
+    int x0, y0, x1, y1;
+    TileRect(tile, x0, y0, x1, y1);
+
+    const size_t stride = static_cast<size_t>(m_width) * 3;
+    const size_t row = static_cast<size_t>(x1 - x0) * 3;
+    unsigned char* band = m_map + m_headerSize + static_cast<size_t>(y0) * stride;
+    for (int y = y0; y < y1; y++) std::memcpy(band + (y - y0) * stride + static_cast<size_t>(x0) * 3, rgb + (y - y0) * row, row);
+
+    // the pages stay dirty in the page cache, only this mapping lets go of them; tiles of
+    // the same band fault them back in if they are still being written
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = (m_headerSize + static_cast<size_t>(y0) * stride) / page * page;
+    const size_t end = std::min(m_headerSize + static_cast<size_t>(y1) * stride, m_mapSize);
+    madvise(m_map + begin, end - begin, MADV_DONTNEED);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_done[tile]) {
+        m_done[tile] = 1;
+        m_remaining--;
+        m_unflushed++;
+    }
+    std::chrono::duration<double> since = std::chrono::steady_clock::now() - m_lastFlush;
+    if (since.count() >= kFlushSeconds) return FlushLocked();
+    return true;
+}
+
+bool TiledImageFile::Flush() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return FlushLocked();
+}
+
+bool TiledImageFile::FlushLocked() {
+    m_lastFlush = std::chrono::steady_clock::now();
+    if (!m_map || m_unflushed == 0) return true;
+    TraceScope trace("tile checkpoint", "io");
+    trace.Arg("tiles", m_unflushed);
+
+    // a tile is only listed once its pixels are on disk
+    bool ok = msync(m_map, m_mapSize, MS_SYNC) == 0;
+    ok = ok && WriteAll(m_tableFd, m_done.data(), m_done.size(), kTableHeader) && fdatasync(m_tableFd) == 0;
+    if (!ok) {
+        std::cerr << "TiledImageFile: checkpoint of " << m_filename << " failed" << std::endl;
+        return false;
+    }
+    m_unflushed = 0;
+    return true;
+}
+
+bool TiledImageFile::Close() {
+    bool ok = true;
+    const bool mapped = m_map != nullptr;
+    if (mapped) {
+        ok = Flush();
+        munmap(m_map, m_mapSize);
+        m_map = nullptr;
+    }
+    if (m_fd >= 0) close(m_fd);
+    if (m_tableFd >= 0) {
+        close(m_tableFd);
+        // a complete image needs no table, an incomplete one keeps it for the next run
+        if (mapped && ok && m_remaining == 0) unlink(TablePath(m_filename).c_str());
+    }
+    m_fd = m_tableFd = -1;
+    m_mapSize = 0;
+    m_done.clear();
+    m_remaining = 0;
+    m_unflushed = 0;
+    m_resumed = false;
+    m_settings = RenderCheckpoint::Settings();
+    return ok;
+}
@@ -0,0 +1,139 @@
+/*
+    Trace.cpp
+    Per-thread event buffers and Chrome trace_event JSON output
+*/
+
+#include "../hpp/Trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+std::atomic<bool> Trace::s_Enabled(false);
+std::mutex Trace::s_Mutex;
+std::vector<std::unique_ptr<Trace::ThreadBuffer>> Trace::s_Buffers;
+
+namespace {
+
+const auto kEpoch = std::chrono::steady_clock::now();
+
+std::string Escape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+int64_t Trace::NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - kEpoch).count();
+}
+
+Trace::ThreadBuffer& Trace::Local() {
+    // buffers outlive their thread (the background BVH rebuild exits after each build)
+    static thread_local ThreadBuffer* local = [] {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        s_Buffers.push_back(std::make_unique<ThreadBuffer>());
+        ThreadBuffer* buffer = s_Buffers.back().get();
+        buffer->tid = static_cast<int>(s_Buffers.size());
+        buffer->name = "thread " + std::to_string(buffer->tid);
+        return buffer;
+    }();
+    return *local;
+}
+
+void Trace::SetThreadName(const std::string& name) {
+    ThreadBuffer& buffer = Local();
+    if (buffer.name == name) return;
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    buffer.name = name;
+}
+
+void Trace::Record(const char* name, const char* category, int64_t start_ns, int64_t end_ns,
+                   const char* const* arg_names, const long long* args, int arg_count) {
+    Event event{name, category, start_ns, end_ns - start_ns, {nullptr, nullptr}, {0, 0}, arg_count};
+    for (int i = 0; i < arg_count; i++) {
+        event.arg_names[i] = arg_names[i];
+        event.args[i] = args[i];
+    }
+    ThreadBuffer& buffer = Local();
+    // uncontended but for Clear/Write, events are coarse (tiles, passes, loads)
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.events.push_back(event);
+}
+
+void Trace::Clear() {
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    for (auto& buffer : s_Buffers) {
+        std::vector<Event> events;   // freed after the buffer lock is released
+        {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+            events.swap(buffer->events);
+        }
+    }
+}
+
+size_t Trace::EventCount() {
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    size_t count = 0;
+    for (const auto& buffer : s_Buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        count += buffer->events.size();
+    }
+    return count;
+}
+
+bool Trace::Write(const std::string& filename) {
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "ERROR: cannot write trace " << filename << std::endl;
+        return false;
+    }
+
+    // copy the events out so the threads keep recording while the file is written
+    struct Snapshot {
+        int tid;
+        std::string name;
+        std::vector<Event> events;
+    };
+    std::vector<Snapshot> snapshots;
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        for (const auto& buffer : s_Buffers) {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+            if (!buffer->events.empty()) snapshots.push_back({buffer->tid, buffer->name, buffer->events});
+        }
+    }
+
+    const int pid = static_cast<int>(getpid());
+    char line[512];
+    bool first = true;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (const Snapshot& buffer : snapshots) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer.tid
+            << ",\"args\":{\"name\":\"" << Escape(buffer.name) << "\"}}";
+        first = false;
+
+        for (const Event& e : buffer.events) {
+            // timestamps in microseconds, as the format expects
+            std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d",
+                          e.name, e.category, e.start_ns * 1e-3, e.duration_ns * 1e-3, pid, buffer.tid);
+            out << line;
+            if (e.arg_count > 0) {
+                out << ",\"args\":{";
+                for (int i = 0; i < e.arg_count; i++) out << (i ? "," : "") << "\"" << e.arg_names[i] << "\":" << e.args[i];
+                out << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+
+    std::cout << "Trace written to " << filename << std::endl;
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,75 @@
+/*
+    AovBuffers.hpp
+    Arbitrary output variables of a render: linear color and the first hit albedo, normal,
+    depth, object and material IDs, plus the sample count. Each pass is opt-in, only the
+    enabled ones are allocated and filled; all of them are saved in one multi-layer EXR
+*/
+
+#ifndef AOVBUFFERS_HPP
+#define AOVBUFFERS_HPP
+
+#include "Half.hpp"
+#include "Vector3.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class Aov { Color = 0, Albedo, Normal, Depth, ObjectId, MaterialId, SampleCount, Count };
+constexpr int kAovCount = static_cast<int>(Aov::Count);
+
+class AovBuffers {
+public:
+    static unsigned Bit(Aov aov) { return 1u << static_cast<int>(aov); }
+    static constexpr unsigned kAllPasses = (1u << kAovCount) - 1;
+
+    static const char* Name(Aov aov);
+    // comma separated pass names ("albedo,normal,depth"), "all" for every pass
+    static bool ParseList(const std::string& list, unsigned& passes);
+
+    // passes as a mask of Bit(); takes effect at the next Resize()
+    void SetPasses(unsigned passes) { m_passes = passes & kAllPasses; }
+    unsigned GetPasses() const { return m_passes; }
+    bool Has(Aov aov) const { return (m_passes & Bit(aov)) != 0; }
+
+    void Resize(int width, int height);
+    bool Empty() const { return m_width == 0 || m_height == 0 || m_passes == 0; }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+    // setters of passes that are not enabled must not be called
+    void SetColor(int x, int y, const Vector3& color) { PutHalf3(m_color, Index(x, y), color); }
+    void SetAlbedo(int x, int y, const Vector3& albedo) { PutHalf3(m_albedo, Index(x, y), albedo); }
+    void SetNormal(int x, int y, const Vector3& normal) { PutHalf3(m_normal, Index(x, y), normal); }
+    void SetDepth(int x, int y, double depth) { m_depth[Index(x, y)] = static_cast<float>(depth); }
+    void SetObjectId(int x, int y, uint32_t id) { m_objectId[Index(x, y)] = id; }
+    void SetMaterialId(int x, int y, uint32_t id) { m_materialId[Index(x, y)] = id; }
+    void SetSampleCount(int x, int y, uint32_t count) { m_sampleCount[Index(x, y)] = count; }
+
+    // channel 0..2 of the color passes, 0 for the others
+    double Get(Aov aov, int channel, int x, int y) const;
+
+    // one layer per enabled pass: "R G B", "albedo.*", "normal.*" as half,
+    // "Z" as float, "object.id", "material.id" and "samples.count" as uint
+    bool WriteEXR(const std::string& filename) const;
+
+private:
+    size_t Index(int x, int y) const { return static_cast<size_t>(y) * m_width + x; }
+
+    static void PutHalf3(std::vector<uint16_t>* planes, size_t i, const Vector3& v) {
+        planes[0][i] = Half::FromFloat(static_cast<float>(v.x));
+        planes[1][i] = Half::FromFloat(static_cast<float>(v.y));
+        planes[2][i] = Half::FromFloat(static_cast<float>(v.z));
+    }
+
+    unsigned m_passes = 0;
+    int m_width = 0, m_height = 0;
+    std::vector<uint16_t> m_color[3];
+    std::vector<uint16_t> m_albedo[3];
+    std::vector<uint16_t> m_normal[3];
+    std::vector<float> m_depth;
+    std::vector<uint32_t> m_objectId;
+    std::vector<uint32_t> m_materialId;
+    std::vector<uint32_t> m_sampleCount;
+};
+
+#endif
@@ -0,0 +1,50 @@
+/*
+    CostMap.hpp
+    Per-pixel render cost (time, BVH node visits, primitive tests)
+    Turned into a false-colour heatmap to find the objects that dominate a frame
+*/
+
+#ifndef COSTMAP_HPP
+#define COSTMAP_HPP
+
+#include "Image.hpp"
+#include <cstdint>
+#include <vector>
+
+enum class CostMetric { Time = 0, BVHNodes, PrimitiveTests, Count };
+
+class CostMap {
+public:
+    void Resize(int width, int height);
+    bool Empty() const { return m_width == 0 || m_height == 0; }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+    // totals over all the samples of the pixel
+    void Set(int x, int y, double time_ns, uint64_t bvh_nodes, uint64_t primitive_tests) {
+        const size_t i = static_cast<size_t>(y) * m_width + x;
+        m_values[static_cast<int>(CostMetric::Time)][i] = static_cast<float>(time_ns);
+        m_values[static_cast<int>(CostMetric::BVHNodes)][i] = static_cast<float>(bvh_nodes);
+        m_values[static_cast<int>(CostMetric::PrimitiveTests)][i] = static_cast<float>(primitive_tests);
+    }
+
+    double Get(CostMetric metric, int x, int y) const {
+        return m_values[static_cast<int>(metric)][static_cast<size_t>(y) * m_width + x];
+    }
+
+    // value mapped to the top of the colour scale: the 99th percentile, so a few
+    // extreme pixels do not flatten the rest of the map
+    double Scale(CostMetric metric) const;
+    double Max(CostMetric metric) const;
+
+    // writes the heatmap into an initialized image, 0..Scale() from dark blue to red
+    void ToImage(CostMetric metric, Image& image) const;
+
+    static const char* MetricName(CostMetric metric);
+
+private:
+    int m_width = 0, m_height = 0;
+    std::vector<float> m_values[static_cast<int>(CostMetric::Count)];
+};
+
+#endif
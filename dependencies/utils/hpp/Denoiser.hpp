@@ -0,0 +1,28 @@
+/*
+    Denoiser.hpp
+    Edge-avoiding a-trous wavelet filter guided by the feature buffers
+    (Dammertz et al. 2010, with the variance-driven luminance weight of SVGF, Schied et al. 2017)
+*/
+
+#ifndef DENOISER_HPP
+#define DENOISER_HPP
+
+#include "FeatureBuffers.hpp"
+#include "Image.hpp"
+#include <vector>
+
+class Denoiser {
+public:
+    struct Options {
+        int iterations = 5;     // 5x5 passes with steps 1, 2, 4... (5 covers a 125 pixel footprint)
+        double strength = 1.0;  // scales the luminance tolerance, 0 keeps the noisy image
+    };
+
+    // filtered linear color, out[c] holds width * height values
+    static void Denoise(const FeatureBuffers& features, const Options& options, std::vector<float> out[3]);
+
+    // filtered color, gamma corrected, written into an image of the same size
+    static void Apply(const FeatureBuffers& features, const Options& options, Image& image);
+};
+
+#endif
@@ -0,0 +1,30 @@
+/*
+    ExrWriter.hpp
+    Minimal OpenEXR output: single-part scanline files, any number of named
+    half / float / uint channels (layers are "layer.channel" names)
+*/
+
+#ifndef EXRWRITER_HPP
+#define EXRWRITER_HPP
+
+#include <string>
+#include <vector>
+
+class ExrWriter {
+public:
+    // same numbering as the pixel types of the format
+    enum class PixelType { Uint = 0, Half = 1, Float = 2 };
+
+    struct Channel {
+        std::string name;
+        PixelType type;
+        const void* data;   // width * height values (uint16_t for Half), row by row
+    };
+
+    // uncompressed, increasing Y; channels are written sorted by name as the format requires
+    static bool Write(const std::string& filename, int width, int height, std::vector<Channel> channels);
+
+    static size_t PixelSize(PixelType type) { return type == PixelType::Half ? 2 : 4; }
+};
+
+#endif
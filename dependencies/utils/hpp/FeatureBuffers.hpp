@@ -0,0 +1,48 @@
+/*
+    FeatureBuffers.hpp
+    Per-pixel auxiliary buffers filled during a render: linear color, its variance,
+    and the albedo, normal and depth of the first hit (inputs of the denoiser)
+*/
+
+#ifndef FEATUREBUFFERS_HPP
+#define FEATUREBUFFERS_HPP
+
+#include "Vector3.hpp"
+#include <vector>
+
+enum class Feature { ColorR = 0, ColorG, ColorB, AlbedoR, AlbedoG, AlbedoB, NormalX, NormalY, NormalZ, Depth, Variance, Count };
+
+class FeatureBuffers {
+public:
+    void Resize(int width, int height);
+    bool Empty() const { return m_width == 0 || m_height == 0; }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+    // averages over the samples of the pixel; variance is the one of the mean luminance,
+    // normal is unit length and depth 0 when every sample missed
+    void Set(int x, int y, const Vector3& color, double variance, const Vector3& albedo, const Vector3& normal, double depth) {
+        const size_t i = static_cast<size_t>(y) * m_width + x;
+        Put(Feature::ColorR, i, color);
+        Put(Feature::AlbedoR, i, albedo);
+        Put(Feature::NormalX, i, normal);
+        m_values[static_cast<int>(Feature::Depth)][i] = static_cast<float>(depth);
+        m_values[static_cast<int>(Feature::Variance)][i] = static_cast<float>(variance);
+    }
+
+    // one plane of width * height values, row by row
+    const float* Channel(Feature feature) const { return m_values[static_cast<int>(feature)].data(); }
+    float* Channel(Feature feature) { return m_values[static_cast<int>(feature)].data(); }
+
+private:
+    void Put(Feature first, size_t i, const Vector3& v) {
+        m_values[static_cast<int>(first)][i] = static_cast<float>(v.x);
+        m_values[static_cast<int>(first) + 1][i] = static_cast<float>(v.y);
+        m_values[static_cast<int>(first) + 2][i] = static_cast<float>(v.z);
+    }
+
+    int m_width = 0, m_height = 0;
+    std::vector<float> m_values[static_cast<int>(Feature::Count)];
+};
+
+#endif
@@ -0,0 +1,45 @@
+/*
+    FileWatcher.hpp
+    Notifies when a file is modified on disk
+    Uses inotify on Linux, falls back to polling the modification time elsewhere
+*/
+
+#ifndef FILEWATCHER_HPP
+#define FILEWATCHER_HPP
+
+#include <chrono>
+#include <string>
+
+class FileWatcher {
+public:
+    FileWatcher() = default;
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // starts watching filename (replaces the previous file), false on error
+    bool Watch(const std::string& filename);
+    void Stop();
+
+    // non-blocking: true once the file has been written and stayed quiet for the debounce delay
+    bool Poll();
+
+    const std::string& GetFilename() const { return m_filename; }
+    bool IsWatching() const { return !m_filename.empty(); }
+
+private:
+    bool ReadEvents();  // true if an event concerned the watched file
+
+    std::string m_filename;
+    std::string m_basename;   // file name inside the watched directory
+    int m_fd = -1;            // inotify instance
+    int m_wd = -1;            // watch on the parent directory (editors often replace the file)
+    long long m_mtime = 0;    // fallback when inotify is not available
+
+    // editors write in several steps: wait until the file is quiet
+    bool m_pending = false;
+    std::chrono::steady_clock::time_point m_lastEvent;
+    std::chrono::milliseconds m_debounce{50};
+};
+
+#endif
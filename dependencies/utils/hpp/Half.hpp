@@ -0,0 +1,66 @@
+/*
+    Half.hpp
+    IEEE 754 binary16 conversions, round to nearest even
+    (F. Giesen, "half_to_float / float_to_half_fast3_rtne")
+*/
+
+#ifndef HALF_HPP
+#define HALF_HPP
+
+#include <cstdint>
+#include <cstring>
+
+class Half {
+public:
+    static uint16_t FromFloat(float value) {
+        const uint32_t f32_infinity = 255u << 23;
+        const uint32_t f16_overflow = (127u + 16u) << 23;     // 2^16, rounds to infinity
+        const uint32_t denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+        uint32_t f = Bits(value);
+        const uint32_t sign = f & 0x80000000u;
+        f ^= sign;
+
+        uint16_t h;
+        if (f >= f16_overflow) {
+            h = f > f32_infinity ? 0x7e00 : 0x7c00;           // NaN stays NaN, the rest is infinity
+        } else if (f < (113u << 23)) {
+            // subnormal or zero: the float adder does the rounding
+            uint32_t r = Bits(Float(f) + Float(denorm_magic)) - denorm_magic;
+            h = static_cast<uint16_t>(r);
+        } else {
+            uint32_t mantissa_odd = (f >> 13) & 1u;
+            f += ((15u - 127u) << 23) + 0xfffu;
+            f += mantissa_odd;
+            h = static_cast<uint16_t>(f >> 13);
+        }
+        return static_cast<uint16_t>(h | (sign >> 16));
+    }
+
+    static float ToFloat(uint16_t h) {
+        const uint32_t shifted_exponent = 0x7c00u << 13;
+        uint32_t f = (h & 0x7fffu) << 13;
+        const uint32_t exponent = f & shifted_exponent;
+        f += (127u - 15u) << 23;
+        if (exponent == shifted_exponent) {
+            f += (128u - 16u) << 23;                           // infinity / NaN
+        } else if (exponent == 0) {
+            f = Bits(Float(f + (1u << 23)) - Float(113u << 23));  // subnormal
+        }
+        return Float(f | (static_cast<uint32_t>(h & 0x8000u) << 16));
+    }
+
+private:
+    static uint32_t Bits(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+    static float Float(uint32_t bits) {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+#endif
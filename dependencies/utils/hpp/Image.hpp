@@ -3,6 +3,8 @@
 
 
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 #include <SDL2/SDL.h>
@@ -16,30 +18,39 @@ class Image
         // Destructor.
         ~Image();
         
-        // Function to initialize.
+        // Function to initialize (pRenderer may be NULL for a headless image).
         void Initialize(const int xSize, const int ySize, SDL_Renderer *pRenderer);
     
         // Function to set pixels.
         void SetPixel(const int x, const int y, const double red, const double green, const double blue);
+        // binary P6, see ImageWriter for the other formats and background writes
         void SavePPM(const std::string& filename);
-        // Function to return the image for display.
+        // interleaved RGB, row by row, as stored (gamma corrected, 0..255)
+        void CopyPixels(std::vector<float>& rgb) const;
+        // Function to return the image for display (only the tiles set since the last call are uploaded).
         void Display();
-        int GetXsize(); 
-        int GetYsize();
+        int GetXsize() const; 
+        int GetYsize() const;
         
     private:
         Uint32 ConvertColor(const double red, const double green, const double blue);
         void InitTexture();
+        // converts tiles [tx0, tx1) of tile row ty into the streaming texture
+        void UploadTiles(const int ty, const int tx0, const int tx1);
+        
+        static constexpr int kTileSize = 32;
         
     private:
-        // Arrays to store image data.
-        std::vector<std::vector<double>> m_rChannel;
-        std::vector<std::vector<double>> m_gChannel;
-        std::vector<std::vector<double>> m_bChannel;
+        // Image data: RGB interleaved, row by row (copied to files and textures as is).
+        std::vector<double> m_pixels;
         
         // And store the size of the image.
         int m_xSize, m_ySize;
         
+        // Tiles changed since the last Display, set by renderer threads through SetPixel.
+        std::unique_ptr<std::atomic<unsigned char>[]> m_dirtyTiles;
+        int m_tilesX, m_tilesY;
+        
         
         // SDL2 stuff.
         SDL_Renderer *m_pRenderer;
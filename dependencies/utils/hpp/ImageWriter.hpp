@@ -0,0 +1,46 @@
+/*
+    ImageWriter.hpp
+    Binary image output: P6 PPM, PNG (deflate split across threads) and half / float OpenEXR
+    Frames are copied on the calling thread, encoding and disk I/O can run in the background
+*/
+
+#ifndef IMAGEWRITER_HPP
+#define IMAGEWRITER_HPP
+
+#include "Image.hpp"
+#include <future>
+#include <string>
+#include <vector>
+
+enum class ImageFormat { PPM = 0, PNG, EXRHalf, EXRFloat, Count };
+constexpr int kImageFormats = static_cast<int>(ImageFormat::Count);
+
+class ImageWriter {
+public:
+    // Pixels as Image stores them: gamma 2 and scaled to 0..255, highlights may go above
+    struct Frame {
+        int width = 0, height = 0;
+        std::vector<float> rgb;    // interleaved, row by row
+    };
+
+    static Frame Capture(const Image& image);
+
+    // 8-bit formats clamp to 0..255, EXR gets the linear values back (HDR)
+    static bool Write(const Frame& frame, const std::string& filename, ImageFormat format);
+    // copies the image now; the future holds the result of the write
+    static std::future<bool> WriteAsync(const Image& image, const std::string& filename, ImageFormat format);
+
+    static bool WritePPM(const Frame& frame, const std::string& filename);
+    // level 0..9 as zlib; rows are cut in chunks deflated in parallel
+    static bool WritePNG(const Frame& frame, const std::string& filename, int level = 6);
+    static bool WriteEXR(const Frame& frame, const std::string& filename, bool half = true);
+
+    // "ppm", "png", "exr" (half), "exr-float"
+    static const char* FormatName(ImageFormat format);
+    static const char* Extension(ImageFormat format);
+    static bool ParseFormat(const std::string& name, ImageFormat& format);
+    // from the extension of filename, ".exr" is half float
+    static bool FormatFromFilename(const std::string& filename, ImageFormat& format);
+};
+
+#endif
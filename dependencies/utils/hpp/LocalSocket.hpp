@@ -0,0 +1,56 @@
+/*
+    LocalSocket.hpp
+    UNIX domain stream sockets carrying framed messages: a type, a payload size, then the
+    payload. Native endianness, both ends run on the same machine
+*/
+
+#ifndef LOCALSOCKET_HPP
+#define LOCALSOCKET_HPP
+
+#include <cstdint>
+#include <string>
+
+class LocalSocket {
+public:
+    struct Message {
+        uint32_t type = 0;
+        std::string payload;
+    };
+
+    // listening socket bound to path (a stale socket file there is replaced), -1 on error
+    static int Listen(const std::string& path);
+    static int Connect(const std::string& path);
+    static int Accept(int listen_fd);
+    static void Close(int fd);
+
+    // false once the peer is gone (no SIGPIPE)
+    static bool Send(int fd, uint32_t type, const void* data, size_t size);
+    static bool Send(int fd, uint32_t type, const std::string& payload) { return Send(fd, type, payload.data(), payload.size()); }
+    // blocks until a whole message is in, false on error or when the peer closed the socket
+    static bool Receive(int fd, Message& message);
+
+    // Poll loops serving several peers read without blocking: the bytes are kept in a buffer
+    // per connection until a message is whole, so a peer stalled mid-message blocks nobody.
+    // Send still works on such sockets, waiting a little while the peer's buffer is full
+    static bool SetNonBlocking(int fd);
+    // appends whatever has arrived to buffer, false on error or once the peer closed the socket
+    static bool ReceiveAvailable(int fd, std::string& buffer);
+    // moves the first message of buffer into message; false while it is incomplete, and
+    // broken set when the buffer can't hold a valid message
+    static bool Extract(std::string& buffer, Message& message, bool& broken);
+
+    // trivially copyable records packed into / read back from a payload
+    template <typename T>
+    static void Append(std::string& payload, const T& value) {
+        payload.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    template <typename T>
+    static bool Read(const std::string& payload, size_t& offset, T& value) {
+        if (offset + sizeof(T) > payload.size()) return false;
+        payload.copy(reinterpret_cast<char*>(&value), sizeof(T), offset);
+        offset += sizeof(T);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,35 @@
+/*
+    MemoryUsage.hpp
+    Resident memory of the current process (Linux/macOS)
+*/
+
+#ifndef MEMORYUSAGE_HPP
+#define MEMORYUSAGE_HPP
+
+#include <cstddef>
+#include <fstream>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// peak resident set size since the process started, in bytes
+inline size_t PeakResidentBytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);          // already in bytes
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;   // kilobytes on Linux
+#endif
+}
+
+// current resident set size in bytes (0 where /proc is not available)
+inline size_t CurrentResidentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages_total = 0, pages_resident = 0;
+    if (!(statm >> pages_total >> pages_resident)) return 0;
+    return pages_resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+inline double BytesToMiB(size_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+#endif
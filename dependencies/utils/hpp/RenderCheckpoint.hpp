@@ -0,0 +1,69 @@
+/*
+    RenderCheckpoint.hpp
+    State of a progressive render: linear color sums and sample counts per pixel, with the
+    settings and the scene fingerprint they belong to. The hashed samplers (stratified, sobol,
+    bluenoise) draw from (pixel, sample index, seed) only, so the counts are all the sampler state
+    a resumed render needs; the independent sampler uses the per-thread generator and can't resume
+*/
+
+#ifndef RENDERCHECKPOINT_HPP
+#define RENDERCHECKPOINT_HPP
+
+#include "ImageWriter.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class RenderCheckpoint {
+public:
+    // everything the samples depend on: a checkpoint only resumes with the same values
+    struct Settings {
+        int width = 0, height = 0;
+        int samples_per_pixel = 0;
+        int max_depth = 0;
+        uint32_t sampler = 0;       // SamplerType
+        uint32_t seed = 0;
+        uint64_t scene = 0;         // Fingerprint() of the scene file
+
+        bool operator==(const Settings& o) const {
+            return width == o.width && height == o.height && samples_per_pixel == o.samples_per_pixel &&
+                   max_depth == o.max_depth && sampler == o.sampler && seed == o.seed && scene == o.scene;
+        }
+        bool operator!=(const Settings& o) const { return !(*this == o); }
+    };
+
+    // 64-bit FNV-1a of the file contents, 0 if it can't be read
+    static uint64_t Fingerprint(const std::string& filename);
+
+    // no samples yet
+    void Reset(const Settings& settings);
+    const Settings& GetSettings() const { return m_settings; }
+    int GetWidth() const { return m_settings.width; }
+    int GetHeight() const { return m_settings.height; }
+
+    // samples taken by a pixel and the sum of their colors (RGB)
+    uint32_t& Count(int x, int y) { return m_counts[Index(x, y)]; }
+    double* Sum(int x, int y) { return &m_sums[Index(x, y) * 3]; }
+
+    uint64_t TotalSamples() const;
+    // every pixel has samples_per_pixel samples
+    bool Complete() const;
+
+    // mean of each pixel, gamma 2 and scaled to 0..255 as Image stores it
+    ImageWriter::Frame Resolve() const;
+
+    // Written to a temporary file renamed over filename once synced: a render killed while
+    // saving keeps its previous checkpoint
+    bool Save(const std::string& filename) const;
+    // false if the file is missing, damaged or from another version of the format
+    bool Load(const std::string& filename);
+
+private:
+    size_t Index(int x, int y) const { return static_cast<size_t>(y) * m_settings.width + x; }
+
+    Settings m_settings;
+    std::vector<uint32_t> m_counts;
+    std::vector<double> m_sums;      // interleaved, row by row
+};
+
+#endif
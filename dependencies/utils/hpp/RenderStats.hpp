@@ -0,0 +1,82 @@
+/*
+    RenderStats.hpp
+    Per-thread ray and traversal counters, summed at the start and end of a render
+    Compiled out entirely unless RT_ENABLE_STATS is defined (CMake option of the same name)
+*/
+
+#ifndef RENDERSTATS_HPP
+#define RENDERSTATS_HPP
+
+#include <cstdint>
+#include <ostream>
+
+enum class PrimitiveKind { Sphere = 0, Plane, Triangle, Cylinder, Cone, Parallelepiped, Quad, Count };
+
+constexpr int kPrimitiveKinds = static_cast<int>(PrimitiveKind::Count);
+
+struct RenderCounters {
+    uint64_t primary_rays = 0;
+    uint64_t bounce_rays = 0;
+    uint64_t shadow_rays = 0;
+    uint64_t bvh_nodes = 0;     // bvh_node::hit calls
+    uint64_t aabb_tests = 0;
+    uint64_t primitive_tests[kPrimitiveKinds] = {};
+    uint64_t hits = 0;          // rays of any kind that found an intersection
+    uint64_t shadow_cache_lookups = 0;  // shadow rays that had a cached occluder to try
+    uint64_t shadow_cache_hits = 0;     // ... and were blocked by it (no traversal)
+
+    uint64_t rays() const { return primary_rays + bounce_rays + shadow_rays; }
+
+    uint64_t primitive_total() const {
+        uint64_t total = 0;
+        for (uint64_t tests : primitive_tests) total += tests;
+        return total;
+    }
+
+    double per_ray(uint64_t count) const { return rays() ? static_cast<double>(count) / rays() : 0.0; }
+
+    RenderCounters& operator+=(const RenderCounters& other);
+    RenderCounters& operator-=(const RenderCounters& other);
+};
+
+class RenderStats {
+public:
+    static constexpr bool Enabled() {
+#ifdef RT_ENABLE_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // counters of the calling thread: each thread registers its own cache line aligned block
+    // on first use, so the hot path is a plain increment without atomics. The block is
+    // folded into the totals and released when the thread exits
+    static RenderCounters& Local() {
+        static thread_local RenderCounters* local = Register();
+        return *local;
+    }
+
+    // Everything counted since the process started. A render reports the difference of two
+    // snapshots (the second once its workers are idle), so renders never reset each other's
+    // counts; renders overlapping on the same threads include each other's rays
+    static RenderCounters Snapshot();
+
+    static const char* KindName(PrimitiveKind kind);
+
+    // rays/s, nodes/ray, tests/ray summary for the console
+    static void Print(std::ostream& out, const RenderCounters& counters, double render_ms);
+
+private:
+    static RenderCounters* Register();
+};
+
+#ifdef RT_ENABLE_STATS
+#define RT_STAT(field) (++RenderStats::Local().field)
+#define RT_STAT_PRIMITIVE(kind) (++RenderStats::Local().primitive_tests[static_cast<int>(PrimitiveKind::kind)])
+#else
+#define RT_STAT(field) ((void)0)
+#define RT_STAT_PRIMITIVE(kind) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+/*
+    Sampler.hpp
+    Sample values for the pixel, lens and BSDF dimensions of a path
+    Independent (white noise), stratified, Owen-scrambled Sobol and blue-noise dithered Sobol
+*/
+
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+enum class SamplerType { Independent = 0, Stratified, Sobol, BlueNoise, Count };
+constexpr int kSamplerTypes = static_cast<int>(SamplerType::Count);
+
+class Sampler {
+public:
+    // Dimension layout shared by every sampler, so that a dimension always drives
+    // the same decision: the camera uses the first four, then each bounce gets its
+    // own block of kBounceDimensions whatever the material hit
+    static constexpr int kPixel = 0;            // 2D, jitter inside the pixel
+    static constexpr int kLens = 2;             // 2D, point on the lens
+    static constexpr int kCameraDimensions = 4;
+
+    static constexpr int kBsdfDirection = 0;    // 2D, scattered direction
+    static constexpr int kBsdfLobe = 2;         // 1D, lobe choice (reflect / refract...)
+    static constexpr int kLightChoice = 3;      // 1D, light picked for direct lighting
+    static constexpr int kLightPosition = 4;    // 2D, point on that light
+    static constexpr int kLightTree = 6;        // 1D, point/spot light picked from the light tree
+    static constexpr int kBounceDimensions = 7;
+
+    virtual ~Sampler() = default;
+
+    // one sampler per thread; samples_per_pixel is the count each pixel will request,
+    // seed decorrelates successive renders
+    static std::unique_ptr<Sampler> Create(SamplerType type, int samples_per_pixel, uint32_t seed = 0);
+    static const char* TypeName(SamplerType type);
+    static bool ParseType(const std::string& name, SamplerType& type);
+
+    // selects the sample, and the camera block of dimensions
+    void StartPixel(int x, int y, int sample_index) {
+        m_x = x;
+        m_y = y;
+        m_index = sample_index;
+        m_base = 0;
+    }
+
+    // selects the block of dimensions of bounce 0, 1, 2...
+    void StartBounce(int bounce) { m_base = kCameraDimensions + bounce * kBounceDimensions; }
+
+    // values in [0, 1), dimension is relative to the current block
+    double Get1D(int dimension) { return Sample1D(m_base + dimension); }
+    void Get2D(int dimension, double& u, double& v) { Sample2D(m_base + dimension, u, v); }
+
+protected:
+    Sampler(int samples_per_pixel, uint32_t seed) : m_spp(samples_per_pixel < 1 ? 1 : samples_per_pixel), m_seed(seed) {}
+
+    virtual double Sample1D(int dimension) = 0;
+    virtual void Sample2D(int dimension, double& u, double& v) = 0;
+
+    int m_spp;
+    uint32_t m_seed;
+    int m_x = 0, m_y = 0;
+    int m_index = 0;
+    int m_base = 0;
+};
+
+#endif
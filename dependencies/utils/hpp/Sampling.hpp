@@ -0,0 +1,89 @@
+/*
+    Sampling.hpp
+    Closed-form warps from uniform values in [0, 1) to disks, spheres and hemispheres
+    One evaluation per sample (no rejection loop), with the matching PDFs
+*/
+
+#ifndef SAMPLING_HPP
+#define SAMPLING_HPP
+
+#include <cmath>
+#include "Vector3.hpp"
+
+class Sampling {
+public:
+    // Shirley-Chiu concentric mapping: keeps the strata of (u, v) compact on the disk.
+    // Point in the unit disk (z = 0), pdf per unit area
+    static Vector3 ConcentricDisk(double u, double v) {
+        double a = 2.0 * u - 1.0;
+        double b = 2.0 * v - 1.0;
+        if (a == 0.0 && b == 0.0) return Vector3(0, 0, 0);
+
+        double r, theta;
+        if (std::fabs(a) > std::fabs(b)) {
+            r = a;
+            theta = (kPi / 4.0) * (b / a);
+        } else {
+            r = b;
+            theta = (kPi / 2.0) - (kPi / 4.0) * (a / b);
+        }
+        return Vector3(r * std::cos(theta), r * std::sin(theta), 0);
+    }
+    static double ConcentricDiskPdf() { return 1.0 / kPi; }
+
+    // Unit direction, pdf per steradian
+    static Vector3 UniformSphere(double u, double v) {
+        double z = 1.0 - 2.0 * u;
+        double r = std::sqrt(std::fmax(0.0, 1.0 - z * z));
+        double phi = 2.0 * kPi * v;
+        return Vector3(r * std::cos(phi), r * std::sin(phi), z);
+    }
+    static double UniformSpherePdf() { return 1.0 / (4.0 * kPi); }
+
+    // Point in the unit ball: direction from (u, v), radius from w; pdf per unit volume
+    static Vector3 UniformBall(double u, double v, double w) {
+        return std::cbrt(w) * UniformSphere(u, v);
+    }
+    static double UniformBallPdf() { return 3.0 / (4.0 * kPi); }
+
+    // Cosine-weighted direction around +z (Malley: disk point lifted to the hemisphere),
+    // pdf per steradian = cos(theta) / pi
+    static Vector3 CosineHemisphere(double u, double v) {
+        Vector3 d = ConcentricDisk(u, v);
+        double z = std::sqrt(std::fmax(0.0, 1.0 - d.x * d.x - d.y * d.y));
+        return Vector3(d.x, d.y, z);
+    }
+    static double CosineHemispherePdf(double cos_theta) { return cos_theta > 0 ? cos_theta / kPi : 0.0; }
+
+    // Uniform direction inside the cone of half angle acos(cos_max) around +z,
+    // pdf per steradian
+    static Vector3 UniformCone(double u, double v, double cos_max) {
+        double cos_theta = 1.0 - u * (1.0 - cos_max);
+        double sin_theta = std::sqrt(std::fmax(0.0, 1.0 - cos_theta * cos_theta));
+        double phi = 2.0 * kPi * v;
+        return Vector3(sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta);
+    }
+    static double UniformConePdf(double cos_max) { return 1.0 / (2.0 * kPi * (1.0 - cos_max)); }
+
+    // Orthonormal basis (t, b, n) around a unit vector, branchless
+    // (Duff et al. 2017, "Building an Orthonormal Basis, Revisited")
+    static void Basis(const Vector3& n, Vector3& t, Vector3& b) {
+        double sign = std::copysign(1.0, n.z);
+        double a = -1.0 / (sign + n.z);
+        double c = n.x * n.y * a;
+        t = Vector3(1.0 + sign * n.x * n.x * a, sign * c, -sign * n.x);
+        b = Vector3(c, sign + n.y * n.y * a, -n.y);
+    }
+
+    // Local direction (z along n) to world space
+    static Vector3 ToWorld(const Vector3& local, const Vector3& n) {
+        Vector3 t, b;
+        Basis(n, t, b);
+        return local.x * t + local.y * b + local.z * n;
+    }
+
+private:
+    static constexpr double kPi = 3.14159265358979323846;
+};
+
+#endif
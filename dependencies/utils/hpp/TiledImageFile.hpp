@@ -0,0 +1,78 @@
+/*
+    TiledImageFile.hpp
+    Out-of-core output of a render: a binary PPM (P6) mapped in memory and filled tile by tile,
+    plus a tile table ("<file>.tiles") recording the render settings and which tiles are on disk.
+    Written pages are dropped from memory as soon as their tile is done, so the memory used does
+    not depend on the image size; an interrupted render resumes from the table
+*/
+
+#ifndef TILEDIMAGEFILE_HPP
+#define TILEDIMAGEFILE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "RenderCheckpoint.hpp"
+
+class TiledImageFile {
+public:
+    TiledImageFile() = default;
+    ~TiledImageFile() { Close(); }
+    TiledImageFile(const TiledImageFile&) = delete;
+    TiledImageFile& operator=(const TiledImageFile&) = delete;
+
+    // Resumes filename when it and its tile table match these settings (size, samples, sampler,
+    // seed and scene fingerprint) and tile size, otherwise both are created (the image as a
+    // sparse file, pixels of missing tiles read as black)
+    bool Open(const std::string& filename, const RenderCheckpoint::Settings& settings, int tile_size);
+    bool IsOpen() const { return m_map != nullptr; }
+    bool Resumed() const { return m_resumed; }
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    int GetTileSize() const { return m_tileSize; }
+    int TilesX() const { return m_tilesX; }
+    int TileCount() const { return static_cast<int>(m_done.size()); }
+
+    // pixels [x0, x1) x [y0, y1) of a tile
+    void TileRect(int tile, int& x0, int& y0, int& x1, int& y1) const;
+    bool IsTileDone(int tile) const;
+    int RemainingTiles() const;
+
+    // rgb: the tile row by row, 3 bytes per pixel. Tiles can be written from several threads
+    bool WriteTile(int tile, const unsigned char* rgb);
+
+    // Makes the finished tiles durable: image pages first, then the table that lists them
+    bool Flush();
+    // Flushes and unmaps; the table is removed once every tile is done
+    bool Close();
+
+private:
+    bool Create(const std::string& filename);
+    bool Resume(const std::string& filename);
+    bool Map();
+    bool FlushLocked();
+
+    std::string m_filename;
+    RenderCheckpoint::Settings m_settings;
+    int m_width = 0, m_height = 0, m_tileSize = 0;
+    int m_tilesX = 0, m_tilesY = 0;
+    bool m_resumed = false;
+
+    int m_fd = -1;              // image
+    int m_tableFd = -1;         // tile table
+    unsigned char* m_map = nullptr;
+    size_t m_mapSize = 0;
+    size_t m_headerSize = 0;    // PPM header before the pixels
+
+    mutable std::mutex m_mutex;
+    std::vector<uint8_t> m_done;
+    int m_remaining = 0;
+    int m_unflushed = 0;
+    std::chrono::steady_clock::time_point m_lastFlush;
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+    Trace.hpp
+    Scoped timers written as Chrome trace_event JSON (chrome://tracing, Perfetto)
+    Each thread appends to its own buffer, recording is switched on at run time
+*/
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Trace {
+public:
+    static void Enable(bool on) { s_Enabled.store(on, std::memory_order_relaxed); }
+    static bool Enabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+    // safe while other threads record: each buffer is copied or emptied under its lock,
+    // scopes still open at that point are not part of the output
+    static void Clear();
+    static bool Write(const std::string& filename);
+    static size_t EventCount();
+
+    // label of the calling thread in the viewer ("main", "omp worker 3", ...)
+    static void SetThreadName(const std::string& name);
+
+    static int64_t NowNs();
+    static void Record(const char* name, const char* category, int64_t start_ns, int64_t end_ns,
+                       const char* const* arg_names, const long long* args, int arg_count);
+
+private:
+    struct Event {
+        const char* name;       // string literals only, they are not copied
+        const char* category;
+        int64_t start_ns;
+        int64_t duration_ns;
+        const char* arg_names[2];
+        long long args[2];
+        int arg_count;
+    };
+
+    struct ThreadBuffer {
+        int tid = 0;
+        std::string name;
+        std::mutex mutex;           // guards events: the owner appends, Clear/Write take them
+        std::vector<Event> events;
+    };
+
+    static ThreadBuffer& Local();
+
+    static std::atomic<bool> s_Enabled;
+    static std::mutex s_Mutex;      // guards s_Buffers and the names, taken once per thread
+    static std::vector<std::unique_ptr<ThreadBuffer>> s_Buffers;
+};
+
+// records [construction, destruction) as one complete event when tracing is on
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, const char* category = "rt")
+        : m_name(name), m_category(category), m_start(Trace::Enabled() ? Trace::NowNs() : -1) {}
+
+    ~TraceScope() {
+        if (m_start >= 0) Trace::Record(m_name, m_category, m_start, Trace::NowNs(), m_argNames, m_args, m_argCount);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    // up to two integer arguments shown in the event details (tile position, counts...)
+    TraceScope& Arg(const char* name, long long value) {
+        if (m_argCount < 2) {
+            m_argNames[m_argCount] = name;
+            m_args[m_argCount++] = value;
+        }
+        return *this;
+    }
+
+private:
+    const char* m_name;
+    const char* m_category;
+    int64_t m_start;
+    const char* m_argNames[2] = {nullptr, nullptr};
+    long long m_args[2] = {0, 0};
+    int m_argCount = 0;
+};
+
+#endif
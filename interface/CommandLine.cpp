@@ -0,0 +1,393 @@
+/*
+    CommandLine.cpp
+    Argument parsing and dispatch of the headless commands
+*/
+
+#include "CommandLine.hpp"
+#include "scene/hpp/SceneCompiler.hpp"
+#include "scene/hpp/SceneGenerator.hpp"
+#include "scene/hpp/Sceneloader.hpp"
+#include "RTMotors/hpp/ParallelRenderer.hpp"
+#include "RTMotors/hpp/RenderDaemon.hpp"
+#include "RTMotors/hpp/SimpleRenderer.hpp"
+#include "RTMotors/hpp/TileFarm.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <iostream>
+#include <unistd.h>
+
+bool CommandLine::Run(int argc, char** argv, int& exit_code) {
+    if (argc < 2) return false;
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+    const std::string& command = args[0];
+
+    if (command == "--help" || command == "-h") {
+        PrintUsage();
+        exit_code = 0;
+    } else if (command == "--compile") {
+        exit_code = Compile(args);
+    } else if (command == "--generate") {
+        exit_code = Generate(args);
+    } else if (command == "--render") {
+        exit_code = Render(args);
+    } else if (command == "--worker" && args.size() == 2) {
+        exit_code = TileFarm::Work(args[1]);
+    } else if (command == "--daemon") {
+        exit_code = Daemon(args);
+    } else if (command == "--submit") {
+        exit_code = Submit(args);
+    } else {
+        std::cerr << "Unknown command " << command << std::endl;
+        PrintUsage();
+        exit_code = 1;
+    }
+    return true;
+}
+
+void CommandLine::PrintUsage() {
+    std::cout << "Usage:\n"
+              << "  RT                                          start the interactive UI\n"
+              << "  RT --compile <scene.json> <out.rtsc> [--no-bvh]\n"
+              << "                                              convert a JSON scene to the binary format\n"
+              << "  RT --generate <out.json|out.rtsc> [options] [--no-bvh]\n"
+              << "                                              write a procedural scene\n"
+              << SceneGenerator::Usage()
+              << "  RT --render <scene.json|scene.rtsc> <out.ppm> --size WxH [options]\n"
+              << "                                              tiled render straight to disk, resumed if run again\n"
+              << "  --spp N            samples per pixel (default 16)\n"
+              << "  --depth N          max bounces (default 8)\n"
+              << "  --tile N           tile side in pixels (default 64)\n"
+              << "  --sampler NAME     pixel sampler (default sobol)\n"
+              << "  --seed S           sampler seed (default 0)\n"
+              << "  --simple           single-threaded renderer\n"
+              << "  --checkpoint SEC   progressive render in memory to <out>.png|.ppm|.exr, the samples\n"
+              << "                     so far are saved to <out>.ckpt every SEC seconds\n"
+              << "  --resume           continue from <out>.ckpt (checkpoint every 60 s by default)\n"
+              << "                     not with --sampler independent\n"
+              << "  --pass N           samples per pixel added by each progressive pass (default 8)\n"
+              << "  --workers N        tile farm: N local worker processes render the units, the frame is\n"
+              << "                     written to <out>.png|.ppm|.exr (0: only workers started by hand)\n"
+              << "  --socket PATH      coordinator socket (default /tmp/rt-farm-<pid>.sock)\n"
+              << "  --unit-samples N   samples of a tile per work unit (default all)\n"
+              << "  RT --worker <socket>                        tile farm worker, joins a running coordinator\n"
+              << "  RT --daemon <socket> [--cache N] [--tile N] render server, keeps the last N scenes loaded (default 4)\n"
+              << "  RT --submit <socket> <scene> <out> --size WxH [options]\n"
+              << "                                              render on the daemon and wait for the image\n"
+              << "  --spp, --depth, --sampler, --seed           as for --render\n"
+              << "  --priority P       higher runs first and preempts the running job (default 0)\n"
+              << "  --look-from X,Y,Z  --look-at X,Y,Z  --fov DEG   camera override\n"
+              << "  RT --submit <socket> --stop                 stop the daemon\n";
+}
+
+int CommandLine::Compile(const std::vector<std::string>& args) {
+    if (args.size() < 3) {
+        PrintUsage();
+        return 1;
+    }
+    bool with_bvh = !(args.size() > 3 && args[3] == "--no-bvh");
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    bool ok = SceneCompiler::CompileJSON(args[1], args[2], with_bvh);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> ms = t2 - t1;
+
+    if (ok) std::cout << "Done in " << ms.count() << " ms" << std::endl;
+    return ok ? 0 : 1;
+}
+
+int CommandLine::Generate(const std::vector<std::string>& args) {
+    SceneGenerator::Options options;
+    std::vector<std::string> rest;
+    if (args.size() < 2 || !SceneGenerator::ParseArgs(std::vector<std::string>(args.begin() + 2, args.end()), options, rest)) {
+        PrintUsage();
+        return 1;
+    }
+    bool with_bvh = true;
+    for (const std::string& arg : rest) {
+        if (arg != "--no-bvh") {
+            std::cerr << "Unknown option " << arg << std::endl;
+            PrintUsage();
+            return 1;
+        }
+        with_bvh = false;
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    const std::string& out = args[1];
+    bool compiled = out.size() > 5 && out.compare(out.size() - 5, 5, ".rtsc") == 0;
+    bool ok = compiled ? SceneGenerator::WriteCompiled(options, out, with_bvh) : SceneGenerator::WriteJSON(options, out);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> ms = t2 - t1;
+
+    if (ok) std::cout << "Done in " << ms.count() << " ms" << std::endl;
+    return ok ? 0 : 1;
+}
+
+namespace {
+
+struct RenderOptions {
+    std::string scene_file, out;
+    int width = 0, height = 0, spp = 16, depth = 8, tile = 64;
+    SamplerType sampler = SamplerType::Sobol;
+    uint32_t seed = 0;
+    bool simple = false;
+    double checkpoint_seconds = 0.0;    // > 0: progressive render with checkpoints
+    bool resume = false;
+    int pass = 8;
+    int workers = -1;                   // >= 0: tile farm with that many local workers
+    std::string socket_path;
+    int unit_samples = 0;
+};
+
+RenderCheckpoint::Settings SettingsOf(const RenderOptions& options) {
+    RenderCheckpoint::Settings settings;
+    settings.width = options.width;
+    settings.height = options.height;
+    settings.samples_per_pixel = options.spp;
+    settings.max_depth = options.depth;
+    settings.sampler = static_cast<uint32_t>(options.sampler);
+    settings.seed = options.seed;
+    return settings;
+}
+
+int RenderTiled(const RenderOptions& options, const Scene& scene, Renderer& renderer) {
+    // a table left by another scene or other settings is not resumed
+    RenderCheckpoint::Settings settings = SettingsOf(options);
+    settings.scene = RenderCheckpoint::Fingerprint(options.scene_file);
+    TiledImageFile output;
+    if (!output.Open(options.out, settings, options.tile)) return 1;
+    if (output.Resumed()) {
+        std::cout << "Resuming " << options.out << ": " << output.TileCount() - output.RemainingTiles() << "/" << output.TileCount()
+                  << " tiles already done" << std::endl;
+    }
+    bool ok = renderer.RenderTiles(scene, output);
+    ok = output.Close() && ok;
+    return ok ? 0 : 1;
+}
+
+int RenderWithCheckpoints(const RenderOptions& options, const Scene& scene, Renderer& renderer) {
+    ImageFormat format;
+    if (!ImageWriter::FormatFromFilename(options.out, format)) {
+        std::cerr << "Unknown image format for " << options.out << " (.png, .ppm or .exr)" << std::endl;
+        return 1;
+    }
+    RenderCheckpoint::Settings settings = SettingsOf(options);
+    settings.scene = RenderCheckpoint::Fingerprint(options.scene_file);
+
+    const std::string checkpoint_file = options.out + ".ckpt";
+    const double pixels = static_cast<double>(options.width) * options.height;
+    RenderCheckpoint state;
+    if (options.resume && state.Load(checkpoint_file)) {
+        if (state.GetSettings() != settings) {
+            std::cerr << checkpoint_file << " was saved for another scene or other settings" << std::endl;
+            return 1;
+        }
+        std::cout << "Resuming from " << checkpoint_file << ": " << state.TotalSamples() / pixels << "/" << options.spp
+                  << " samples per pixel done" << std::endl;
+    } else {
+        if (options.resume) std::cout << "No checkpoint in " << checkpoint_file << ", starting from the first sample" << std::endl;
+        state.Reset(settings);
+    }
+
+    std::cout << "Progressive render (" << options.width << "x" << options.height << ", " << options.spp << " spp in passes of "
+              << options.pass << ", checkpoint every " << options.checkpoint_seconds << " s)..." << std::endl;
+    auto last_save = std::chrono::steady_clock::now();
+    while (!state.Complete()) {
+        renderer.RenderPass(scene, state, options.pass);
+        std::cout << "  Pass: " << state.TotalSamples() / pixels << "/" << options.spp << " spp" << std::endl;
+
+        std::chrono::duration<double> since = std::chrono::steady_clock::now() - last_save;
+        if (since.count() >= options.checkpoint_seconds && !state.Complete()) {
+            if (state.Save(checkpoint_file)) std::cout << "  Checkpoint saved to " << checkpoint_file << std::endl;
+            last_save = std::chrono::steady_clock::now();
+        }
+    }
+
+    if (!ImageWriter::Write(state.Resolve(), options.out, format)) return 1;
+    // the image is complete, nothing left to resume
+    std::remove(checkpoint_file.c_str());
+    return 0;
+}
+
+int RenderOnFarm(const RenderOptions& options) {
+    ImageFormat format;
+    if (!ImageWriter::FormatFromFilename(options.out, format)) {
+        std::cerr << "Unknown image format for " << options.out << " (.png, .ppm or .exr)" << std::endl;
+        return 1;
+    }
+    TileFarm::Options farm;
+    // workers may run from another directory
+    char scene_path[PATH_MAX];
+    farm.scene_file = realpath(options.scene_file.c_str(), scene_path) ? scene_path : options.scene_file;
+    farm.socket_path = options.socket_path;
+    farm.workers = options.workers;
+    farm.tile_size = options.tile;
+    farm.unit_samples = options.unit_samples;
+
+    RenderCheckpoint state;
+    state.Reset(SettingsOf(options));
+    if (!TileFarm::Render(farm, state)) return 1;
+    return ImageWriter::Write(state.Resolve(), options.out, format) ? 0 : 1;
+}
+
+} // namespace
+
+int CommandLine::Render(const std::vector<std::string>& args) {
+    if (args.size() < 3) {
+        PrintUsage();
+        return 1;
+    }
+    RenderOptions options;
+    options.scene_file = args[1];
+    options.out = args[2];
+    for (size_t i = 3; i < args.size(); i++) {
+        const std::string& arg = args[i];
+        bool has_value = i + 1 < args.size();
+        bool ok = true;
+        if (arg == "--size" && has_value) ok = std::sscanf(args[++i].c_str(), "%dx%d", &options.width, &options.height) == 2;
+        else if (arg == "--spp" && has_value) options.spp = std::atoi(args[++i].c_str());
+        else if (arg == "--depth" && has_value) options.depth = std::atoi(args[++i].c_str());
+        else if (arg == "--tile" && has_value) options.tile = std::atoi(args[++i].c_str());
+        else if (arg == "--sampler" && has_value) ok = Sampler::ParseType(args[++i], options.sampler);
+        else if (arg == "--seed" && has_value) options.seed = static_cast<uint32_t>(std::strtoul(args[++i].c_str(), nullptr, 10));
+        else if (arg == "--simple") options.simple = true;
+        else if (arg == "--checkpoint" && has_value) ok = (options.checkpoint_seconds = std::atof(args[++i].c_str())) > 0.0;
+        else if (arg == "--resume") options.resume = true;
+        else if (arg == "--pass" && has_value) options.pass = std::atoi(args[++i].c_str());
+        else if (arg == "--workers" && has_value) ok = (options.workers = std::atoi(args[++i].c_str())) >= 0;
+        else if (arg == "--socket" && has_value) options.socket_path = args[++i];
+        else if (arg == "--unit-samples" && has_value) ok = (options.unit_samples = std::atoi(args[++i].c_str())) > 0;
+        else ok = false;
+        if (!ok) {
+            std::cerr << "Invalid option " << arg << std::endl;
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (options.width <= 0 || options.height <= 0 || options.spp <= 0 || options.depth <= 0 || options.tile <= 0 || options.pass <= 0) {
+        std::cerr << "--render needs a size and positive counts" << std::endl;
+        return 1;
+    }
+    const bool progressive = options.checkpoint_seconds > 0.0 || options.resume;
+    if (progressive && options.checkpoint_seconds <= 0.0) options.checkpoint_seconds = 60.0;
+    // the independent sampler draws from the per-thread generator, not from the sample index,
+    // so a resumed render would not continue the same sample sequence
+    if (progressive && options.sampler == SamplerType::Independent) {
+        std::cerr << "--checkpoint/--resume need a hashed sampler (stratified, sobol or bluenoise)" << std::endl;
+        return 1;
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    auto finish = [&t1](int code) {
+        std::chrono::duration<double, std::milli> ms = std::chrono::high_resolution_clock::now() - t1;
+        if (code == 0) std::cout << "Done in " << ms.count() << " ms" << std::endl;
+        return code;
+    };
+    // the workers load the scene, the coordinator only merges their samples
+    if (options.workers >= 0) return finish(RenderOnFarm(options));
+
+    Scene scene;
+    const double aspect_ratio = static_cast<double>(options.width) / options.height;
+    if (SceneCompiler::IsCompiledScene(options.scene_file)) {
+        if (!SceneCompiler::Load(options.scene_file, scene, aspect_ratio, true)) return 1;
+    } else {
+        if (!SceneLoader::LoadJSONStream(options.scene_file, scene, aspect_ratio)) return 1;
+    }
+
+    std::unique_ptr<Renderer> renderer;
+    if (options.simple) renderer = std::make_unique<SimpleRenderer>();
+    else renderer = std::make_unique<ParallelRenderer>();
+    renderer->SetSamplesPerPixel(options.spp);
+    renderer->SetMaxDepth(options.depth);
+    renderer->SetSampler(options.sampler);
+    renderer->SetSamplerSeed(options.seed);
+
+    return finish(progressive ? RenderWithCheckpoints(options, scene, *renderer) : RenderTiled(options, scene, *renderer));
+}
+
+int CommandLine::Daemon(const std::vector<std::string>& args) {
+    if (args.size() < 2) {
+        PrintUsage();
+        return 1;
+    }
+    RenderDaemon::Options options;
+    for (size_t i = 2; i < args.size(); i++) {
+        const std::string& arg = args[i];
+        bool has_value = i + 1 < args.size();
+        bool ok = true;
+        if (arg == "--cache" && has_value) ok = (options.cache_scenes = std::atoi(args[++i].c_str())) > 0;
+        else if (arg == "--tile" && has_value) ok = (options.tile_size = std::atoi(args[++i].c_str())) > 0;
+        else ok = false;
+        if (!ok) {
+            std::cerr << "Invalid option " << arg << std::endl;
+            PrintUsage();
+            return 1;
+        }
+    }
+    return RenderDaemon::Serve(args[1], options);
+}
+
+int CommandLine::Submit(const std::vector<std::string>& args) {
+    if (args.size() == 3 && args[2] == "--stop") return RenderDaemon::Stop(args[1]) ? 0 : 1;
+    if (args.size() < 4) {
+        PrintUsage();
+        return 1;
+    }
+    // the daemon runs from its own directory
+    RenderDaemon::Job job;
+    char path[PATH_MAX];
+    job.scene_file = realpath(args[2].c_str(), path) ? path : args[2];
+    job.output = args[3];
+    if (job.output[0] != '/' && getcwd(path, sizeof(path))) job.output = std::string(path) + "/" + job.output;
+
+    auto parse_vector = [](const std::string& value, Vector3& v) {
+        double x, y, z;
+        if (std::sscanf(value.c_str(), "%lf,%lf,%lf", &x, &y, &z) != 3) return false;
+        v = Vector3(x, y, z);
+        return true;
+    };
+    for (size_t i = 4; i < args.size(); i++) {
+        const std::string& arg = args[i];
+        bool has_value = i + 1 < args.size();
+        bool ok = true;
+        if (arg == "--size" && has_value) ok = std::sscanf(args[++i].c_str(), "%dx%d", &job.width, &job.height) == 2;
+        else if (arg == "--spp" && has_value) job.samples_per_pixel = std::atoi(args[++i].c_str());
+        else if (arg == "--depth" && has_value) job.max_depth = std::atoi(args[++i].c_str());
+        else if (arg == "--sampler" && has_value) ok = Sampler::ParseType(args[++i], job.sampler);
+        else if (arg == "--seed" && has_value) job.seed = static_cast<uint32_t>(std::strtoul(args[++i].c_str(), nullptr, 10));
+        else if (arg == "--priority" && has_value) job.priority = std::atoi(args[++i].c_str());
+        else if (arg == "--look-from" && has_value) ok = job.set_look_from = parse_vector(args[++i], job.look_from);
+        else if (arg == "--look-at" && has_value) ok = job.set_look_at = parse_vector(args[++i], job.look_at);
+        else if (arg == "--fov" && has_value) ok = (job.vfov = std::atof(args[++i].c_str())) > 0.0;
+        else ok = false;
+        if (!ok) {
+            std::cerr << "Invalid option " << arg << std::endl;
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (job.width <= 0 || job.height <= 0 || job.samples_per_pixel <= 0 || job.max_depth <= 0) {
+        std::cerr << "--submit needs a size and positive counts" << std::endl;
+        return 1;
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    RenderDaemon::Result result;
+    if (!RenderDaemon::Submit(args[1], job, result)) return 1;
+    std::chrono::duration<double, std::milli> ms = std::chrono::high_resolution_clock::now() - t1;
+    if (!result.ok) {
+        std::cerr << "Job failed: " << result.message << std::endl;
+        return 1;
+    }
+    // what the daemon did not spend queued, loading, rendering or saving: sockets and bookkeeping
+    const double accounted_ms = result.queued_ms + result.load_ms + result.render_ms + result.save_ms;
+    std::cout << "Done in " << ms.count() << " ms: queued " << result.queued_ms << " ms, scene "
+              << (result.cached ? "cached " : "loaded ") << result.load_ms << " ms, render " << result.render_ms
+              << " ms, save " << result.save_ms << " ms, " << result.preemptions << " preemptions, overhead "
+              << (ms.count() - accounted_ms) * 1000.0 << " us" << std::endl;
+    return 0;
+}
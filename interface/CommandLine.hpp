@@ -0,0 +1,46 @@
+/*
+    CommandLine.hpp
+    Headless commands available from the RT executable
+    Without arguments the SDL/ImGui application is started instead
+*/
+
+#ifndef COMMANDLINE_HPP
+#define COMMANDLINE_HPP
+
+#include <string>
+#include <vector>
+
+class CommandLine {
+public:
+    // runs the command given in argv, returns false if there is none (start the UI)
+    static bool Run(int argc, char** argv, int& exit_code);
+
+private:
+    static void PrintUsage();
+
+    // RT --compile <scene.json> <scene.rtsc> [--no-bvh]
+    static int Compile(const std::vector<std::string>& args);
+
+    // RT --generate <out.json|out.rtsc> [generator options] [--no-bvh]
+    static int Generate(const std::vector<std::string>& args);
+
+    // RT --render <scene.json|scene.rtsc> <out.ppm> --size WxH [--spp N] [--depth N] [--tile N]
+    //    [--sampler NAME] [--seed S] [--simple] [--checkpoint SEC] [--resume] [--pass N]
+    //    [--workers N] [--socket PATH] [--unit-samples N]
+    // tiled out-of-core render, running it again resumes the tiles still missing; with
+    // --checkpoint or --resume, progressive render saving its samples to <out>.ckpt instead;
+    // with --workers, tile farm coordinator (RT --worker <socket> joins it)
+    static int Render(const std::vector<std::string>& args);
+
+    // RT --daemon <socket> [--cache N] [--tile N]
+    // render server keeping the last N scenes loaded
+    static int Daemon(const std::vector<std::string>& args);
+
+    // RT --submit <socket> <scene> <out.png|.ppm|.exr> --size WxH [--spp N] [--depth N]
+    //    [--sampler NAME] [--seed S] [--priority P] [--look-from X,Y,Z] [--look-at X,Y,Z] [--fov DEG]
+    // RT --submit <socket> --stop
+    // sends a job to the daemon and waits for its image
+    static int Submit(const std::vector<std::string>& args);
+};
+
+#endif
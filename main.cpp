@@ -1,9 +1,13 @@
 #include <iostream>
 #include "rendering/RayTracerApp.hpp"
+#include "interface/CommandLine.hpp"
 #include "dependencies/utils/hpp/Vector3.hpp"
 
 
-int main( ){
+int main(int argc, char** argv){
+   int exit_code = 0;
+   if (CommandLine::Run(argc, argv, exit_code)) return exit_code;
+
    RayTracerApp app; 
    app.OnExecute();
 }
\ No newline at end of file
@@ -6,11 +6,17 @@
 
 #include "RayTracerApp.hpp"
 #include <iostream>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <algorithm>
 #include <chrono>
 #include <sstream>
+#include <utility>
 #include "../dependencies/scene/hpp/Sceneloader.hpp"
+#include "../dependencies/scene/hpp/SceneCompiler.hpp"
+#include "../dependencies/scene/hpp/SceneReloader.hpp"
+#include "../dependencies/scene/hpp/DefaultScene.hpp"
 #include "../dependencies/camera/hpp/Camera.hpp"
 
 class LogCapture {
@@ -40,6 +46,13 @@ RayTracerApp::RayTracerApp() {
 }
 
 bool RayTracerApp::OnInit() {
+    Trace::SetThreadName("main");
+    if (const char* trace_file = std::getenv("RT_TRACE")) {
+        m_traceFile = trace_file;
+        m_recordTrace = true;
+        Trace::Enable(true);
+    }
+
     if (SDL_Init(SDL_INIT_EVERYTHING) < 0) return false;
     
     // create resizable window
@@ -48,6 +61,7 @@ bool RayTracerApp::OnInit() {
     if (pWindow != NULL) {
         pRenderer = SDL_CreateRenderer(pWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
         m_image.Initialize(1280, 720, pRenderer);
+        m_heatmap.Initialize(1280, 720, pRenderer);
     } else {
         return false;
     }
@@ -82,81 +96,186 @@ void RayTracerApp::CreateRenderer() {
 void RayTracerApp::LoadScene() {
     LogCapture capture(m_renderLog);
     m_scene.Clear();
+    m_scene.SetBVHBuilder(static_cast<BVHBuilder>(m_bvhBuilder));
+    SceneLoader::ObjectMap objectMap;
+    m_hotReloadable = false;
     
     if (m_sceneType == 0) {
         std::cout << "[Scene] Creating default scene" << std::endl;
         CreateDefaultScene();
+    } else if (m_sceneType == 2) {
+        std::cout << "[Scene] Generating procedural scene" << std::endl;
+        SceneGenerator::Generate(GeneratorOptions(), m_scene);
+        if (m_loaderType != 0) m_scene.BuildBVH();
+    } else if (SceneCompiler::IsCompiledScene(m_jsonFilePath)) {
+        std::cout << "[Loader] Using compiled scene loader" << std::endl;
+        SceneCompiler::Load(m_jsonFilePath, m_scene, 16.0 / 9.0, m_loaderType != 0);
     } else if (m_loaderType == 0) {
         std::cout << "[Loader] Using Default loader" << std::endl;
-        SceneLoader::LoadJSON(m_jsonFilePath.c_str(), m_scene);
+        SceneLoader::LoadJSON(m_jsonFilePath.c_str(), m_scene, 16.0 / 9.0, &objectMap);
+        m_hotReloadable = true;
+    } else if (m_loaderType == 2) {
+        std::cout << "[Loader] Using streaming loader" << std::endl;
+        SceneLoader::LoadJSONStream(m_jsonFilePath, m_scene, 16.0 / 9.0, true, &objectMap);
+        m_hotReloadable = true;
     } else {
         std::cout << "[Loader] Using BVH loader" << std::endl;
-        SceneLoader::LoadJSONBVH(m_jsonFilePath.c_str(), m_scene);
+        SceneLoader::LoadJSONBVH(m_jsonFilePath.c_str(), m_scene, 16.0 / 9.0, &objectMap);
+        m_hotReloadable = true;
     }
     
     m_lastLoaderType = m_loaderType;
+    m_lastBvhBuilder = m_bvhBuilder;
+
+    // hot reload diffs against the JSON this scene was built from
+    m_reloader.ClearBaseline();
+    m_watcher.Stop();
+    if (m_hotReloadable) {
+        m_reloader.SetBaseline(m_jsonFilePath, std::move(objectMap));
+        if (m_hotReload) m_watcher.Watch(m_jsonFilePath);
+    }
 }
 
-void RayTracerApp::CreateDefaultScene() {
-    std::cout << "Building default scene with 3 large spheres and many small spheres..." << std::endl;
-    
-    double aspect_ratio = 16.0 / 9.0;
-    m_scene.SetupCamera(
-        Point3(13, 2, 3),
-        Point3(0, 0, 0),
-        Vector3(0, 1, 0),
-        20.0,
-        aspect_ratio,
-        0.1,
-        10.0
-    );
-    
-    auto ground = std::make_shared<Lambertian>(Vector3(0.5, 0.5, 0.5));
-    m_scene.AddObject(std::make_shared<sphere>(Point3(0, -1000, 0), 1000, ground));
-    
-    for (int a = -11; a < 11; a++) {
-        for (int b = -11; b < 11; b++) {
-            auto choose_mat = random_double();
-            Point3 center(a + 0.9*random_double(), 0.2, b + 0.9*random_double());
-            
-            if ((center - Point3(4, 0.2, 0)).length() > 0.9) {
-                std::shared_ptr<Material> sphere_material;
-                
-                if (choose_mat < 0.8) {
-                    auto albedo = Vector3(random_double(), random_double(), random_double()) *
-                                  Vector3(random_double(), random_double(), random_double());
-                    sphere_material = std::make_shared<Lambertian>(albedo);
-                } else if (choose_mat < 0.95) {
-                    auto albedo = Vector3(0.5 + 0.5*random_double(),
-                                         0.5 + 0.5*random_double(),
-                                         0.5 + 0.5*random_double());
-                    auto fuzz = 0.5 * random_double();
-                    sphere_material = std::make_shared<Metal>(albedo, fuzz);
-                } else {
-                    sphere_material = std::make_shared<Dielectric>(1.5);
-                }
-                
-                m_scene.AddObject(std::make_shared<sphere>(center, 0.2, sphere_material));
-            }
-        }
+void RayTracerApp::RenderScene() {
+    if (m_motorType != m_lastMotorType) {
+        CreateRenderer();
     }
     
-    auto material1 = std::make_shared<Dielectric>(1.5);
-    m_scene.AddObject(std::make_shared<sphere>(Point3(0, 1, 0), 1.0, material1));
-    
-    auto material2 = std::make_shared<Lambertian>(Vector3(0.4, 0.2, 0.1));
-    m_scene.AddObject(std::make_shared<sphere>(Point3(-4, 1, 0), 1.0, material2));
-    
-    auto material3 = std::make_shared<Metal>(Vector3(0.7, 0.6, 0.5), 0.0);
-    m_scene.AddObject(std::make_shared<sphere>(Point3(4, 1, 0), 1.0, material3));
-    
-    auto light = std::make_shared<PointLight>(Point3(5, 5, 5), Vector3(1.0, 1.0, 1.0));
-    m_scene.AddLight(light);
+    if (m_loaderType != m_lastLoaderType || m_bvhBuilder != m_lastBvhBuilder) {
+        LoadScene();
+    }
     
-    std::cout << "Default scene created!" << std::endl;
+    m_renderer->SetSamplesPerPixel(m_samples);
+    m_renderer->SetMaxDepth(m_depth);
+    m_renderer->SetSampler(static_cast<SamplerType>(m_samplerType));
+    Denoiser::Options denoise_options;
+    denoise_options.strength = m_denoiseStrength;
+    denoise_options.iterations = m_denoiseIterations;
+    m_renderer->SetDenoise(m_denoise);
+    m_renderer->SetDenoiseOptions(denoise_options);
+    if (!m_recordCost) m_costMap.Resize(0, 0);
+    m_renderer->SetCostMap(m_recordCost ? &m_costMap : nullptr);
+    m_aovs.SetPasses(m_aovPasses);
+    if (!m_aovPasses) m_aovs.Resize(0, 0);
+    m_renderer->SetAovBuffers(m_aovPasses ? &m_aovs : nullptr);
+    {
+        LogCapture capture(m_renderLog);
+        std::cout << "Starting render..." << std::endl;
+        auto t1 = std::chrono::high_resolution_clock::now();
+        m_renderer->Render(m_scene, m_image);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::milli> ms_double = t2 - t1;
+        m_lastRenderTime = ms_double.count();
+        m_lastStats = m_renderer->GetLastStats();
+        std::cout << "Render complete. Time: " << m_lastRenderTime << "ms" << std::endl;
+    }
+    UpdateHeatmap();
+}
+
+void RayTracerApp::UpdateHeatmap() {
+    if (m_viewMode > 0 && !m_costMap.Empty()) {
+        CostMetric metric = static_cast<CostMetric>(m_viewMode - 1);
+        m_costMap.ToImage(metric, m_heatmap);
+        // the legend reads these every frame, Scale() sorts the whole map
+        m_heatScale = m_costMap.Scale(metric);
+        m_heatMax = m_costMap.Max(metric);
+    }
 }
 
-void RayTracerApp::SaveImage(const std::string& format) {
+void RayTracerApp::ExportTrace() {
+    auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    char timestamp[20];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d_%H-%M-%S", std::localtime(&time));
+
+    std::string filename = std::string("trace_") + timestamp + ".json";
+    if (Trace::Write(filename)) {
+        m_renderLog += "Trace saved as " + filename + " (open in ui.perfetto.dev or chrome://tracing)\n";
+        Trace::Clear();
+    }
+}
+
+void RayTracerApp::SaveHeatmaps(const std::string& basename) {
+    if (m_costMap.Empty()) return;
+    // node visits and primitive tests stay at zero without the counters
+    int metrics = RenderStats::Enabled() ? static_cast<int>(CostMetric::Count) : 1;
+    Image heatmap;
+    heatmap.Initialize(m_costMap.GetWidth(), m_costMap.GetHeight(), NULL);
+    for (int m = 0; m < metrics; ++m) {
+        CostMetric metric = static_cast<CostMetric>(m);
+        std::string filename = basename + "_heat_" + CostMap::MetricName(metric) + ".ppm";
+        m_costMap.ToImage(metric, heatmap);
+        heatmap.SavePPM(filename);
+        m_renderLog += "Heatmap saved as " + filename + "\n";
+    }
+}
+
+void RayTracerApp::DrawStatistics() {
+    if (!RenderStats::Enabled()) {
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "Counters disabled (build with RT_ENABLE_STATS=ON)");
+        return;
+    }
+    const RenderCounters& c = m_lastStats;
+    if (c.rays() == 0) {
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "No render yet");
+        return;
+    }
+
+    double seconds = m_lastRenderTime / 1000.0;
+    ImGui::Text("%.2f Mrays/s", seconds > 0.0 ? c.rays() / seconds * 1e-6 : 0.0);
+    ImGui::Text("Rays: %llu", (unsigned long long)c.rays());
+    ImGui::Text("  primary %llu / bounce %llu / shadow %llu", (unsigned long long)c.primary_rays,
+                (unsigned long long)c.bounce_rays, (unsigned long long)c.shadow_rays);
+    ImGui::Text("Hits: %.1f%%", 100.0 * c.per_ray(c.hits));
+    if (c.shadow_cache_lookups) {
+        ImGui::Text("Shadow cache: %.1f%% of %llu lookups", 100.0 * c.shadow_cache_hits / c.shadow_cache_lookups,
+                    (unsigned long long)c.shadow_cache_lookups);
+    }
+    ImGui::Text("BVH nodes / ray: %.2f", c.per_ray(c.bvh_nodes));
+    ImGui::Text("AABB tests / ray: %.2f", c.per_ray(c.aabb_tests));
+    ImGui::Text("Primitive tests / ray: %.2f", c.per_ray(c.primitive_total()));
+    for (int k = 0; k < kPrimitiveKinds; k++) {
+        if (c.primitive_tests[k] == 0) continue;
+        ImGui::Text("  %s: %.2f", RenderStats::KindName(static_cast<PrimitiveKind>(k)), c.per_ray(c.primitive_tests[k]));
+    }
+}
+
+SceneGenerator::Options RayTracerApp::GeneratorOptions() const {
+    SceneGenerator::Options options;
+    options.seed = static_cast<uint64_t>(std::max(m_genSeed, 0));
+    options.spheres = static_cast<size_t>(std::max(m_genSpheres, 0));
+    options.triangles = static_cast<size_t>(std::max(m_genTriangles, 0));
+    options.triangle_mode = m_genSurface ? SceneGenerator::TriangleMode::Surface : SceneGenerator::TriangleMode::Soup;
+    options.lights = static_cast<size_t>(std::max(m_genLights, 0));
+    options.diffuse = m_genMix[0];
+    options.metal = m_genMix[1];
+    options.glass = m_genMix[2];
+    return options;
+}
+
+void RayTracerApp::HotReload() {
+    SceneReloader::Result result = m_reloader.Reload(m_jsonFilePath, m_scene);
+    if (!result.ok) return;  // unreadable / half-written file, wait for the next write
+
+    if (result.full_reload) {
+        LoadScene();
+        m_reloadStatus = "structural change, full reload";
+    } else if (result.Changed()) {
+        std::ostringstream msg;
+        msg << result.objects_updated << " objects, " << result.lights_updated << " lights"
+            << (result.camera_updated ? ", camera" : "") << " updated in " << result.ms << " ms";
+        m_reloadStatus = msg.str();
+    } else {
+        return;
+    }
+    // restart the render with the updated scene
+    m_renderRequested = true;
+}
+
+void RayTracerApp::CreateDefaultScene() {
+    DefaultScene::Build(m_scene);
+}
+
+void RayTracerApp::SaveImage(ImageFormat format) {
     auto now = std::chrono::system_clock::now();
     auto time = std::chrono::system_clock::to_time_t(now);
     std::tm* timeinfo = std::localtime(&time);
@@ -164,16 +283,30 @@ void RayTracerApp::SaveImage(const std::string& format) {
     char timestamp[20];
     std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d_%H-%M-%S", timeinfo);
     
-    if (format == "png") {
-        std::string filename = std::string("render_output_") + timestamp + ".png";
-        m_image.SavePPM("render_output_temp.ppm");
-        m_renderLog += "Saved as PPM (PNG not yet supported)\n";
-        std::cout << "Saved as " << filename << " (PPM format)" << std::endl;
-    } else {
-        std::string filename = std::string("render_output_") + timestamp + ".ppm";
-        m_image.SavePPM(filename);
-        m_renderLog += std::string("Image saved as ") + filename + "!\n";
-        std::cout << "Saved as " << filename << "!" << std::endl;
+    SaveHeatmaps(std::string("render_output_") + timestamp);
+    if (!m_aovs.Empty()) {
+        // the passes file goes next to the image, with its own name when the image is an EXR too
+        std::string filename = std::string("render_output_") + timestamp + "_passes.exr";
+        m_pendingSaves.emplace_back(filename, std::async(std::launch::async, [aovs = m_aovs, filename]() {
+            return aovs.WriteEXR(filename);
+        }));
+    }
+
+    std::string filename = std::string("render_output_") + timestamp + ImageWriter::Extension(format);
+    m_pendingSaves.emplace_back(filename, ImageWriter::WriteAsync(m_image, filename, format));
+    m_renderLog += "Saving " + filename + "...\n";
+}
+
+void RayTracerApp::PollSaves() {
+    for (auto it = m_pendingSaves.begin(); it != m_pendingSaves.end();) {
+        if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
+        bool ok = it->second.get();
+        m_renderLog += (ok ? "Saved " : "Failed to save ") + it->first + "\n";
+        std::cout << (ok ? "Saved " : "Failed to save ") << it->first << std::endl;
+        it = m_pendingSaves.erase(it);
     }
 }
 
@@ -192,14 +325,27 @@ void RayTracerApp::OnEvent(SDL_Event* event) {
 }
 
 void RayTracerApp::OnLoop() {
-    // update logic (empty for now)
+    if (m_hotReload && m_watcher.Poll()) {
+        HotReload();
+    }
+    // rebuilds the BVH in the background once edits degraded it too much
+    m_scene.MonitorBVH();
+    PollSaves();
+    if (m_renderRequested) {
+        m_renderRequested = false;
+        RenderScene();
+    }
 }
 
 void RayTracerApp::OnRender() {
     SDL_SetRenderDrawColor(pRenderer, 40, 40, 40, 255);
     SDL_RenderClear(pRenderer);
     
-    m_image.Display();
+    if (m_viewMode > 0 && !m_costMap.Empty()) {
+        m_heatmap.Display();
+    } else {
+        m_image.Display();
+    }
     
     ImGui_ImplSDLRenderer2_NewFrame();
     ImGui_ImplSDL2_NewFrame();
@@ -230,26 +376,7 @@ void RayTracerApp::OnRender() {
     }
     ImGui::SameLine();
     if (ImGui::Button("Start", ImVec2((left_panel_width - 40) / 2 - 10, 35))) {
-        if (m_motorType != m_lastMotorType) {
-            CreateRenderer();
-        }
-        
-        if (m_loaderType != m_lastLoaderType) {
-            LoadScene();
-        }
-        
-        m_renderer->SetSamplesPerPixel(m_samples);
-        m_renderer->SetMaxDepth(m_depth);
-        {
-            LogCapture capture(m_renderLog);
-            std::cout << "Starting render..." << std::endl;
-            auto t1 = std::chrono::high_resolution_clock::now();
-            m_renderer->Render(m_scene, m_image);
-            auto t2 = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double, std::milli> ms_double = t2 - t1;
-            m_lastRenderTime = ms_double.count();
-            std::cout << "Render complete. Time: " << m_lastRenderTime << "ms" << std::endl;
-        }
+        RenderScene();
     }
     
     ImGui::Separator();
@@ -263,12 +390,39 @@ void RayTracerApp::OnRender() {
     ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.8f, 1.0f), "Loaders");
     ImGui::RadioButton("Default##loader", &m_loaderType, 0);
     ImGui::RadioButton("BVH##loader", &m_loaderType, 1);
+    ImGui::RadioButton("Streaming + BVH##loader", &m_loaderType, 2);
+    if (m_loaderType != 0) {
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "BVH builder:");
+        ImGui::RadioButton("Median split##builder", &m_bvhBuilder, 0);
+        ImGui::RadioButton("LBVH (Morton)##builder", &m_bvhBuilder, 1);
+        ImGui::RadioButton("LBVH + treelets##builder", &m_bvhBuilder, 2);
+    }
     
     ImGui::Separator();
     
     ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.8f, 1.0f), "Scene");
     ImGui::RadioButton("Default##scene", &m_sceneType, 0);
     ImGui::RadioButton("Upload##scene", &m_sceneType, 1);
+    ImGui::RadioButton("Generated##scene", &m_sceneType, 2);
+
+    if (m_sceneType == 2) {
+        ImGui::InputInt("Spheres##gen", &m_genSpheres, 1000, 100000);
+        ImGui::InputInt("Triangles##gen", &m_genTriangles, 1000, 100000);
+        ImGui::Checkbox("Tessellated surface##gen", &m_genSurface);
+        ImGui::SliderInt("Lights##gen", &m_genLights, 0, 16);
+        ImGui::SliderFloat3("Diffuse/metal/glass##gen", m_genMix, 0.0f, 1.0f);
+        ImGui::InputInt("Seed##gen", &m_genSeed);
+        if (ImGui::Button("Generate##gen")) {
+            LoadScene();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Export JSON##gen")) {
+            std::string filename = "generated_" + std::to_string(m_genSeed) + ".json";
+            if (SceneGenerator::WriteJSON(GeneratorOptions(), filename)) {
+                m_renderLog += "Scene written to " + filename + "\n";
+            }
+        }
+    }
     
     if (m_sceneType == 1) {
         static char jsonPathBuffer[512];
@@ -284,6 +438,16 @@ void RayTracerApp::OnRender() {
             m_jsonFilePath = std::string(jsonPathBuffer);
             LoadScene();
         }
+        // only JSON scenes can be diffed, compiled .rtsc files need a full load
+        ImGui::BeginDisabled(!m_hotReloadable);
+        if (ImGui::Checkbox("Hot reload", &m_hotReload)) {
+            if (m_hotReload) m_watcher.Watch(m_jsonFilePath);
+            else m_watcher.Stop();
+        }
+        ImGui::EndDisabled();
+        if (m_hotReload && !m_reloadStatus.empty()) {
+            ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "%s", m_reloadStatus.c_str());
+        }
     }
     
     ImGui::Separator();
@@ -291,26 +455,82 @@ void RayTracerApp::OnRender() {
     ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.8f, 1.0f), "Params");
     ImGui::SliderInt("Nb Sample", &m_samples, 1, 500);
     ImGui::SliderInt("Nb Bounce", &m_depth, 1, 50);
+    ImGui::Text("Sampler");
+    ImGui::RadioButton("Random##sampler", &m_samplerType, static_cast<int>(SamplerType::Independent));
+    ImGui::SameLine();
+    ImGui::RadioButton("Stratified##sampler", &m_samplerType, static_cast<int>(SamplerType::Stratified));
+    ImGui::RadioButton("Sobol##sampler", &m_samplerType, static_cast<int>(SamplerType::Sobol));
+    ImGui::SameLine();
+    ImGui::RadioButton("Blue noise##sampler", &m_samplerType, static_cast<int>(SamplerType::BlueNoise));
+    ImGui::Checkbox("Denoise", &m_denoise);
+    if (m_denoise) {
+        ImGui::SliderFloat("Strength##denoise", &m_denoiseStrength, 0.0f, 4.0f);
+        ImGui::SliderInt("Passes##denoise", &m_denoiseIterations, 1, 8);
+    }
     
     ImGui::Separator();
     
     ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.8f, 1.0f), "Results");
     ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.0f, 1.0f), "time t");
     ImGui::Text("%.1f ms", m_lastRenderTime);
+    if (m_scene.GetBVH()) {
+        ImGui::Text("BVH cost x%.2f%s", m_scene.GetBVHCostRatio(), m_scene.IsRebuildingBVH() ? " (rebuilding)" : "");
+    }
+    if (ImGui::CollapsingHeader("Statistics")) {
+        DrawStatistics();
+    }
+
+    ImGui::Separator();
+
+    ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.8f, 1.0f), "Diagnostics");
+    ImGui::Checkbox("Record cost heatmap", &m_recordCost);
+    if (m_recordCost) {
+        bool view_changed = ImGui::RadioButton("Render##view", &m_viewMode, 0);
+        view_changed |= ImGui::RadioButton("Time per pixel##view", &m_viewMode, 1);
+        if (RenderStats::Enabled()) {
+            view_changed |= ImGui::RadioButton("BVH nodes##view", &m_viewMode, 2);
+            view_changed |= ImGui::RadioButton("Primitive tests##view", &m_viewMode, 3);
+        }
+        if (view_changed) UpdateHeatmap();
+        if (m_viewMode > 0 && !m_costMap.Empty()) {
+            CostMetric metric = static_cast<CostMetric>(m_viewMode - 1);
+            const char* unit = metric == CostMetric::Time ? " ns" : "";
+            ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "blue 0 .. red %.0f%s (p99), max %.0f%s",
+                               m_heatScale, unit, m_heatMax, unit);
+        }
+    } else {
+        m_viewMode = 0;
+    }
+    if (ImGui::Checkbox("Record trace", &m_recordTrace)) {
+        Trace::Enable(m_recordTrace);
+    }
+    if (m_recordTrace) {
+        ImGui::SameLine();
+        if (ImGui::Button("Export trace")) ExportTrace();
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "%zu events", Trace::EventCount());
+    }
     
     ImGui::Separator();
     
     ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.8f, 1.0f), "Save options");
     ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "Format:");
-    ImGui::RadioButton("PNG##format", &m_saveFormat, 0);
-    ImGui::RadioButton("PPM##format", &m_saveFormat, 1);
+    ImGui::RadioButton("PNG##format", &m_saveFormat, static_cast<int>(ImageFormat::PNG));
+    ImGui::RadioButton("PPM##format", &m_saveFormat, static_cast<int>(ImageFormat::PPM));
+    ImGui::RadioButton("EXR half (HDR)##format", &m_saveFormat, static_cast<int>(ImageFormat::EXRHalf));
+    ImGui::RadioButton("EXR float (HDR)##format", &m_saveFormat, static_cast<int>(ImageFormat::EXRFloat));
+    if (ImGui::CollapsingHeader("Output passes (EXR)")) {
+        for (int a = 0; a < kAovCount; ++a) {
+            std::string label = std::string(AovBuffers::Name(static_cast<Aov>(a))) + "##aov";
+            ImGui::CheckboxFlags(label.c_str(), &m_aovPasses, AovBuffers::Bit(static_cast<Aov>(a)));
+        }
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "filled by the next render");
+    }
     
     if (ImGui::Button("Save", ImVec2(-1, 35))) {
-        if (m_saveFormat == 0) {
-            SaveImage("png");
-        } else {
-            SaveImage("ppm");
-        }
+        SaveImage(static_cast<ImageFormat>(m_saveFormat));
+    }
+    if (!m_pendingSaves.empty()) {
+        ImGui::TextColored(ImVec4(0.6f, 0.6f, 0.6f, 1.0f), "%zu file(s) being written", m_pendingSaves.size());
     }
     
     ImGui::Separator();
@@ -336,6 +556,8 @@ void RayTracerApp::OnRender() {
 }
 
 void RayTracerApp::OnExit() {
+    if (!m_traceFile.empty()) Trace::Write(m_traceFile);
+
     // cleanup ImGui
     ImGui_ImplSDLRenderer2_Shutdown();
     ImGui_ImplSDL2_Shutdown();
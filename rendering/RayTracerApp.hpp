@@ -11,7 +11,14 @@
 #include <vector>
 #include <memory>
 #include "../dependencies/utils/hpp/Image.hpp"
+#include "../dependencies/utils/hpp/CostMap.hpp"
+#include "../dependencies/utils/hpp/AovBuffers.hpp"
+#include "../dependencies/utils/hpp/ImageWriter.hpp"
+#include "../dependencies/utils/hpp/Trace.hpp"
 #include "../dependencies/scene/hpp/scene.hpp"
+#include "../dependencies/scene/hpp/SceneReloader.hpp"
+#include "../dependencies/scene/hpp/SceneGenerator.hpp"
+#include "../dependencies/utils/hpp/FileWatcher.hpp"
 #include "../dependencies/RTMotors/hpp/Renderer.hpp"
 #include "../dependencies/RTMotors/hpp/SimpleRenderer.hpp"
 #include "../dependencies/RTMotors/hpp/ParallelRenderer.hpp"
@@ -52,33 +59,82 @@ private:
     
     void CreateRenderer();
     void LoadScene();
-    void SaveImage(const std::string& format);
+    void RenderScene();
+    void HotReload();       // apply on-disk changes of the JSON scene
+    void SaveImage(ImageFormat format);
+    void PollSaves();       // reports the background writes that finished
+    void DrawStatistics();  // counters of the last render
+    void UpdateHeatmap();   // redraws m_heatmap for the selected view
+    void SaveHeatmaps(const std::string& basename);
+    void ExportTrace();
     void CreateDefaultScene();
 
     // UI state (sliders)
     int m_samples = 5;
     int m_depth = 5;
+    int m_samplerType = static_cast<int>(SamplerType::Sobol);
+    bool m_denoise = false;
+    float m_denoiseStrength = 1.0f;
+    int m_denoiseIterations = 5;
     bool m_renderRequested = false;
     double m_lastRenderTime = 0.0;
+    RenderCounters m_lastStats;
+
+    // per-pixel cost diagnostics: view 0 = render, 1 + CostMetric = heatmap
+    bool m_recordCost = false;
+    int m_viewMode = 0;
+    CostMap m_costMap;
+    Image m_heatmap;
+    double m_heatScale = 0.0;   // legend of m_heatmap, set by UpdateHeatmap()
+    double m_heatMax = 0.0;
+
+    // Chrome trace recording, RT_TRACE=<file> records from startup and writes on exit
+    bool m_recordTrace = false;
+    std::string m_traceFile;
     
     // Motor selection (0 = Default, 1 = OpenMP)
     int m_motorType = 1;
     
-    // Loader selection (0 = Default, 1 = BVH)
+    // Loader selection (0 = Default, 1 = BVH, 2 = Streaming + BVH)
     int m_loaderType = 1;
     int m_lastLoaderType = -1;
+
+    // BVH builder (0 = Median split, 1 = LBVH, 2 = LBVH + treelets), see BVHBuilder
+    int m_bvhBuilder = 0;
+    int m_lastBvhBuilder = -1;
     
-    // Scene selection (0 = Default, 1 = Upload custom)
+    // Scene selection (0 = Default, 1 = Upload custom, 2 = Generated)
     int m_sceneType = 1;
+
+    // procedural scene settings (ImGui edits ints, copied into SceneGenerator::Options)
+    int m_genSpheres = 10000;
+    int m_genTriangles = 0;
+    bool m_genSurface = false;
+    int m_genLights = 4;
+    int m_genSeed = 1;
+    float m_genMix[3] = {0.7f, 0.2f, 0.1f};
+    SceneGenerator::Options GeneratorOptions() const;
     
-    // Save format (0 = PNG, 1 = PPM)
-    int m_saveFormat = 1;
+    // Save format (an ImageFormat), written on a background thread
+    int m_saveFormat = static_cast<int>(ImageFormat::PNG);
+    std::vector<std::pair<std::string, std::future<bool>>> m_pendingSaves;
+
+    // output passes (mask of AovBuffers::Bit), saved next to the image as one EXR
+    unsigned int m_aovPasses = 0;
+    AovBuffers m_aovs;
     
     // Log capture for UI display
     std::string m_renderLog;
     
     // path to loaded JSON scene file
     std::string m_jsonFilePath = "../SceneFromJson/Scene01.json";
+
+    // hot reload: watch the JSON file and patch the scene when it changes
+    bool m_hotReload = false;
+    bool m_hotReloadable = false;   // current scene was loaded from a JSON file
+    FileWatcher m_watcher;
+    SceneReloader m_reloader;
+    std::string m_reloadStatus;
     
 };
 
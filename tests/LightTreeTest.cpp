@@ -0,0 +1,66 @@
+/*
+    LightTreeTest.cpp
+    A hard-edged spot (inner cone >= outer cone) among more lights than the exhaustive count
+    must still be picked for the points inside its cone, and never for the points outside
+*/
+
+#include "lights/hpp/LightTree.hpp"
+#include "lights/hpp/PointLight.hpp"
+#include "lights/hpp/SpotLight.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// fraction of u in [0, 1) for which the tree picks light at p
+double PickRate(const LightTree& tree, const Point3& p, const Vector3& n, size_t light) {
+    constexpr int kSteps = 4096;
+    int picked = 0;
+    for (int k = 0; k < kSteps; k++) {
+        size_t chosen;
+        double pmf;
+        if (tree.Sample(p, n, (k + 0.5) / kSteps, chosen, pmf) && chosen == light && pmf > 0.0) picked++;
+    }
+    return static_cast<double>(picked) / kSteps;
+}
+
+} // namespace
+
+int main() {
+    std::vector<std::shared_ptr<Light>> lights;
+    for (int i = 0; i < 20; i++) {
+        lights.push_back(std::make_shared<PointLight>(Point3(-20.0 + 2.0 * i, 10.0, -5.0), Vector3(0.5, 0.5, 0.5)));
+    }
+    // 30 degrees, no falloff, pointing down at the origin
+    const size_t spot = lights.size();
+    lights.push_back(std::make_shared<SpotLight>(Point3(0, 10, 0), Vector3(0, -1, 0), Vector3(5, 5, 5), 30.0, 30.0));
+    const size_t soft = lights.size();
+    lights.push_back(std::make_shared<SpotLight>(Point3(40, 10, 0), Vector3(0, -1, 0), Vector3(5, 5, 5), 20.0, 30.0));
+
+    LightTree tree;
+    tree.Build(lights);
+    const Vector3 up(0, 1, 0);
+    int failures = 0;
+    auto expect = [&failures](bool ok, const char* what) {
+        if (!ok) {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            failures++;
+        }
+    };
+
+    LightBounds bounds;
+    expect(LightBounds::FromLight(*lights[spot], bounds), "hard spot has bounds");
+    expect(bounds.Importance(Point3(0, 0, 0), up) > 0.0, "hard spot importance on its axis");
+    expect(bounds.Importance(Point3(3, 0, 0), up) > 0.0, "hard spot importance inside its cone");
+    expect(bounds.Importance(Point3(10, 0, 0), up) == 0.0, "hard spot importance outside its cone");
+
+    expect(PickRate(tree, Point3(0, 0, 0), up, spot) > 0.0, "hard spot picked on its axis");
+    expect(PickRate(tree, Point3(3, 0, 0), up, spot) > 0.0, "hard spot picked inside its cone");
+    expect(PickRate(tree, Point3(10, 0, 0), up, spot) == 0.0, "hard spot not picked outside its cone");
+    expect(PickRate(tree, Point3(40, 0, 0), up, soft) > 0.0, "soft spot picked inside its cone");
+
+    if (failures == 0) std::printf("LightTreeTest: all checks passed\n");
+    return failures == 0 ? 0 : 1;
+}